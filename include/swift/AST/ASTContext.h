@@ -64,6 +64,7 @@ namespace swift {
   class TupleType;
   class FunctionType;
   class ArchetypeType;
+  class CompilerStatistics;
   class Identifier;
   class InheritedNameSet;
   class ModuleDecl;
@@ -236,6 +237,10 @@ public:
   /// A consumer of type checker debug output.
   std::unique_ptr<TypeCheckerDebugConsumer> TypeCheckerDebug;
 
+  /// If non-null, the statistics of the current compilation, which passes
+  /// add their counters to. \sa -stats-output-dir
+  CompilerStatistics *Stats = nullptr;
+
   /// Cache for names of canonical GenericTypeParamTypes.
   mutable llvm::DenseMap<unsigned, Identifier>
     CanonicalGenericTypeParamTypeNames;
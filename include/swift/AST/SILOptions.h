@@ -95,12 +95,31 @@ public:
   /// Emit a mapping of profile counters for use in coverage.
   bool EmitProfileCoverageMapping = false;
 
+  /// The path to a profdata file to use for profile-guided optimization, or
+  /// empty if there is none.
+  std::string UseProfile;
+
   /// Should we use a pass pipeline passed in via a json file? Null by default.
   StringRef ExternalPassPipelineFilename;
   
   /// Emit captures and function contexts using +0 caller-guaranteed ARC
   /// conventions.
   bool EnableGuaranteedClosureContexts = false;
+
+  /// Keep the specializations of public generic functions of this module and
+  /// list them in the module file, so that clients can link against them.
+  ///
+  /// Only has an effect in whole-module builds.
+  bool ExportSpecializations = false;
+
+  /// Call specializations exported by imported modules instead of creating
+  /// local copies. This trades the inlining of the specializations for code
+  /// size. At -Onone exported specializations are always used.
+  bool ReuseSpecializations = false;
+
+  /// The file to which optimization remarks are written as YAML, or empty if
+  /// no remarks should be recorded.
+  std::string OptRecordFile;
 };
 
 } // end namespace swift
@@ -80,6 +80,7 @@ enum class FunctionSigSpecializationParamKind : unsigned {
   ClosureProp = 5,
   BoxToValue = 6,
   BoxToStack = 7,
+  ExistentialToConcrete = 8,
 
   // Option Set Flags use bits 6-31. This gives us 26 bits to use for option
   // flags.
@@ -99,6 +100,7 @@ enum class SpecializationPass : uint8_t {
   CapturePropagation,
   FunctionSignatureOpts,
   GenericSpecializer,
+  ExistentialSpecializer,
 };
 
 static inline char encodeSpecializationPass(SpecializationPass Pass) {
@@ -0,0 +1,98 @@
+//===--- Statistics.h - Machine-readable compilation statistics -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Support for -stats-output-dir, which makes every driver and frontend
+// process write the statistics it collected to a file in the given directory.
+//
+// Each file is a flat JSON object mapping the names of counters to integer
+// values, e.g. "AST.NumDecls" or "time.Type checking.us". Counters with the
+// same name in different files measure the same thing, so the files of a
+// build can be summed up to track compile-time regressions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_STATISTICS_H
+#define SWIFT_BASIC_STATISTICS_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <system_error>
+
+namespace swift {
+
+/// A set of named counters collected by a single compiler process.
+class CompilerStatistics {
+  std::map<std::string, uint64_t> Counters;
+
+public:
+  const std::map<std::string, uint64_t> &getCounters() const {
+    return Counters;
+  }
+
+  /// Adds \p value to the counter \p name, creating it if necessary.
+  void add(StringRef name, uint64_t value) {
+    Counters[name] += value;
+  }
+
+  /// Sets the counter \p name to \p value if that is larger than its current
+  /// value.
+  void max(StringRef name, uint64_t value);
+
+  /// Adds the total time spent in each phase of the compilation, as recorded
+  /// by SharedTimers, in microseconds.
+  ///
+  /// Requires TraceEvents to have been enabled.
+  void addPhaseTimes();
+
+  /// Adds the values of all LLVM Statistics counters, under the names
+  /// "LLVM.<debug type>.<description>".
+  ///
+  /// Requires llvm::EnableStatistics() to have been called.
+  void addLLVMStatistics();
+
+  /// Adds the peak memory usage of the current process, in bytes.
+  void addPeakMemoryUsage();
+
+  /// Adds every counter in the statistics file at \p path to the counters of
+  /// this object.
+  ///
+  /// Counters named "Largest..." or "Peak..." are combined by taking the
+  /// maximum rather than the sum.
+  ///
+  /// \returns true if the file could not be read.
+  bool addFromFile(StringRef path);
+
+  /// Writes the counters to \p path as a JSON object, creating its parent
+  /// directory if necessary.
+  std::error_code write(StringRef path) const;
+
+  /// Returns the name of the statistics file a process should write to
+  /// \p dir.
+  ///
+  /// \param kind Either "driver" or "frontend".
+  /// \param processID The process writing the file.
+  /// \param label The module or file the process was working on.
+  static std::string getOutputPath(StringRef dir, StringRef kind,
+                                   uint64_t processID, StringRef label);
+
+  /// Returns the prefix of the names of the files written by getOutputPath
+  /// for the process \p processID.
+  static std::string getOutputFilePrefix(StringRef kind, uint64_t processID);
+};
+
+} // end namespace swift
+
+#endif // SWIFT_BASIC_STATISTICS_H
@@ -14,12 +14,16 @@
 #define SWIFT_BASIC_TIMER_H
 
 #include "swift/Basic/LLVM.h"
+#include "swift/Basic/TraceEvents.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/Support/Timer.h"
 
 namespace swift {
   /// A convenience class for declaring a timer that's part of the Swift
   /// compilation timers group.
+  ///
+  /// If trace events are enabled, the timed region is also recorded as a
+  /// trace event. \sa swift::TraceEvents
   class SharedTimer {
     enum class State {
       Initial,
@@ -30,14 +34,30 @@ namespace swift {
 
     Optional<llvm::NamedRegionTimer> Timer;
 
+    StringRef TraceName;
+    uint64_t TraceStart = 0;
+
   public:
     explicit SharedTimer(StringRef name) {
       if (CompilationTimersEnabled == State::Enabled)
         Timer.emplace(name, StringRef("Swift compilation"));
       else
         CompilationTimersEnabled = State::Skipped;
+
+      if (TraceEvents::isEnabled()) {
+        TraceName = name;
+        TraceStart = TraceEvents::now();
+      }
     }
 
+    ~SharedTimer() {
+      if (!TraceName.empty())
+        TraceEvents::record(TraceName, TraceStart);
+    }
+
+    SharedTimer(const SharedTimer &) = delete;
+    SharedTimer &operator=(const SharedTimer &) = delete;
+
     /// Must be called before any SharedTimers have been created.
     static void enableCompilationTimers() {
       assert(CompilationTimersEnabled != State::Skipped &&
@@ -0,0 +1,105 @@
+//===--- TraceEvents.h - Chrome trace events for compilations ---*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Support for recording the phases of a compilation as "complete" events in
+// the Chrome trace event format, so that the wall-clock time of a build can be
+// inspected with chrome://tracing.
+//
+// Trace files are written as a JSON array with exactly one event object per
+// line. This allows the driver to merge the files produced by its frontend
+// jobs without having to parse them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_TRACEEVENTS_H
+#define SWIFT_BASIC_TRACEEVENTS_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace swift {
+
+/// A single timed region of a compilation.
+struct TraceEvent {
+  /// The name of the region, e.g. "Parsing" or "SIL optimization".
+  std::string Name;
+
+  /// The kind of region, e.g. "frontend" or "job".
+  std::string Category;
+
+  /// The file (or module) the region was working on.
+  std::string File;
+
+  /// The start of the region, in microseconds. \see TraceEvents::now
+  uint64_t Start = 0;
+
+  /// The length of the region, in microseconds.
+  uint64_t Duration = 0;
+
+  /// The process the region ran in.
+  uint64_t ProcessID = 0;
+
+  /// The thread the region ran on.
+  uint64_t ThreadID = 0;
+};
+
+/// Collects the trace events of the current process.
+///
+/// Events may be recorded concurrently, e.g. by the LLVM threads of IRGen.
+///
+/// \sa swift::SharedTimer
+class TraceEvents {
+  static bool Enabled;
+
+public:
+  /// Starts recording an event for every SharedTimer region.
+  ///
+  /// Must be called before any SharedTimers have been created.
+  static void enable() { Enabled = true; }
+
+  static bool isEnabled() { return Enabled; }
+
+  /// Returns a copy of the events recorded by this process so far.
+  static std::vector<TraceEvent> getEvents();
+
+  /// Returns the current wall-clock time in microseconds.
+  ///
+  /// Values are comparable across processes, so events recorded by different
+  /// jobs of the same build line up when merged.
+  static uint64_t now();
+
+  /// Returns an identifier for the current process.
+  static uint64_t getCurrentProcessID();
+
+  /// Returns the system identifier of the current thread.
+  static uint64_t getCurrentThreadID();
+
+  /// Records a region of the current process that started at \p start and
+  /// ends now.
+  static void record(StringRef name, uint64_t start);
+
+  /// Writes \p event as a single-line JSON object, with no trailing separator.
+  static void writeEvent(raw_ostream &os, const TraceEvent &event);
+
+  /// Writes all events recorded by this process to \p path as a JSON array,
+  /// labelling each of them with \p file.
+  static std::error_code writeRecordedEvents(StringRef path, StringRef file);
+};
+
+} // end namespace swift
+
+#endif // SWIFT_BASIC_TRACEEVENTS_H
@@ -22,6 +22,7 @@
 #include "swift/Basic/ArrayRefView.h"
 #include "swift/Basic/LLVM.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/TimeValue.h"
 
@@ -39,6 +40,7 @@ namespace swift {
   class DiagnosticEngine;
 
 namespace driver {
+  class CompilationCache;
   class Driver;
   class ToolChain;
 
@@ -95,6 +97,20 @@ private:
   /// A hash representing all the arguments that could trigger a full rebuild.
   std::string ArgsHash;
 
+  /// Write a Chrome trace of the jobs in this compilation to this file.
+  ///
+  /// The trace includes the phases recorded by each frontend job.
+  std::string TraceOutputPath;
+
+  /// If non-empty, the path to write the statistics of this compilation to,
+  /// including the sum of the statistics of its frontend jobs.
+  ///
+  /// \sa swift::CompilerStatistics
+  std::string StatsOutputPath;
+
+  /// When non-null, compile jobs whose outputs are in this cache are not run.
+  std::unique_ptr<CompilationCache> Cache;
+
   /// When the build was started.
   ///
   /// This should be as close as possible to when the driver was invoked, since
@@ -106,6 +122,13 @@ private:
   /// If unknown, this will be some time in the past.
   llvm::sys::TimeValue LastBuildTime = llvm::sys::TimeValue::MinTime();
 
+  /// The interface hashes of the modules this compilation's inputs depended
+  /// on, as of the last build, keyed by path.
+  ///
+  /// An external dependency that has been modified since the last build does
+  /// not cause any rebuilds if its interface hash is unchanged.
+  llvm::StringMap<std::string> LastExternalInterfaceHashes;
+
   /// The number of commands which this compilation should attempt to run in
   /// parallel.
   unsigned NumberOfParallelCommands;
@@ -132,6 +155,9 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// When true, prints how many jobs were restored from the compilation cache.
+  bool ShowCompilationCacheStatistics = false;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -189,6 +215,10 @@ public:
     ShowIncrementalBuildDecisions = value;
   }
 
+  void setShowsCompilationCacheStatistics(bool value = true) {
+    ShowCompilationCacheStatistics = value;
+  }
+
   void setCompilationRecordPath(StringRef path) {
     assert(CompilationRecordPath.empty() && "already set");
     CompilationRecordPath = path;
@@ -198,6 +228,20 @@ public:
     LastBuildTime = time;
   }
 
+  void setLastExternalInterfaceHashes(llvm::StringMap<std::string> hashes) {
+    LastExternalInterfaceHashes = std::move(hashes);
+  }
+
+  void setTraceOutputPath(StringRef path) {
+    TraceOutputPath = path;
+  }
+
+  void setStatsOutputPath(StringRef path) {
+    StatsOutputPath = path;
+  }
+
+  void setCompilationCache(std::unique_ptr<CompilationCache> cache);
+
   /// Requests the path to a file containing all input source files. This can
   /// be shared across jobs.
   ///
@@ -0,0 +1,90 @@
+//===--- CompilationCache.h - Cache of Frontend Job Outputs -----*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// A local, content-addressed cache of the outputs of compile jobs.
+//
+// Each entry is a directory named by a hash of the job's command line, with
+// the paths of its outputs left out. The directory holds a copy of every
+// output the job produced, and a manifest listing the contents of every file
+// the job read (taken from its make-style dependencies file), so that an entry
+// is only reused if none of the job's sources or imported modules changed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_COMPILATIONCACHE_H
+#define SWIFT_DRIVER_COMPILATIONCACHE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+
+namespace swift {
+namespace driver {
+  class Job;
+
+class CompilationCache {
+  /// The directory holding the cache entries.
+  std::string Path;
+
+  /// The maximum size of the cache in bytes, or 0 if unbounded.
+  uint64_t SizeLimit;
+
+  /// The content hashes of files read so far, keyed by path.
+  ///
+  /// Many jobs depend on the same imported modules, which can be large.
+  llvm::StringMap<std::string> ContentHashes;
+
+  unsigned NumHits = 0;
+  unsigned NumMisses = 0;
+  unsigned NumEvicted = 0;
+
+  /// Returns the hash of the contents of \p path, or the empty string if the
+  /// file cannot be read.
+  StringRef getContentHash(StringRef path);
+
+  /// Returns the directory of the entry for \p job.
+  std::string getEntryPath(const Job &job) const;
+
+public:
+  CompilationCache(StringRef path, uint64_t sizeLimit)
+    : Path(path), SizeLimit(sizeLimit) {}
+
+  /// Returns true if the outputs of \p job can be cached.
+  ///
+  /// Only compile jobs that pass all of their inputs on the command line and
+  /// write a make-style dependencies file are cached.
+  static bool isCacheable(const Job &job);
+
+  /// Copies the outputs of a previous run of \p job into place.
+  ///
+  /// \returns the output the job printed when it ran, or None if there is no
+  /// up-to-date entry for it.
+  Optional<std::string> restore(const Job &job);
+
+  /// Saves the outputs of \p job, which just finished successfully after
+  /// printing \p output.
+  void store(const Job &job, StringRef output);
+
+  /// Removes the least recently used entries until the cache is no larger
+  /// than its size limit.
+  void evict();
+
+  void printStatistics(raw_ostream &out) const;
+};
+
+} // end namespace driver
+} // end namespace swift
+
+#endif
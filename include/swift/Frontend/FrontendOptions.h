@@ -115,6 +115,18 @@ public:
   /// The path to which we should output a fixits as source edits.
   std::string FixitsOutputPath;
 
+  /// The path to which we should output the compilation phases of this
+  /// frontend invocation as Chrome trace events.
+  ///
+  /// \sa swift::TraceEvents
+  std::string TraceEventsOutputPath;
+
+  /// If non-empty, a directory to write the statistics of this frontend
+  /// invocation to.
+  ///
+  /// \sa swift::CompilerStatistics
+  std::string StatsOutputDir;
+
   /// Arguments which should be passed in immediate mode.
   std::vector<std::string> ImmediateArgv;
 
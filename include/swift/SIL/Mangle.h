@@ -148,6 +148,7 @@ class FunctionSignatureSpecializationMangler
     ClosureProp=2,
     BoxToValue=3,
     BoxToStack=4,
+    ExistentialToConcrete=5,
     First_Option=0, Last_Option=31,
 
     // Option Set Space. 12 bits (i.e. 12 option).
@@ -172,12 +173,15 @@ public:
   void setArgumentSROA(unsigned ArgNo);
   void setArgumentBoxToValue(unsigned ArgNo);
   void setArgumentBoxToStack(unsigned ArgNo);
+  void setArgumentExistentialToConcrete(unsigned ArgNo,
+                                        SILInstruction *InitExistential);
 
 private:
   void mangleSpecialization();
   void mangleConstantProp(LiteralInst *LI);
   void mangleClosureProp(PartialApplyInst *PAI);
   void mangleClosureProp(ThinToThickFunctionInst *TTTFI);
+  void mangleExistentialToConcrete(SILInstruction *InitExistential);
   void mangleArgument(ArgumentModifierIntBase ArgMod,
                       NullablePtr<SILInstruction> Inst);
 };
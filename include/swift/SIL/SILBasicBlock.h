@@ -19,6 +19,7 @@
 
 #include "swift/Basic/Range.h"
 #include "swift/SIL/SILInstruction.h"
+#include "llvm/ADT/Optional.h"
 
 namespace llvm {
   template <class T> struct GraphTraits;
@@ -49,6 +50,11 @@ private:
   /// The ordered set of instructions in the SILBasicBlock.
   InstListType InstList;
 
+  /// The number of times this block was executed in a profiled run, if the
+  /// function was compiled with -profile-use and the block begins a region
+  /// with a profile counter.
+  Optional<uint64_t> ProfileCount;
+
   friend struct llvm::ilist_sentinel_traits<SILBasicBlock>;
   friend struct llvm::ilist_traits<SILBasicBlock>;
   SILBasicBlock() : Parent(0) {}
@@ -80,6 +86,15 @@ public:
   /// Returns true if this BB is the entry BB of its parent.
   bool isEntry() const;
 
+  /// Returns the number of times this block was executed in a profiled run,
+  /// or None if no profile data is available for it.
+  ///
+  /// Only blocks that begin a counted region, such as the body of an 'if' or
+  /// a loop, have a count of their own. A block without one is still known
+  /// to be unexecuted if a block dominating it has a count of zero.
+  Optional<uint64_t> getProfileCount() const { return ProfileCount; }
+  void setProfileCount(Optional<uint64_t> Count) { ProfileCount = Count; }
+
   //===--------------------------------------------------------------------===//
   // SILInstruction List Inspection and Manipulation
   //===--------------------------------------------------------------------===//
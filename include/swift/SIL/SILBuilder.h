@@ -229,7 +229,19 @@ public:
     // counted towards the function prologue.
     assert(!Loc.isInPrologue());
     return insert(new (F.getModule()) AllocRefInst(
-        createSILDebugLocation(Loc), elementType, F, objc, canAllocOnStack));
+        createSILDebugLocation(Loc), elementType, F, objc, canAllocOnStack,
+        SILType(), {}));
+  }
+
+  /// Allocates an instance of \p elementType followed by \p TailCount
+  /// elements of type \p TailType.
+  AllocRefInst *createAllocRef(SILLocation Loc, SILType elementType, bool objc,
+                               bool canAllocOnStack, SILType TailType,
+                               SILValue TailCount) {
+    assert(!Loc.isInPrologue());
+    return insert(new (F.getModule()) AllocRefInst(
+        createSILDebugLocation(Loc), elementType, F, objc, canAllocOnStack,
+        TailType, TailCount));
   }
 
   AllocRefDynamicInst *createAllocRefDynamic(SILLocation Loc, SILValue operand,
@@ -842,6 +854,12 @@ public:
     return createRefElementAddr(Loc, Operand, Field, ResultTy);
   }
 
+  RefTailAddrInst *createRefTailAddr(SILLocation Loc, SILValue Operand,
+                                     SILType ResultTy) {
+    return insert(new (F.getModule()) RefTailAddrInst(
+        createSILDebugLocation(Loc), Operand, ResultTy));
+  }
+
   ClassMethodInst *createClassMethod(SILLocation Loc, SILValue Operand,
                                      SILDeclRef Member, SILType MethodTy,
                                      bool Volatile = false) {
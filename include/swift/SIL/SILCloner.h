@@ -417,6 +417,15 @@ template<typename ImplClass>
 void
 SILCloner<ImplClass>::visitAllocRefInst(AllocRefInst *Inst) {
   getBuilder().setCurrentDebugScope(getOpScope(Inst->getDebugScope()));
+  if (Inst->hasTailAllocatedElements()) {
+    doPostProcess(Inst,
+      getBuilder().createAllocRef(getOpLocation(Inst->getLoc()),
+                                  getOpType(Inst->getType()),
+                                  Inst->isObjC(), Inst->canAllocOnStack(),
+                                  getOpType(Inst->getTailAllocatedType()),
+                                  getOpValue(Inst->getTailAllocatedCount())));
+    return;
+  }
   doPostProcess(Inst,
     getBuilder().createAllocRef(getOpLocation(Inst->getLoc()),
                                 getOpType(Inst->getType()),
@@ -1193,6 +1202,16 @@ SILCloner<ImplClass>::visitRefElementAddrInst(RefElementAddrInst *Inst) {
                                       getOpType(Inst->getType())));
 }
 
+template<typename ImplClass>
+void
+SILCloner<ImplClass>::visitRefTailAddrInst(RefTailAddrInst *Inst) {
+  getBuilder().setCurrentDebugScope(getOpScope(Inst->getDebugScope()));
+  doPostProcess(Inst,
+    getBuilder().createRefTailAddr(getOpLocation(Inst->getLoc()),
+                                   getOpValue(Inst->getOperand()),
+                                   getOpType(Inst->getType())));
+}
+
 template<typename ImplClass>
 void
 SILCloner<ImplClass>::visitClassMethodInst(ClassMethodInst *Inst) {
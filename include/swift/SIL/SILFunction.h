@@ -142,6 +142,10 @@ private:
   /// The function's effects attribute.
   EffectsKind EffectsKindAttr;
 
+  /// The number of times this function was called in a profiled run, if it
+  /// was compiled with -profile-use and the profile has data for it.
+  Optional<uint64_t> EntryCount;
+
   /// True if this function is inlined at least once. This means that the
   /// debug info keeps a pointer to this function.
   bool Inlined = false;
@@ -462,6 +466,11 @@ public:
   bool isGlobalInit() const { return GlobalInitFlag; }
   void setGlobalInit(bool isGI) { GlobalInitFlag = isGI; }
 
+  /// Returns the number of times this function was called in a profiled run,
+  /// or None if there is no profile data for it.
+  Optional<uint64_t> getEntryCount() const { return EntryCount; }
+  void setEntryCount(Optional<uint64_t> Count) { EntryCount = Count; }
+
   bool isKeepAsPublic() const { return KeepAsPublic; }
   void setKeepAsPublic(bool keep) { KeepAsPublic = keep; }
 
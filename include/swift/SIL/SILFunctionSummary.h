@@ -0,0 +1,115 @@
+//===--- SILFunctionSummary.h - Serializable function summaries -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines SILFunctionSummary, a compact description of the side
+// effects of a function and of which memory reachable from its parameters may
+// escape.
+//
+// Summaries are computed for the public functions of a module before it is
+// serialized, and are looked up by SideEffectAnalysis and EscapeAnalysis in
+// client modules, which do not see the bodies of these functions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_SIL_SILFUNCTIONSUMMARY_H
+#define SWIFT_SIL_SILFUNCTIONSUMMARY_H
+
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+
+namespace swift {
+
+class SILFunctionSummary {
+public:
+  /// The effects on the global memory or on the memory reachable from a
+  /// parameter.
+  enum EffectKind : uint8_t {
+    Reads = 1 << 0,
+    Writes = 1 << 1,
+    Retains = 1 << 2,
+    Releases = 1 << 3,
+    AllEffects = Reads | Writes | Retains | Releases
+  };
+
+  /// Effects which cannot be associated with any memory.
+  enum FlagKind : uint8_t {
+    AllocsObjects = 1 << 0,
+    Traps = 1 << 1,
+    ReadsRC = 1 << 2,
+    AllFlags = AllocsObjects | Traps | ReadsRC
+  };
+
+  /// The escape depth of a parameter from which no memory escapes.
+  ///
+  /// See getNoEscapeDepth().
+  static const unsigned NoEscapeUnlimited = 15;
+
+private:
+  struct Parameter {
+    uint8_t Effects : 4;
+    uint8_t NoEscapeDepth : 4;
+  };
+
+  uint8_t GlobalEffects = 0;
+  uint8_t Flags = 0;
+  llvm::SmallVector<Parameter, 4> Params;
+
+public:
+  SILFunctionSummary() {}
+
+  unsigned getGlobalEffects() const { return GlobalEffects; }
+  void setGlobalEffects(unsigned E) { GlobalEffects = E & AllEffects; }
+
+  unsigned getFlags() const { return Flags; }
+  void setFlags(unsigned F) { Flags = F & AllFlags; }
+
+  unsigned getNumParameters() const { return Params.size(); }
+
+  /// Appends a parameter to the summary.
+  void addParameter(unsigned Effects, unsigned NoEscapeDepth) {
+    Parameter P;
+    P.Effects = Effects & AllEffects;
+    P.NoEscapeDepth =
+        NoEscapeDepth < NoEscapeUnlimited ? NoEscapeDepth : NoEscapeUnlimited;
+    Params.push_back(P);
+  }
+
+  /// Returns the effects on the memory reachable from the parameter \p Idx.
+  unsigned getParameterEffects(unsigned Idx) const {
+    return Params[Idx].Effects;
+  }
+
+  /// Returns the number of levels of indirection, starting at the parameter
+  /// \p Idx itself, which are known not to escape.
+  ///
+  /// 0 means that the parameter value escapes; 1 means that the parameter
+  /// does not escape, but the memory it points to may; and so on. If nothing
+  /// reachable from the parameter escapes, returns NoEscapeUnlimited.
+  unsigned getNoEscapeDepth(unsigned Idx) const {
+    return Params[Idx].NoEscapeDepth;
+  }
+
+  /// Returns true if the summary does not say anything more than what is
+  /// assumed for a function without a summary.
+  bool isWorstCase() const {
+    if (GlobalEffects != AllEffects || Flags != AllFlags)
+      return false;
+    for (const Parameter &P : Params)
+      if (P.NoEscapeDepth != 0)
+        return false;
+    return true;
+  }
+};
+
+} // end namespace swift
+
+#endif
@@ -466,21 +466,47 @@ public:
 /// AllocRefInst - This represents the primitive allocation of an instance
 /// of a reference type. Aside from the reference count, the instance is
 /// returned uninitialized.
+///
+/// Optionally the instance is allocated with a tail-allocated array of
+/// elements, which is located after the stored properties of the class. The
+/// number of elements is the only operand of the instruction.
 class AllocRefInst : public AllocationInst, public StackPromotable {
   friend class SILBuilder;
   bool ObjC;
 
+  /// The type of the tail-allocated elements, or an invalid type if the
+  /// instance has no tail-allocated elements.
+  SILType TailType;
+
+  /// The number of tail-allocated elements, if there is a TailType.
+  TailAllocatedOperandList<0> Operands;
+
   AllocRefInst(SILDebugLocation *Loc, SILType type, SILFunction &F, bool objc,
-               bool canBeOnStack);
+               bool canBeOnStack, SILType TailType, ArrayRef<SILValue> Count);
 
 public:
 
-  ArrayRef<Operand> getAllOperands() const { return {}; }
-  MutableArrayRef<Operand> getAllOperands() { return {}; }
+  ArrayRef<Operand> getAllOperands() const { return Operands.asArray(); }
+  MutableArrayRef<Operand> getAllOperands() { return Operands.asArray(); }
 
   /// Whether to use Objective-C's allocation mechanism (+allocWithZone:).
   bool isObjC() const { return ObjC; }
 
+  /// Returns true if the instance is allocated with tail-allocated elements.
+  bool hasTailAllocatedElements() const { return bool(TailType); }
+
+  /// Returns the type of the tail-allocated elements.
+  SILType getTailAllocatedType() const {
+    assert(hasTailAllocatedElements());
+    return TailType;
+  }
+
+  /// Returns the number of tail-allocated elements, which is a Builtin.Word.
+  SILValue getTailAllocatedCount() const {
+    assert(hasTailAllocatedElements());
+    return Operands[0].get();
+  }
+
   static bool classof(const ValueBase *V) {
     return V->getKind() == ValueKind::AllocRefInst;
   }
@@ -2851,6 +2877,29 @@ public:
   }
 };
 
+/// RefTailAddrInst - Derive the address of the first tail-allocated element
+/// of a class instance, which was allocated by an alloc_ref with
+/// tail-allocated elements.
+class RefTailAddrInst
+  : public UnaryInstructionBase<ValueKind::RefTailAddrInst>
+{
+  friend class SILBuilder;
+
+  RefTailAddrInst(SILDebugLocation *DebugLoc, SILValue Operand,
+                  SILType ResultTy)
+      : UnaryInstructionBase(DebugLoc, Operand, ResultTy) {}
+
+public:
+  ClassDecl *getClassDecl() const {
+    auto s = getOperand()->getType().getClassOrBoundGenericClass();
+    assert(s);
+    return s;
+  }
+
+  /// Returns the type of the tail-allocated elements.
+  SILType getTailType() const { return getType().getObjectType(); }
+};
+
 /// MethodInst - Abstract base for instructions that implement dynamic
 /// method lookup.
 class MethodInst : public SILInstruction {
@@ -27,6 +27,7 @@
 #include "swift/SIL/SILDeclRef.h"
 #include "swift/SIL/SILDefaultWitnessTable.h"
 #include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILFunctionSummary.h"
 #include "swift/SIL/SILGlobalVariable.h"
 #include "swift/SIL/Notifications.h"
 #include "swift/SIL/SILType.h"
@@ -37,6 +38,8 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
@@ -175,6 +178,27 @@ private:
   /// constructed. In certain cases this was before all Modules had been loaded
   /// causing us to not
   std::unique_ptr<SerializedSILLoader> SILLoader;
+
+  /// The summaries of the functions of this module, which are serialized so
+  /// that other modules can use them in place of the function bodies.
+  llvm::StringMap<SILFunctionSummary> FunctionSummaries;
+
+  /// The summaries looked up in other modules, keyed by function name. Holds
+  /// None for functions without a summary.
+  llvm::StringMap<Optional<SILFunctionSummary>> ImportedFunctionSummaries;
+
+  /// The names of specializations exported by this module whose definitions
+  /// are not in this SILModule, e.g. because they were listed by the partial
+  /// modules it is merged from.
+  llvm::StringSet<> ExportedSpecializationNames;
+
+  /// The stream to which optimization remarks are written. It is opened the
+  /// first time a remark is emitted.
+  std::unique_ptr<llvm::raw_ostream> OptRecordStream;
+
+  /// True if the optimization record file could not be opened. No more
+  /// remarks are recorded in this case.
+  bool OptRecordStreamFailed = false;
   
   /// True if this SILModule really contains the whole module, i.e.
   /// optimizations can assume that they see the whole module.
@@ -421,6 +445,53 @@ public:
   bool linkFunction(StringRef Name,
                     LinkingMode LinkAll = LinkingMode::LinkNormal);
 
+  /// Set the summary of the function \p Name of this module, which is
+  /// serialized together with the module.
+  void setFunctionSummary(StringRef Name, const SILFunctionSummary &Summary) {
+    FunctionSummaries[Name] = Summary;
+  }
+
+  /// Returns the summaries of the functions of this module.
+  const llvm::StringMap<SILFunctionSummary> &getFunctionSummaries() const {
+    return FunctionSummaries;
+  }
+
+  /// Look for the summary of the external function \p F in the modules
+  /// imported by this module.
+  ///
+  /// \return null if \p F has a body or no summary was serialized for it
+  const SILFunctionSummary *lookUpFunctionSummary(SILFunction *F);
+
+  /// Records that this module exports the specialization \p Name, which is
+  /// defined in another object file of the module.
+  void addExportedSpecializationName(StringRef Name) {
+    ExportedSpecializationNames.insert(Name);
+  }
+
+  /// Returns the names of the specializations exported by this module, in
+  /// sorted order.
+  ///
+  /// These are the public specializations which were kept public, and the
+  /// ones added by addExportedSpecializationName.
+  std::vector<StringRef> getExportedSpecializationNames() const;
+
+  /// Returns true if an imported module exports the specialization \p Name.
+  ///
+  /// Such specializations are public, but are not serialized with their
+  /// module; a declaration has to be created to refer to them.
+  bool hasExportedSpecialization(StringRef Name);
+
+  /// Returns true if optimization remarks are recorded for this module.
+  bool isOptRecordEnabled() const {
+    return !Options.OptRecordFile.empty() && !OptRecordStreamFailed;
+  }
+
+  /// Returns the stream to which optimization remarks are written.
+  ///
+  /// \return null if SILOptions::OptRecordFile is not set or the file could
+  /// not be opened
+  llvm::raw_ostream *getOptRecordStream();
+
   /// Link in all Witness Tables in the module.
   void linkAllWitnessTables();
 
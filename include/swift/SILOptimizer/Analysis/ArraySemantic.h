@@ -21,6 +21,10 @@ class DominanceInfo;
 
 /// The kind of array operation identified by looking at the semantics attribute
 /// of the called function.
+///
+/// The copy-on-write operations of other containers, which are annotated with
+/// "cow.make_unique" and "cow.mutate_unknown", map to kMakeMutable and
+/// kMutateUnknown. They are only matched if "cow." is passed explicitly.
 enum class ArrayCallKind {
   kNone = 0,
   kArrayPropsIsNativeTypeChecked,
@@ -215,12 +215,12 @@ protected:
              "already added callees at the begin of visiting a function");
       numVisited++;
       FInfo->StateAndPosition = FunctionInfoBase<FunctionInfo>::Visited;
-      if (FInfo->isValid()) {
-        // Now it's good time to remove invalid caller entries.
-        // Note: we don't have to do this for function which are recomputed.
-        FInfo->removeInvalidCallers();
+      // Now it's good time to remove invalid caller entries. Functions which
+      // are recomputed may still have callers, if they were invalidated with
+      // invalidateKeepingCallers().
+      FInfo->removeInvalidCallers();
+      if (FInfo->isValid())
         return true;
-      }
       InitiallyUnscheduled.push_back(FInfo);
       // Set to valid.
       FInfo->UpdateID = CurrentUpdateID;
@@ -306,6 +306,31 @@ protected:
       FInfo->UpdateID = 0;
     }
   }
+
+  /// Invalidates \p FInfo, but not the analysis data of its callers.
+  ///
+  /// The data which the callers were computed from must be kept by the
+  /// caller of this function, because the callers are only correct as long
+  /// as the recomputed data of \p FInfo is not worse than it. If it is,
+  /// invalidateCallers() must be called after the recomputation.
+  template<typename FunctionInfo>
+  void invalidateKeepingCallers(FunctionInfo *FInfo) {
+    FInfo->UpdateID = 0;
+  }
+
+  /// Invalidates all callers of \p FInfo, including their callers, but not
+  /// \p FInfo itself.
+  template<typename FunctionInfo>
+  void invalidateCallers(FunctionInfo *FInfo) {
+    // In case of recursion, invalidating the callers may also invalidate
+    // FInfo and clear its caller list.
+    auto Callers = FInfo->Callers;
+    FInfo->Callers.clear();
+    for (const auto &E : Callers) {
+      if (E.isValid() && E.Caller->isValid())
+        invalidateIncludingAllCallers(E.Caller);
+    }
+  }
 };
 
 } // end namespace swift
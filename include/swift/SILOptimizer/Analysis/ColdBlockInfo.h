@@ -14,9 +14,11 @@
 #define SWIFT_SILOPTIMIZER_ANALYSIS_COLDBLOCKS_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 
 namespace swift {
 class DominanceAnalysis;
+class DominanceInfo;
 class SILBasicBlock;
 
 /// Cache a set of basic blocks that have been determined to be cold or hot.
@@ -38,6 +40,13 @@ public:
 
   static bool isSlowPath(const SILBasicBlock *FromBB, const SILBasicBlock *ToBB);
 
+  /// Returns the -profile-use count of the closest block dominating \p BB,
+  /// including \p BB itself, that has one, or None if there is none.
+  ///
+  /// This is only an estimate of how often \p BB itself is executed.
+  static Optional<uint64_t> getProfileCount(const SILBasicBlock *BB,
+                                            DominanceInfo *DT);
+
   bool isCold(const SILBasicBlock *BB);
 };
 } // end namespace swift
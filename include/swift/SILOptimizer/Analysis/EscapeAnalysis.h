@@ -598,10 +598,21 @@ private:
     /// them again.
     bool NeedUpdateSummaryGraph = true;
 
+    /// True if the function is in PendingFunctions. Until the function is
+    /// recomputed, SummaryGraph is the summary graph which the callers were
+    /// computed with.
+    bool IsPending = false;
+
+    /// Set when recomputing a pending function, if merging the new graph
+    /// into the old summary graph changed it.
+    bool SummaryGraphGotWorse = false;
+
     /// Clears the analysis data on invalidation.
     void clear() {
       Graph.clear();
       SummaryGraph.clear();
+      IsPending = false;
+      SummaryGraphGotWorse = false;
     }
   };
 
@@ -636,6 +647,11 @@ private:
 
   /// Callee analysis, used for determining the callees at call sites.
   BasicCalleeAnalysis *BCA;
+
+  /// Functions which were invalidated without invalidating their callers.
+  /// Their callers stay valid if the recomputed summary graph does not add
+  /// anything to the old one.
+  llvm::SmallVector<FunctionInfo *, 16> PendingFunctions;
   
   /// Returns true if \p V is a "pointer" value.
   /// See EscapeAnalysis::NodeType::Value.
@@ -683,12 +699,23 @@ private:
   /// all called functions, up to a recursion depth of MaxRecursionDepth.
   void recompute(FunctionInfo *Initial);
 
+  /// Recomputes the functions in PendingFunctions and invalidates the callers
+  /// of those whose summary graph got worse.
+  void updatePendingFunctions();
+
   /// Merges the graph of a callee function into the graph of
   /// a caller function, whereas \p FAS is the call-site.
   bool mergeCalleeGraph(FullApplySite FAS,
                         ConnectionGraph *CallerGraph,
                         ConnectionGraph *CalleeGraph);
 
+  /// Updates the caller graph for a call to an external function \p FAS,
+  /// using the \p Summary which was serialized into the callee's module.
+  /// Returns false if the summary cannot be used for the call.
+  bool mergeFunctionSummary(FullApplySite FAS,
+                            const SILFunctionSummary *Summary,
+                            ConnectionGraph *CallerGraph);
+
   /// Merge the \p Graph into \p SummaryGraph.
   bool mergeSummaryGraph(ConnectionGraph *SummaryGraph,
                          ConnectionGraph *Graph);
@@ -711,6 +738,8 @@ public:
 
   /// Gets the connection graph for \a F.
   ConnectionGraph *getConnectionGraph(SILFunction *F) {
+    if (!PendingFunctions.empty())
+      updatePendingFunctions();
     FunctionInfo *FInfo = getFunctionInfo(F);
     if (!FInfo->isValid())
       recompute(FInfo);
@@ -748,6 +777,11 @@ public:
   bool canParameterEscape(FullApplySite FAS, int ParamIdx,
                           bool checkContentOfIndirectParam);
 
+  /// Returns the number of levels of indirection, starting at the parameter
+  /// \p ParamIdx of \p F itself, which do not escape in \p F.
+  /// See SILFunctionSummary::getNoEscapeDepth().
+  unsigned getParameterNoEscapeDepth(SILFunction *F, unsigned ParamIdx);
+
   /// Returns true if the pointers \p V1 and \p V2 can possibly point to the
   /// same memory.
   /// If at least one of the pointers refers to a local object and the
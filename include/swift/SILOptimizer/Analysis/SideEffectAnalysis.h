@@ -287,15 +287,26 @@ private:
     /// Back-link to the function.
     SILFunction *F;
 
+    /// The side-effects which the callers were computed with, if the function
+    /// was invalidated with invalidateKeepingCallers().
+    FunctionEffects OldFE;
+
     /// Used during recomputation to indicate if the side-effects of a caller
     /// must be updated.
     bool NeedUpdateCallers = false;
 
+    /// True if the function is in PendingFunctions.
+    bool IsPending = false;
+
     FunctionInfo(SILFunction *F) :
       FE(F->empty() ? 0 : F->getArguments().size()), F(F) { }
 
     /// Clears the analysis data on invalidation.
-    void clear() { FE.clear(); }
+    void clear() {
+      FE.clear();
+      OldFE = FunctionEffects();
+      IsPending = false;
+    }
   };
   
   typedef BottomUpFunctionOrder<FunctionInfo> FunctionOrder;
@@ -318,9 +329,19 @@ private:
   /// Callee analysis, used for determining the callees at call sites.
   BasicCalleeAnalysis *BCA;
 
+  /// Functions which were invalidated without invalidating their callers.
+  /// Their callers stay valid if the recomputed side-effects are not worse
+  /// than the old ones.
+  llvm::SmallVector<FunctionInfo *, 16> PendingFunctions;
+
   /// Get the side-effects of a function, which has an @effects attribute.
   /// Returns true if \a F has an @effects attribute which could be handled.
   static bool getDefinedEffects(FunctionEffects &Effects, SILFunction *F);
+
+  /// Get the side-effects of an external function from the summary which was
+  /// serialized into its module.
+  /// Returns true if \p F has a summary which matches its parameters.
+  static bool getSummaryEffects(FunctionEffects &Effects, SILFunction *F);
   
   /// Get the side-effects of a semantic call.
   /// Return true if \p ASC could be handled.
@@ -354,6 +375,10 @@ private:
   /// all called functions, up to a recursion depth of MaxRecursionDepth.
   void recompute(FunctionInfo *Initial);
 
+  /// Recomputes the functions in PendingFunctions and invalidates the callers
+  /// of those whose side-effects got worse.
+  void updatePendingFunctions();
+
 public:
   SideEffectAnalysis()
       : BottomUpIPAnalysis(AnalysisKind::SideEffect) {}
@@ -366,6 +391,8 @@ public:
   
   /// Get the side-effects of a function.
   const FunctionEffects &getEffects(SILFunction *F) {
+    if (!PendingFunctions.empty())
+      updatePendingFunctions();
     FunctionInfo *FInfo = getFunctionInfo(F);
     if (!FInfo->isValid())
       recompute(FInfo);
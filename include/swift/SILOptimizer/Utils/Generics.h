@@ -39,7 +39,13 @@ bool isWhitelistedSpecialization(StringRef SpecName);
 /// function being applied.
 ApplySite replaceWithSpecializedFunction(ApplySite AI, SILFunction *NewF);
 
-SILFunction *getExistingSpecialization(SILModule &M, StringRef FunctionName);
+/// Look up the specialization \p FunctionName, which has the type \p FnTy,
+/// in the standard library or in the specializations exported by imported
+/// modules.
+///
+/// \returns a public external declaration of the specialization, or null
+SILFunction *getExistingSpecialization(SILModule &M, StringRef FunctionName,
+                                       CanSILFunctionType FnTy);
 
 } // end namespace swift
 
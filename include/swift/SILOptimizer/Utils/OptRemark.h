@@ -0,0 +1,102 @@
+//===--- OptRemark.h - Remarks about SIL optimizations ----------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines OptRemark, a record of an optimization which a pass
+// performed or tried to perform at an instruction, together with the reason
+// why it failed.
+//
+// Remarks are written as YAML documents to the file given with
+// -save-optimization-record-path. They let users find out why a call stayed
+// dynamic, unspecialized or was not inlined without reading the debug output
+// of the passes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_SILOPTIMIZER_UTILS_OPTREMARK_H
+#define SWIFT_SILOPTIMIZER_UTILS_OPTREMARK_H
+
+#include "swift/SIL/SILInstruction.h"
+#include "swift/SIL/SILModule.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+namespace swift {
+
+class OptRemark {
+public:
+  enum class Kind {
+    /// The optimization was performed.
+    Passed,
+    /// The optimization was not possible or not profitable.
+    Missed
+  };
+
+private:
+  struct Argument {
+    std::string Key;
+    std::string Value;
+    bool IsString;
+  };
+
+  Kind K;
+  std::string PassName;
+  std::string Name;
+  SILFunction *F;
+  SILLocation Loc;
+  llvm::SmallVector<Argument, 4> Args;
+
+public:
+  /// Creates a remark of the pass \p PassName about the instruction \p I.
+  /// \p Name identifies the kind of the remark, e.g. the reason for a missed
+  /// optimization. The remark stays valid if \p I is deleted afterwards.
+  OptRemark(Kind K, StringRef PassName, StringRef Name, SILInstruction *I)
+    : K(K), PassName(PassName), Name(Name), F(I->getFunction()),
+      Loc(I->getLoc()) {}
+
+  static OptRemark passed(StringRef PassName, StringRef Name,
+                          SILInstruction *I) {
+    return OptRemark(Kind::Passed, PassName, Name, I);
+  }
+
+  static OptRemark missed(StringRef PassName, StringRef Name,
+                          SILInstruction *I) {
+    return OptRemark(Kind::Missed, PassName, Name, I);
+  }
+
+  /// Returns true if remarks are recorded for the module \p M. Passes should
+  /// check this before they do any extra work to compute a remark.
+  static bool isEnabled(SILModule &M) {
+    return M.isOptRecordEnabled();
+  }
+
+  OptRemark &arg(StringRef Key, StringRef Value) {
+    Args.push_back({Key, Value, true});
+    return *this;
+  }
+
+  OptRemark &arg(StringRef Key, uint64_t Value) {
+    Args.push_back({Key, std::to_string(Value), false});
+    return *this;
+  }
+
+  /// Prints the remark as a YAML document.
+  void print(llvm::raw_ostream &OS) const;
+
+  /// Writes the remark to the optimization record of the module, if any.
+  void emit() const;
+};
+
+} // end namespace swift
+
+#endif
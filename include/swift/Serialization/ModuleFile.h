@@ -74,6 +74,9 @@ class ModuleFile : public LazyMemberLoader {
   /// The target the module was built for.
   StringRef TargetTriple;
 
+  /// The hash of the module's interface, or empty if it has none.
+  StringRef InterfaceHash;
+
   /// The data blob containing all of the module's identifiers.
   StringRef IdentifierData;
 
@@ -596,6 +599,12 @@ public:
     return TargetTriple;
   }
 
+  /// Returns the hash of the module's interface, as stored in the serialized
+  /// data, or an empty string if the module has none.
+  StringRef getInterfaceHash() const {
+    return InterfaceHash;
+  }
+
   /// AST-verify imported decls.
   ///
   /// Has no effect in NDEBUG builds.
@@ -52,7 +52,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// in source control, you should also update the comment to briefly
 /// describe what change you made. The content of this comment isn't important;
 /// it just ensures a conflict if two people change the module format.
-const uint16_t VERSION_MINOR = 238; // SILValue changes
+const uint16_t VERSION_MINOR = 242; // tail-allocated elements
 
 using DeclID = Fixnum<31>;
 using DeclIDField = BCFixed<31>;
@@ -407,7 +407,8 @@ namespace control_block {
   enum {
     METADATA = 1,
     MODULE_NAME,
-    TARGET
+    TARGET,
+    INTERFACE_HASH
   };
 
   using MetadataLayout = BCRecordLayout<
@@ -426,6 +427,11 @@ namespace control_block {
     TARGET,
     BCBlob // LLVM triple
   >;
+
+  using InterfaceHashLayout = BCRecordLayout<
+    INTERFACE_HASH,
+    BCBlob // hash of everything a client can depend on, as hex digits
+  >;
 }
 
 /// The record types within the options block (a sub-block of the control
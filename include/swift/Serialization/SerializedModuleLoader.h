@@ -158,6 +158,10 @@ public:
 
   virtual StringRef getFilename() const override;
 
+  /// Returns the hash of the module's interface, or an empty string if the
+  /// module has none.
+  StringRef getInterfaceHash() const;
+
   ClassDecl *getMainClass() const override;
 
   bool hasEntryPoint() const override;
@@ -16,6 +16,7 @@
 #include "swift/AST/Decl.h"
 #include "swift/AST/Identifier.h"
 #include "swift/SIL/SILDeclRef.h"
+#include "swift/SIL/SILFunctionSummary.h"
 #include <memory>
 #include <vector>
 
@@ -87,6 +88,8 @@ public:
     return lookupVTable(C->getName());
   }
   SILWitnessTable *lookupWitnessTable(SILWitnessTable *C);
+  Optional<SILFunctionSummary> lookupFunctionSummary(StringRef Name);
+  bool hasSpecialization(StringRef Name);
 
   /// Invalidate the cached entries for deserialized SILFunctions.
   void invalidateCaches();
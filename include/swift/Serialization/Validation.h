@@ -67,6 +67,10 @@ namespace serialization {
   struct ValidationInfo {
     StringRef name = {};
     StringRef targetTriple = {};
+    /// A hash of the module's interface, or empty if the module does not
+    /// carry one. Changes to private declarations and to the bodies of
+    /// functions that cannot be inlined into clients do not change it.
+    StringRef interfaceHash = {};
     size_t bytes = 0;
     Status status = Status::Malformed;
   };
@@ -798,6 +798,12 @@ private:
         if (!result)
           return nullptr;
         param->addChild(result);
+      } else if (Mangled.nextIf('e')) {
+        NodePointer type = demangleType();
+        if (!type || !Mangled.nextIf('_'))
+          return nullptr;
+        param->addChild(FUNCSIGSPEC_CREATE_PARAM_KIND(ExistentialToConcrete));
+        param->addChild(type);
       } else {
         // Otherwise handle option sets.
         unsigned Value = 0;
@@ -2694,6 +2700,13 @@ unsigned NodePrinter::printFunctionSigSpecializationParam(NodePointer pointer,
     Printer << "'";
     Printer << "]";
     return Idx;
+  case FunctionSigSpecializationParamKind::ExistentialToConcrete:
+    Printer << "[";
+    print(pointer->getChild(Idx++));
+    Printer << " : ";
+    print(pointer->getChild(Idx++));
+    Printer << "]";
+    return Idx;
   case FunctionSigSpecializationParamKind::ClosureProp:
     Printer << "[";
     print(pointer->getChild(Idx++));
@@ -3147,6 +3160,9 @@ void NodePrinter::print(NodePointer pointer, bool asContext, bool suppressType)
     case FunctionSigSpecializationParamKind::ClosureProp:
       Printer << "Closure Propagated";
       break;
+    case FunctionSigSpecializationParamKind::ExistentialToConcrete:
+      Printer << "Existential To Concrete";
+      break;
     case FunctionSigSpecializationParamKind::Dead:
     case FunctionSigSpecializationParamKind::OwnedToGuaranteed:
     case FunctionSigSpecializationParamKind::SROA:
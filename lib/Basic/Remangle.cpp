@@ -530,6 +530,11 @@ void Remangler::mangleFunctionSignatureSpecializationParam(Node *node) {
   case FunctionSigSpecializationParamKind::BoxToStack:
     Out << "k_";
     return;
+  case FunctionSigSpecializationParamKind::ExistentialToConcrete:
+    Out << 'e';
+    mangleType(node->getChild(1).get());
+    Out << '_';
+    return;
   default:
     if (kindValue &
         unsigned(FunctionSigSpecializationParamKind::Dead))
@@ -0,0 +1,176 @@
+//===--- Statistics.cpp - Machine-readable compilation statistics ---------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/Statistics.h"
+#include "swift/Basic/JSONSerialization.h"
+#include "swift/Basic/TraceEvents.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <tuple>
+
+#if LLVM_ON_UNIX
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+#endif
+
+using namespace swift;
+
+namespace swift {
+namespace json {
+  template<>
+  struct ObjectTraits<std::map<std::string, uint64_t>> {
+    static void mapping(Output &out, std::map<std::string, uint64_t> &map) {
+      for (auto &entry : map)
+        out.mapRequired(entry.first.c_str(), entry.second);
+    }
+  };
+}
+}
+
+void CompilerStatistics::max(StringRef name, uint64_t value) {
+  uint64_t &counter = Counters[name];
+  counter = std::max(counter, value);
+}
+
+void CompilerStatistics::addPhaseTimes() {
+  // Regions with the same name are added up, even if one is nested in another.
+  for (const TraceEvent &event : TraceEvents::getEvents())
+    add("time." + event.Name + ".us", event.Duration);
+}
+
+void CompilerStatistics::addLLVMStatistics() {
+  std::string buffer;
+  {
+    llvm::raw_string_ostream out(buffer);
+    llvm::PrintStatistics(out);
+  }
+
+  // Each statistic is printed on its own line, as
+  //   <value> <debug type> - <description>
+  // with padding between the fields.
+  SmallVector<StringRef, 64> lines;
+  StringRef(buffer).split(lines, "\n", /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (StringRef line : lines) {
+    StringRef valueStr, rest;
+    std::tie(valueStr, rest) = line.ltrim().split(' ');
+    uint64_t value;
+    if (valueStr.getAsInteger(10, value))
+      continue;
+
+    size_t separator = rest.find(" - ");
+    if (separator == StringRef::npos)
+      continue;
+    StringRef debugType = rest.slice(0, separator).trim();
+    StringRef description = rest.drop_front(separator + 3).trim();
+    add(("LLVM." + debugType + "." + description).str(), value);
+  }
+}
+
+void CompilerStatistics::addPeakMemoryUsage() {
+#if LLVM_ON_UNIX && HAVE_SYS_RESOURCE_H
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return;
+#if defined(__APPLE__)
+  // Darwin reports bytes...
+  uint64_t peak = usage.ru_maxrss;
+#else
+  // ...while everyone else reports kilobytes.
+  uint64_t peak = uint64_t(usage.ru_maxrss) * 1024;
+#endif
+  max("Memory.PeakResidentBytes", peak);
+#endif
+}
+
+bool CompilerStatistics::addFromFile(StringRef path) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return true;
+
+  // JSON is a subset of YAML, which LLVM already knows how to parse.
+  namespace yaml = llvm::yaml;
+  llvm::SourceMgr SM;
+  yaml::Stream stream(buffer.get()->getMemBufferRef(), SM);
+
+  auto I = stream.begin();
+  if (I == stream.end() || !I->getRoot())
+    return true;
+
+  auto *topLevelMap = dyn_cast<yaml::MappingNode>(I->getRoot());
+  if (!topLevelMap)
+    return true;
+
+  SmallString<64> keyScratch;
+  SmallString<64> valueScratch;
+  // FIXME: LLVM's YAML support does incremental parsing in such a way that
+  // for-range loops break.
+  for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
+    auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+    auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+    if (!key || !value)
+      return true;
+
+    uint64_t parsedValue;
+    if (value->getValue(valueScratch).getAsInteger(10, parsedValue))
+      return true;
+
+    StringRef name = key->getValue(keyScratch);
+    if (name.find("Largest") != StringRef::npos ||
+        name.find("Peak") != StringRef::npos)
+      max(name, parsedValue);
+    else
+      add(name, parsedValue);
+  }
+
+  return false;
+}
+
+std::error_code CompilerStatistics::write(StringRef path) const {
+  std::error_code EC =
+      llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path));
+  if (EC)
+    return EC;
+
+  llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return EC;
+
+  auto counters = Counters;
+  json::Output out(os);
+  out << counters;
+  os << "\n";
+  return std::error_code();
+}
+
+std::string CompilerStatistics::getOutputFilePrefix(StringRef kind,
+                                                    uint64_t processID) {
+  return ("stats-" + kind + "-" + Twine(processID) + "-").str();
+}
+
+std::string CompilerStatistics::getOutputPath(StringRef dir, StringRef kind,
+                                              uint64_t processID,
+                                              StringRef label) {
+  SmallString<128> path = dir;
+  llvm::sys::path::append(path, Twine(getOutputFilePrefix(kind, processID)) +
+                                  llvm::sys::path::filename(label) + ".json");
+  return path.str();
+}
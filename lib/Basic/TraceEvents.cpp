@@ -0,0 +1,169 @@
+//===--- TraceEvents.cpp - Chrome trace events for compilations -----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/TraceEvents.h"
+#include "swift/Basic/JSONSerialization.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if LLVM_ON_UNIX
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <pthread.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+using namespace swift;
+
+bool TraceEvents::Enabled = false;
+
+namespace {
+  /// The "args" member of an event, which chrome://tracing shows when the
+  /// event is selected.
+  struct TraceEventArgs {
+    std::string File;
+  };
+}
+
+namespace swift {
+namespace json {
+  template<>
+  struct ObjectTraits<TraceEventArgs> {
+    static void mapping(Output &out, TraceEventArgs &args) {
+      out.mapRequired("file", args.File);
+    }
+  };
+
+  template<>
+  struct ObjectTraits<TraceEvent> {
+    static void mapping(Output &out, TraceEvent &event) {
+      // All events are "complete" events, which carry their own duration.
+      std::string phase = "X";
+      TraceEventArgs args{event.File};
+
+      out.mapRequired("name", event.Name);
+      out.mapRequired("cat", event.Category);
+      out.mapRequired("ph", phase);
+      out.mapRequired("ts", event.Start);
+      out.mapRequired("dur", event.Duration);
+      out.mapRequired("pid", event.ProcessID);
+      out.mapRequired("tid", event.ThreadID);
+      out.mapRequired("args", args);
+    }
+  };
+}
+}
+
+namespace {
+  /// The events recorded by this process, which may come from several
+  /// threads.
+  struct RecordedEvents {
+    std::mutex Lock;
+    std::vector<TraceEvent> Events;
+  };
+}
+
+static RecordedEvents &getRecordedEvents() {
+  static RecordedEvents recorded;
+  return recorded;
+}
+
+std::vector<TraceEvent> TraceEvents::getEvents() {
+  auto &recorded = getRecordedEvents();
+  std::lock_guard<std::mutex> guard(recorded.Lock);
+  return recorded.Events;
+}
+
+uint64_t TraceEvents::now() {
+  using namespace std::chrono;
+  auto sinceEpoch = system_clock::now().time_since_epoch();
+  return duration_cast<microseconds>(sinceEpoch).count();
+}
+
+uint64_t TraceEvents::getCurrentProcessID() {
+#if LLVM_ON_UNIX && HAVE_UNISTD_H
+  return ::getpid();
+#else
+  return 0;
+#endif
+}
+
+uint64_t TraceEvents::getCurrentThreadID() {
+#if LLVM_ON_UNIX && defined(__APPLE__)
+  uint64_t tid = 0;
+  pthread_threadid_np(nullptr, &tid);
+  return tid;
+#elif LLVM_ON_UNIX && defined(__linux__)
+  return ::syscall(SYS_gettid);
+#else
+  return std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+void TraceEvents::record(StringRef name, uint64_t start) {
+  TraceEvent event;
+  event.Name = name;
+  event.Category = "frontend";
+  event.Start = start;
+  event.Duration = now() - start;
+  event.ProcessID = getCurrentProcessID();
+  event.ThreadID = getCurrentThreadID();
+
+  auto &recorded = getRecordedEvents();
+  std::lock_guard<std::mutex> guard(recorded.Lock);
+  recorded.Events.push_back(std::move(event));
+}
+
+void TraceEvents::writeEvent(raw_ostream &os, const TraceEvent &event) {
+  TraceEvent copy = event;
+  json::Output out(os, /*PrettyPrint=*/false);
+  out << copy;
+}
+
+std::error_code TraceEvents::writeRecordedEvents(StringRef path,
+                                                 StringRef file) {
+  std::error_code EC;
+  llvm::raw_fd_ostream os(path, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return EC;
+
+  // SharedTimers are recorded when they end, so enclosing regions come after
+  // the regions they contain. Keep the output in start order instead.
+  std::vector<TraceEvent> events = getEvents();
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent &lhs, const TraceEvent &rhs) {
+    return lhs.Start < rhs.Start;
+  });
+
+  os << "[\n";
+  bool first = true;
+  for (TraceEvent &event : events) {
+    if (!first)
+      os << ",\n";
+    first = false;
+    event.File = file;
+    writeEvent(os, event);
+  }
+  os << "\n]\n";
+  return std::error_code();
+}
@@ -16,10 +16,16 @@
 #include "swift/AST/DiagnosticsDriver.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Program.h"
+#include "swift/Basic/STLExtras.h"
+#include "swift/Basic/Statistics.h"
 #include "swift/Basic/TaskQueue.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/type_traits.h"
+#include "swift/Serialization/Validation.h"
+#include "swift/Strings.h"
 #include "swift/Driver/Action.h"
+#include "swift/Driver/CompilationCache.h"
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Driver/Driver.h"
 #include "swift/Driver/Job.h"
@@ -31,10 +37,13 @@
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/YAMLParser.h"
 
+#include <algorithm>
+
 using namespace swift;
 using namespace swift::sys;
 using namespace swift::driver;
@@ -88,6 +97,10 @@ namespace {
 
 Compilation::~Compilation() = default;
 
+void Compilation::setCompilationCache(std::unique_ptr<CompilationCache> cache) {
+  Cache = std::move(cache);
+}
+
 Job *Compilation::addJob(std::unique_ptr<Job> J) {
   Job *result = J.get();
   Jobs.emplace_back(std::move(J));
@@ -174,7 +187,9 @@ static void checkForOutOfDateInputs(DiagnosticEngine &diags,
 
 static void writeCompilationRecord(StringRef path, StringRef argsHash,
                                    llvm::sys::TimeValue buildTime,
-                                   const InputInfoMap &inputs) {
+                                   const InputInfoMap &inputs,
+                                   const llvm::StringMap<std::string> &
+                                     externalInterfaceHashes) {
   std::error_code error;
   llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
   if (out.has_error()) {
@@ -213,6 +228,122 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
     writeTimeValue(out, entry.second.previousModTime);
     out << "\n";
   }
+
+  bool wroteHeader = false;
+  for (auto &entry : externalInterfaceHashes) {
+    if (entry.getValue().empty())
+      continue;
+    if (!wroteHeader)
+      out << "external_interface_hashes:\n";
+    wroteHeader = true;
+    out << "  \"" << llvm::yaml::escape(entry.getKey()) << "\": \""
+        << llvm::yaml::escape(entry.getValue()) << "\"\n";
+  }
+}
+
+/// Returns the interface hash of the serialized module at \p path, or an empty
+/// string if the file is not a module or the module does not have one.
+static std::string readInterfaceHash(StringRef path) {
+  if (llvm::sys::path::extension(path).drop_front() !=
+        SERIALIZED_MODULE_EXTENSION)
+    return "";
+
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return "";
+
+  auto info =
+      serialization::validateSerializedAST(buffer.get()->getBuffer());
+  if (info.status != serialization::Status::Valid)
+    return "";
+  return info.interfaceHash;
+}
+
+/// Adds the statistics written to \p dir by the frontend jobs that ran as
+/// \p processes during the build that started at \p buildStartTime.
+///
+/// \returns the number of statistics files that were found.
+static unsigned
+addFrontendStatistics(CompilerStatistics &stats, StringRef dir,
+                      ArrayRef<ProcessId> processes,
+                      llvm::sys::TimeValue buildStartTime) {
+  llvm::SmallDenseSet<ProcessId, 16> processSet;
+  for (ProcessId pid : processes)
+    processSet.insert(pid);
+  std::string kindPrefix = "stats-frontend-";
+  unsigned numFiles = 0;
+
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator I(dir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    StringRef path = I->path();
+    StringRef name = llvm::sys::path::filename(path);
+    if (!name.startswith(kindPrefix))
+      continue;
+
+    ProcessId pid;
+    if (name.drop_front(kindPrefix.size()).split('-').first
+          .getAsInteger(10, pid))
+      continue;
+    if (!processSet.count(pid))
+      continue;
+
+    // Process IDs are reused, so ignore files left over from earlier builds.
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(path, status) ||
+        status.getLastModificationTime().seconds() < buildStartTime.seconds())
+      continue;
+
+    if (!stats.addFromFile(path))
+      ++numFiles;
+  }
+  return numFiles;
+}
+
+/// Appends the events written by a finished frontend job to \p events.
+///
+/// Trace files written by the frontend contain one event object per line, so
+/// they can be merged without having to parse them.
+static void collectFrontendTraceEvents(const Job *job,
+                                       std::vector<std::string> &events) {
+  StringRef path =
+    job->getOutput().getAdditionalOutputForType(types::TY_TraceEvents);
+  if (path.empty())
+    return;
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return;
+
+  SmallVector<StringRef, 16> lines;
+  buffer.get()->getBuffer().split(lines, "\n", /*MaxSplit=*/-1,
+                                  /*KeepEmpty=*/false);
+  for (StringRef line : lines) {
+    line = line.trim();
+    if (!line.startswith("{"))
+      continue;
+    if (line.endswith(","))
+      line = line.drop_back();
+    events.push_back(line);
+  }
+}
+
+static void writeTraceFile(DiagnosticEngine &diags, StringRef path,
+                           ArrayRef<std::string> events) {
+  std::error_code error;
+  llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
+  if (error) {
+    diags.diagnose(SourceLoc(), diag::warn_unable_to_write_trace, path,
+                   error.message());
+    return;
+  }
+
+  out << "[\n";
+  interleave(events,
+             [&](const std::string &event) { out << event; },
+             [&] { out << ",\n"; });
+  out << "\n]\n";
 }
 
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
@@ -262,11 +393,69 @@ int Compilation::performJobsImpl() {
 
   PerformJobsState State;
 
+  // When tracing, every job is recorded as an event spanning from when it
+  // began to when it finished, followed by the events of its own phases.
+  bool ShouldTrace = !TraceOutputPath.empty();
+  uint64_t TraceStartTime = ShouldTrace ? TraceEvents::now() : 0;
+  llvm::SmallDenseMap<const Job *, uint64_t, 16> JobStartTimes;
+  std::vector<std::string> CollectedTraceEvents;
+
+  auto traceJob = [&] (const Job *Cmd, ProcessId Pid) {
+    if (!ShouldTrace)
+      return;
+    auto StartIter = JobStartTimes.find(Cmd);
+    if (StartIter == JobStartTimes.end())
+      return;
+
+    TraceEvent Event;
+    Event.Name = Cmd->getSource().getClassName();
+    Event.Category = "job";
+    const CommandOutput &Output = Cmd->getOutput();
+    Event.File = Output.getBaseInput(0);
+    if (Event.File.empty() && !Output.getPrimaryOutputFilenames().empty())
+      Event.File = Output.getPrimaryOutputFilenames().front();
+    Event.Start = StartIter->second;
+    Event.Duration = TraceEvents::now() - Event.Start;
+    // The job ran on the main thread of its own process.
+    Event.ProcessID = Pid;
+    Event.ThreadID = Pid;
+
+    std::string Buffer;
+    llvm::raw_string_ostream OS(Buffer);
+    TraceEvents::writeEvent(OS, Event);
+    CollectedTraceEvents.push_back(OS.str());
+
+    collectFrontendTraceEvents(Cmd, CollectedTraceEvents);
+  };
+
+  // For -stats-output-dir, the processes that ran jobs, whose statistics are
+  // added up at the end of the build.
+  bool ShouldCollectStats = !StatsOutputPath.empty() && !SkipTaskExecution;
+  uint64_t StatsStartTime = ShouldCollectStats ? TraceEvents::now() : 0;
+  SmallVector<ProcessId, 16> FinishedProcesses;
+
+  // Jobs restored from the compilation cache, along with the output they
+  // printed when they ran. These are finished in between runs of the
+  // TaskQueue, as if they had just been executed.
+  CompilationCache *ActiveCache = SkipTaskExecution ? nullptr : Cache.get();
+  std::vector<std::pair<const Job *, std::string>> PendingRestoredCommands;
+  llvm::SmallPtrSet<const Job *, 16> RestoredCommands;
+
   using DependencyGraph = DependencyGraph<const Job *>;
   DependencyGraph DepGraph;
   SmallPtrSet<const Job *, 16> DeferredCommands;
   SmallVector<const Job *, 16> InitialOutOfDateCommands;
 
+  // The interface hashes of the modules the inputs depend on, as they are
+  // now. These are saved in the build record for the next build.
+  llvm::StringMap<std::string> ExternalInterfaceHashes;
+  auto getExternalInterfaceHash = [&](StringRef dependency) -> StringRef {
+    auto inserted = ExternalInterfaceHashes.insert({dependency, ""});
+    if (inserted.second)
+      inserted.first->getValue() = readInterfaceHash(dependency);
+    return inserted.first->getValue();
+  };
+
   DependencyGraph::MarkTracer ActualIncrementalTracer;
   DependencyGraph::MarkTracer *IncrementalTracer = nullptr;
   if (ShowIncrementalBuildDecisions)
@@ -307,6 +496,15 @@ int Compilation::performJobsImpl() {
     assert(Cmd->getExtraEnvironment().empty() &&
            "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
+
+    if (ActiveCache && CompilationCache::isCacheable(*Cmd)) {
+      if (auto PrintedOutput = ActiveCache->restore(*Cmd)) {
+        RestoredCommands.insert(Cmd);
+        PendingRestoredCommands.push_back({Cmd, std::move(*PrintedOutput)});
+        return;
+      }
+    }
+
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
                 (void *)Cmd);
   };
@@ -401,6 +599,19 @@ int Compilation::performJobsImpl() {
         if (depStatus.getLastModificationTime() < LastBuildTime)
           continue;
 
+      // A module that was rebuilt without changing its interface doesn't
+      // affect anything that depends on it.
+      StringRef interfaceHash = getExternalInterfaceHash(dependency);
+      if (!interfaceHash.empty() &&
+          interfaceHash == LastExternalInterfaceHashes.lookup(dependency)) {
+        if (ShowIncrementalBuildDecisions) {
+          llvm::outs() << "Interface of \""
+                       << llvm::sys::path::filename(dependency)
+                       << "\" is unchanged\n";
+        }
+        continue;
+      }
+
       // If the dependency has been modified since the oldest built file,
       // or if we can't stat it for some reason (perhaps it's been deleted?),
       // trigger rebuilds through the dependency graph.
@@ -425,10 +636,13 @@ int Compilation::performJobsImpl() {
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
 
+    if (ShouldTrace)
+      JobStartTimes[BeganCmd] = TraceEvents::now();
+
     // For verbose output, print out each command as it begins execution.
     if (Level == OutputLevel::Verbose)
       BeganCmd->printCommandLine(llvm::errs());
@@ -445,6 +659,11 @@ int Compilation::performJobsImpl() {
                            void *Context) -> TaskFinishedResponse {
     const Job *FinishedCmd = (const Job *)Context;
 
+    traceJob(FinishedCmd, Pid);
+
+    if (ShouldCollectStats && !RestoredCommands.count(FinishedCmd))
+      FinishedProcesses.push_back(Pid);
+
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
       parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
@@ -477,6 +696,11 @@ int Compilation::performJobsImpl() {
           TaskFinishedResponse::StopExecution;
     }
 
+    if (ActiveCache && !RestoredCommands.count(FinishedCmd) &&
+        CompilationCache::isCacheable(*FinishedCmd)) {
+      ActiveCache->store(*FinishedCmd, Output);
+    }
+
     // When a task finishes, we need to reevaluate the other commands that
     // might have been blocked.
     markFinished(FinishedCmd);
@@ -523,6 +747,8 @@ int Compilation::performJobsImpl() {
                             void *Context) -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
 
+    traceJob(SignalledCmd, Pid);
+
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
       parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
@@ -547,9 +773,26 @@ int Compilation::performJobsImpl() {
     return TaskFinishedResponse::StopExecution;
   };
 
+  // Restored jobs don't run, so they finish as soon as they've "begun". This
+  // may schedule (or restore) the jobs that were waiting for them.
+  auto finishRestoredCommands = [&] {
+    while (!PendingRestoredCommands.empty()) {
+      auto Restored = std::move(PendingRestoredCommands.back());
+      PendingRestoredCommands.pop_back();
+      if (Level == OutputLevel::Parseable)
+        parseable_output::emitBeganMessage(llvm::errs(), *Restored.first,
+                                           /*Pid=*/0);
+      taskFinished(/*Pid=*/0, EXIT_SUCCESS, Restored.second,
+                   (void *)Restored.first);
+    }
+  };
+
   do {
-    // Ask the TaskQueue to execute.
-    TQ->execute(taskBegan, taskFinished, taskSignalled);
+    // Ask the TaskQueue to execute, finishing any restored jobs first.
+    do {
+      finishRestoredCommands();
+      TQ->execute(taskBegan, taskFinished, taskSignalled);
+    } while (Result == 0 && !PendingRestoredCommands.empty());
 
     // Mark all remaining deferred commands as skipped.
     for (const Job *Cmd : DeferredCommands) {
@@ -591,12 +834,62 @@ int Compilation::performJobsImpl() {
     }
   }
 
+  if (ShouldTrace && !SkipTaskExecution) {
+    TraceEvent DriverEvent;
+    DriverEvent.Name = "swift";
+    DriverEvent.Category = "driver";
+    DriverEvent.File = TraceOutputPath;
+    DriverEvent.Start = TraceStartTime;
+    DriverEvent.Duration = TraceEvents::now() - TraceStartTime;
+    DriverEvent.ProcessID = TraceEvents::getCurrentProcessID();
+    DriverEvent.ThreadID = TraceEvents::getCurrentThreadID();
+
+    std::string Buffer;
+    llvm::raw_string_ostream OS(Buffer);
+    TraceEvents::writeEvent(OS, DriverEvent);
+    CollectedTraceEvents.insert(CollectedTraceEvents.begin(), OS.str());
+
+    writeTraceFile(Diags, TraceOutputPath, CollectedTraceEvents);
+  }
+
+  if (ShouldCollectStats) {
+    CompilerStatistics Stats;
+    unsigned NumRun = FinishedProcesses.size();
+    unsigned NumRestored = RestoredCommands.size();
+    Stats.add("Driver.NumJobs", Jobs.size());
+    Stats.add("Driver.NumJobsRun", NumRun);
+    Stats.add("Driver.NumJobsRestoredFromCache", NumRestored);
+    Stats.add("Driver.NumJobsSkipped",
+              Jobs.size() - std::min<size_t>(Jobs.size(),
+                                             NumRun + NumRestored));
+    Stats.add("time.Driver.us", TraceEvents::now() - StatsStartTime);
+    Stats.add("Driver.NumFrontendStatsFiles",
+              addFrontendStatistics(Stats,
+                                    llvm::sys::path::parent_path(
+                                      StatsOutputPath),
+                                    FinishedProcesses, BuildStartTime));
+
+    if (std::error_code EC = Stats.write(StatsOutputPath)) {
+      Diags.diagnose(SourceLoc(), diag::warn_unable_to_write_stats,
+                     StatsOutputPath, EC.message());
+    }
+  }
+
+  if (ActiveCache) {
+    ActiveCache->evict();
+    if (ShowCompilationCacheStatistics)
+      ActiveCache->printStatistics(llvm::outs());
+  }
+
   if (!CompilationRecordPath.empty() && !SkipTaskExecution) {
     InputInfoMap InputInfo;
     populateInputInfoMap(InputInfo, State);
     checkForOutOfDateInputs(Diags, InputInfo);
+    if (getIncrementalBuildEnabled())
+      for (StringRef dependency : DepGraph.getExternalDependencies())
+        (void)getExternalInterfaceHash(dependency);
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
-                           InputInfo);
+                           InputInfo, ExternalInterfaceHashes);
   }
 
   if (Result == 0)
@@ -666,6 +959,9 @@ int Compilation::performJobs() {
   if (Level < OutputLevel::Parseable &&
       (SaveTemps || TempFilePaths.empty()) &&
       CompilationRecordPath.empty() &&
+      TraceOutputPath.empty() &&
+      StatsOutputPath.empty() &&
+      !Cache &&
       Jobs.size() == 1) {
     return performSingleCommand(Jobs.front().get());
   }
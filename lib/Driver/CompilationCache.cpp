@@ -0,0 +1,480 @@
+//===--- CompilationCache.cpp - Cache of Frontend Job Outputs -------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/CompilationCache.h"
+
+#include "swift/Basic/Version.h"
+#include "swift/Driver/Action.h"
+#include "swift/Driver/Job.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace swift;
+using namespace swift::driver;
+namespace fs = llvm::sys::fs;
+
+/// The name of the file describing a cache entry.
+static const char ManifestName[] = "manifest";
+
+/// The name of the file holding the output a job printed.
+static const char PrintedOutputName[] = "printed-output";
+
+/// Returns true if \p arg is a frontend option whose value names an output of
+/// the job, and so should not affect which cache entry the job uses.
+static bool isOutputPathOption(StringRef arg) {
+  return llvm::StringSwitch<bool>(arg)
+    .Case("-o", true)
+    .Case("-emit-module-path", true)
+    .Case("-emit-module-doc-path", true)
+    .Case("-emit-dependencies-path", true)
+    .Case("-emit-reference-dependencies-path", true)
+    .Case("-serialize-diagnostics-path", true)
+    .Case("-emit-objc-header-path", true)
+    .Case("-emit-fixits-path", true)
+    .Case("-trace-events-output-path", true)
+    .Case("-save-optimization-record-path", true)
+    .Case("-stats-output-dir", true)
+    .Default(false);
+}
+
+/// Calls \p fn with a name and a path for every output of \p job.
+///
+/// The names are stable across builds, and are used as the names of the
+/// copies of the outputs in a cache entry.
+template <typename Fn>
+static void forEachOutput(const Job &job, const Fn &fn) {
+  const CommandOutput &output = job.getOutput();
+  types::ID primaryType = output.getPrimaryOutputType();
+  StringRef primaryTypeName = types::getTypeName(primaryType);
+
+  ArrayRef<std::string> primaryOutputs = output.getPrimaryOutputFilenames();
+  for (size_t index = 0, e = primaryOutputs.size(); index != e; ++index) {
+    StringRef path = primaryOutputs[index];
+    if (index == 0) {
+      fn(primaryTypeName, path);
+    } else {
+      llvm::SmallString<32> name = primaryTypeName;
+      llvm::raw_svector_ostream(name) << "-" << index;
+      fn(name, path);
+    }
+  }
+
+  types::forAllTypes([&](types::ID type) {
+    // Trace events describe a particular run of the job.
+    if (type == primaryType || type == types::TY_TraceEvents)
+      return;
+    StringRef path = output.getAdditionalOutputForType(type);
+    if (!path.empty())
+      fn(types::getTypeName(type), path);
+  });
+}
+
+/// Reads the files listed in the make-style dependencies file at \p path.
+///
+/// \returns true if the file could not be read.
+static bool readMakeDependencies(StringRef path,
+                                 SmallVectorImpl<std::string> &dependencies) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer)
+    return true;
+
+  // Every line has the same dependencies, only for a different target.
+  StringRef contents = buffer.get()->getBuffer();
+  StringRef line = contents.split('\n').first;
+
+  // Undo the escaping done by the frontend.
+  SmallVector<std::string, 16> words;
+  std::string word;
+  for (size_t i = 0, e = line.size(); i != e; ++i) {
+    char c = line[i];
+    if (c == '\\' && i + 1 != e) {
+      word.push_back(line[++i]);
+    } else if (c == '$' && i + 1 != e && line[i + 1] == '$') {
+      word.push_back('$');
+      ++i;
+    } else if (c == ' ') {
+      if (!word.empty())
+        words.push_back(std::move(word));
+      word.clear();
+    } else {
+      word.push_back(c);
+    }
+  }
+  if (!word.empty())
+    words.push_back(std::move(word));
+
+  auto separator = std::find(words.begin(), words.end(), ":");
+  if (separator == words.end())
+    return true;
+
+  dependencies.append(std::next(separator), words.end());
+  return false;
+}
+
+/// Writes \p contents to \p path, replacing any existing file only once all of
+/// the contents have been written.
+static bool writeFileAtomically(StringRef path, StringRef contents) {
+  int fd;
+  llvm::SmallString<128> tempPath;
+  if (fs::createUniqueFile(path + "-%%%%%%%%", fd, tempPath))
+    return true;
+
+  {
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    out << contents;
+    out.close();
+    if (out.has_error()) {
+      out.clear_error();
+      fs::remove(tempPath);
+      return true;
+    }
+  }
+
+  if (fs::rename(tempPath, path)) {
+    fs::remove(tempPath);
+    return true;
+  }
+  return false;
+}
+
+static bool copyFile(StringRef from, StringRef to) {
+  auto buffer = llvm::MemoryBuffer::getFile(from, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return true;
+  return writeFileAtomically(to, buffer.get()->getBuffer());
+}
+
+StringRef CompilationCache::getContentHash(StringRef path) {
+  auto known = ContentHashes.find(path);
+  if (known != ContentHashes.end())
+    return known->getValue();
+
+  std::string &result = ContentHashes[path];
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return result;
+
+  llvm::MD5 hash;
+  hash.update(buffer.get()->getBuffer());
+  llvm::MD5::MD5Result hashBuf;
+  hash.final(hashBuf);
+  SmallString<32> hashString;
+  llvm::MD5::stringifyResult(hashBuf, hashString);
+  result = hashString.str();
+  return result;
+}
+
+std::string CompilationCache::getEntryPath(const Job &job) const {
+  llvm::MD5 hash;
+  hash.update(version::getSwiftFullVersion());
+
+  // Distinguish different frontends that share a version string, such as
+  // successive builds of the compiler itself.
+  hash.update(job.getExecutable());
+  fs::file_status executableStatus;
+  if (!fs::status(job.getExecutable(), executableStatus)) {
+    hash.update(std::to_string(executableStatus.getSize()));
+    hash.update(std::to_string(
+        executableStatus.getLastModificationTime().toEpochTime()));
+  }
+
+  bool isOutputPath = false;
+  for (const char *arg : job.getArguments()) {
+    // Arguments are separated by a character that can't appear in them.
+    hash.update(StringRef("\0", 1));
+    if (isOutputPath)
+      hash.update("<output>");
+    else
+      hash.update(arg);
+    isOutputPath = isOutputPathOption(arg);
+  }
+
+  llvm::MD5::MD5Result hashBuf;
+  hash.final(hashBuf);
+  SmallString<32> hashString;
+  llvm::MD5::stringifyResult(hashBuf, hashString);
+
+  SmallString<128> entryPath = StringRef(Path);
+  llvm::sys::path::append(entryPath, hashString);
+  return entryPath.str();
+}
+
+bool CompilationCache::isCacheable(const Job &job) {
+  if (!isa<CompileJobAction>(job.getSource()))
+    return false;
+
+  // The dependencies file tells us which files have to be unchanged for an
+  // entry to be reused.
+  const CommandOutput &output = job.getOutput();
+  if (output.getAdditionalOutputForType(types::TY_Dependencies).empty())
+    return false;
+
+  // Filelists are temporary files, so their paths don't say anything about
+  // their contents.
+  if (!job.getFilelistInfo().path.empty())
+    return false;
+  return std::none_of(job.getArguments().begin(), job.getArguments().end(),
+                      [](const char *arg) {
+    return StringRef(arg) == "-filelist";
+  });
+}
+
+Optional<std::string> CompilationCache::restore(const Job &job) {
+  assert(isCacheable(job));
+  std::string entryPath = getEntryPath(job);
+
+  auto readEntry = [&]() -> bool {
+    SmallString<128> manifestPath = StringRef(entryPath);
+    llvm::sys::path::append(manifestPath, ManifestName);
+    auto buffer = llvm::MemoryBuffer::getFile(manifestPath);
+    if (!buffer)
+      return false;
+
+    namespace yaml = llvm::yaml;
+    llvm::SourceMgr SM;
+    yaml::Stream stream(buffer.get()->getMemBufferRef(), SM);
+
+    auto I = stream.begin();
+    if (I == stream.end() || !I->getRoot())
+      return false;
+
+    auto *topLevelMap = dyn_cast<yaml::MappingNode>(I->getRoot());
+    if (!topLevelMap)
+      return false;
+
+    SmallString<64> scratch;
+    SmallString<64> valueScratch;
+    bool versionValid = false;
+    llvm::StringSet<> cachedOutputs;
+
+    // FIXME: LLVM's YAML support does incremental parsing in such a way that
+    // for-range loops break.
+    for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
+      auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+      if (!key)
+        return false;
+      StringRef keyStr = key->getValue(scratch);
+
+      if (keyStr == "version") {
+        auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+        if (!value)
+          return false;
+        versionValid =
+            (value->getValue(scratch) == version::getSwiftFullVersion());
+
+      } else if (keyStr == "dependencies") {
+        auto *dependencyMap = dyn_cast<yaml::MappingNode>(i->getValue());
+        if (!dependencyMap)
+          return false;
+
+        for (auto i = dependencyMap->begin(), e = dependencyMap->end(); i != e;
+             ++i) {
+          auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+          auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+          if (!key || !value)
+            return false;
+          StringRef currentHash = getContentHash(key->getValue(scratch));
+          if (currentHash.empty() ||
+              currentHash != value->getValue(valueScratch)) {
+            return false;
+          }
+        }
+
+      } else if (keyStr == "outputs") {
+        auto *outputList = dyn_cast<yaml::SequenceNode>(i->getValue());
+        if (!outputList)
+          return false;
+
+        for (auto i = outputList->begin(), e = outputList->end(); i != e;
+             ++i) {
+          auto *value = dyn_cast<yaml::ScalarNode>(&*i);
+          if (!value)
+            return false;
+          cachedOutputs.insert(value->getValue(scratch));
+        }
+      }
+    }
+
+    if (!versionValid)
+      return false;
+
+    // Only restore anything if every output is available.
+    bool hasAllOutputs = true;
+    forEachOutput(job, [&](StringRef name, StringRef path) {
+      hasAllOutputs &= cachedOutputs.count(name) != 0;
+    });
+    if (!hasAllOutputs)
+      return false;
+
+    bool failed = false;
+    forEachOutput(job, [&](StringRef name, StringRef path) {
+      if (failed)
+        return;
+      SmallString<128> cachedPath = StringRef(entryPath);
+      llvm::sys::path::append(cachedPath, name);
+      failed = copyFile(cachedPath, path);
+    });
+    if (failed)
+      return false;
+
+    // Mark the entry as recently used.
+    int fd;
+    if (!fs::openFileForWrite(manifestPath, fd, fs::F_Append)) {
+      fs::setLastModificationAndAccessTime(fd, llvm::sys::TimeValue::now());
+      llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    }
+    return true;
+  };
+
+  if (!readEntry()) {
+    ++NumMisses;
+    return None;
+  }
+
+  ++NumHits;
+  SmallString<128> printedOutputPath = StringRef(entryPath);
+  llvm::sys::path::append(printedOutputPath, PrintedOutputName);
+  auto printedOutput = llvm::MemoryBuffer::getFile(printedOutputPath);
+  if (!printedOutput)
+    return std::string();
+  return printedOutput.get()->getBuffer().str();
+}
+
+void CompilationCache::store(const Job &job, StringRef output) {
+  assert(isCacheable(job));
+
+  SmallVector<std::string, 16> dependencies;
+  StringRef dependenciesPath =
+    job.getOutput().getAdditionalOutputForType(types::TY_Dependencies);
+  if (readMakeDependencies(dependenciesPath, dependencies))
+    return;
+
+  std::string manifest;
+  llvm::raw_string_ostream out(manifest);
+  out << "version: \"" << llvm::yaml::escape(version::getSwiftFullVersion())
+      << "\"\n";
+
+  out << "dependencies:\n";
+  for (StringRef dependency : dependencies) {
+    StringRef hash = getContentHash(dependency);
+    if (hash.empty())
+      return;
+    out << "  \"" << llvm::yaml::escape(dependency) << "\": \"" << hash
+        << "\"\n";
+  }
+
+  std::string entryPath = getEntryPath(job);
+  if (fs::create_directories(entryPath))
+    return;
+
+  bool failed = false;
+  out << "outputs:\n";
+  forEachOutput(job, [&](StringRef name, StringRef path) {
+    if (failed)
+      return;
+    SmallString<128> cachedPath = StringRef(entryPath);
+    llvm::sys::path::append(cachedPath, name);
+    failed = copyFile(path, cachedPath);
+    out << "  - \"" << llvm::yaml::escape(name) << "\"\n";
+  });
+  if (failed)
+    return;
+
+  SmallString<128> printedOutputPath = StringRef(entryPath);
+  llvm::sys::path::append(printedOutputPath, PrintedOutputName);
+  if (writeFileAtomically(printedOutputPath, output))
+    return;
+
+  // Write the manifest last, so that an entry is never used before all of its
+  // outputs are in place.
+  SmallString<128> manifestPath = StringRef(entryPath);
+  llvm::sys::path::append(manifestPath, ManifestName);
+  writeFileAtomically(manifestPath, out.str());
+}
+
+void CompilationCache::evict() {
+  if (SizeLimit == 0)
+    return;
+
+  struct EntryInfo {
+    std::string Path;
+    uint64_t Size;
+    llvm::sys::TimeValue LastUsed;
+  };
+  std::vector<EntryInfo> entries;
+  uint64_t totalSize = 0;
+
+  std::error_code EC;
+  for (fs::directory_iterator I(Path, EC), E; I != E && !EC; I.increment(EC)) {
+    fs::file_status entryStatus;
+    if (I->status(entryStatus) || !fs::is_directory(entryStatus))
+      continue;
+
+    // Entries without a manifest are either unusable or still being written;
+    // in both cases they are the first to go.
+    EntryInfo entry{I->path(), 0, llvm::sys::TimeValue::MinTime()};
+    std::error_code fileEC;
+    for (fs::directory_iterator fileI(entry.Path, fileEC), fileE;
+         fileI != fileE && !fileEC; fileI.increment(fileEC)) {
+      fs::file_status fileStatus;
+      if (fileI->status(fileStatus))
+        continue;
+      entry.Size += fileStatus.getSize();
+      if (llvm::sys::path::filename(fileI->path()) == ManifestName)
+        entry.LastUsed = fileStatus.getLastModificationTime();
+    }
+
+    totalSize += entry.Size;
+    entries.push_back(std::move(entry));
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const EntryInfo &lhs, const EntryInfo &rhs) {
+    return lhs.LastUsed < rhs.LastUsed;
+  });
+
+  for (const EntryInfo &entry : entries) {
+    if (totalSize <= SizeLimit)
+      break;
+
+    SmallVector<std::string, 8> files;
+    std::error_code fileEC;
+    for (fs::directory_iterator fileI(entry.Path, fileEC), fileE;
+         fileI != fileE && !fileEC; fileI.increment(fileEC)) {
+      files.push_back(fileI->path());
+    }
+    for (StringRef file : files)
+      fs::remove(file);
+    fs::remove(entry.Path);
+
+    totalSize -= entry.Size;
+    ++NumEvicted;
+  }
+}
+
+void CompilationCache::printStatistics(raw_ostream &out) const {
+  out << "Compilation cache: " << NumHits << " hits, " << NumMisses
+      << " misses, " << NumEvicted << " evicted\n";
+}
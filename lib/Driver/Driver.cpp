@@ -23,11 +23,14 @@
 #include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/LLVM.h"
+#include "swift/Basic/Statistics.h"
 #include "swift/Basic/TaskQueue.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/Range.h"
 #include "swift/Driver/Action.h"
 #include "swift/Driver/Compilation.h"
+#include "swift/Driver/CompilationCache.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/OutputFileMap.h"
 #include "swift/Driver/ToolChain.h"
@@ -154,6 +157,13 @@ static void validateArgs(DiagnosticEngine &diags, const ArgList &Args) {
     diags.diagnose(SourceLoc(), diag::error_conflicting_options,
                    "-warnings-as-errors", "-suppress-warnings");
   }
+
+  // Check that the profile used for PGO exists.
+  if (const Arg *A = Args.getLastArg(options::OPT_profile_use)) {
+    if (!llvm::sys::fs::exists(A->getValue()))
+      diags.diagnose(SourceLoc(), diag::error_profile_missing,
+                     A->getValue());
+  }
 }
 
 static void computeArgsHash(SmallString<32> &out, const DerivedArgList &args) {
@@ -190,7 +200,9 @@ class Driver::InputInfoMap
 };
 using InputInfoMap = Driver::InputInfoMap;
 
-static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
+static bool populateOutOfDateMap(InputInfoMap &map,
+                                 llvm::StringMap<std::string> &externalHashes,
+                                 StringRef argsHashStr,
                                  const InputFileList &inputs,
                                  StringRef buildRecordPath) {
   // Treat a missing file as "no previous build".
@@ -317,6 +329,26 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
         auto inputName = key->getValue(scratch);
         previousInputs[inputName] = { *previousBuildState, timeValue };
       }
+
+    } else if (keyStr == "external_interface_hashes") {
+      auto *hashMap = dyn_cast<yaml::MappingNode>(i->getValue());
+      if (!hashMap)
+        return true;
+
+      // FIXME: LLVM's YAML support does incremental parsing in such a way that
+      // for-range loops break.
+      for (auto i = hashMap->begin(), e = hashMap->end(); i != e; ++i) {
+        auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+        if (!key)
+          return true;
+
+        auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+        if (!value)
+          return true;
+
+        std::string dependency = key->getValue(scratch);
+        externalHashes[dependency] = value->getValue(scratch);
+      }
     }
   }
 
@@ -428,6 +460,7 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   computeArgsHash(ArgsHash, *TranslatedArgList);
 
   InputInfoMap outOfDateMap;
+  llvm::StringMap<std::string> externalInterfaceHashes;
   bool rebuildEverything = true;
   if (Incremental) {
     if (!OFM) {
@@ -450,8 +483,8 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
         rebuildEverything = true;
 
       } else {
-        if (populateOutOfDateMap(outOfDateMap, ArgsHash, Inputs,
-                                 buildRecordPath)) {
+        if (populateOutOfDateMap(outOfDateMap, externalInterfaceHashes,
+                                 ArgsHash, Inputs, buildRecordPath)) {
           // FIXME: Distinguish errors from "file removed", which is benign.
         } else {
           rebuildEverything = false;
@@ -482,6 +515,16 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     }
   }
 
+  uint64_t CompilationCacheSizeLimit = 0;
+  if (const Arg *A =
+        ArgList->getLastArg(options::OPT_compilation_cache_size_limit)) {
+    if (StringRef(A->getValue()).getAsInteger(10, CompilationCacheSizeLimit)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(*ArgList), A->getValue());
+      return nullptr;
+    }
+  }
+
   OutputLevel Level = OutputLevel::Normal;
   if (const Arg *A = ArgList->getLastArg(options::OPT_v,
                                          options::OPT_parseable_output)) {
@@ -515,6 +558,23 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (const Arg *A = C->getArgs().getLastArg(options::OPT_driver_time_trace))
+    C->setTraceOutputPath(A->getValue());
+
+  if (const Arg *A = C->getArgs().getLastArg(options::OPT_stats_output_dir)) {
+    C->setStatsOutputPath(CompilerStatistics::getOutputPath(
+        A->getValue(), "driver", TraceEvents::getCurrentProcessID(),
+        OI.ModuleName));
+  }
+
+  if (const Arg *A =
+        C->getArgs().getLastArg(options::OPT_compilation_cache_path))
+    C->setCompilationCache(llvm::make_unique<CompilationCache>(
+        A->getValue(), CompilationCacheSizeLimit));
+
+  if (C->getArgs().hasArg(options::OPT_driver_print_cache_stats))
+    C->setShowsCompilationCacheStatistics();
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -527,6 +587,7 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
       auto buildEntry = outOfDateMap.find(nullptr);
       if (buildEntry != outOfDateMap.end())
         C->setLastBuildTime(buildEntry->second.previousModTime);
+      C->setLastExternalInterfaceHashes(std::move(externalInterfaceHashes));
     }
   }
 
@@ -1184,6 +1245,8 @@ void Driver::buildActions(const ToolChain &TC,
       case types::TY_ClangModuleFile:
       case types::TY_SwiftDeps:
       case types::TY_Remapping:
+      case types::TY_TraceEvents:
+      case types::TY_OptRecord:
         // We could in theory handle assembly or LLVM input, but let's not.
         // FIXME: What about LTO?
         Diags.diagnose(SourceLoc(), diag::error_unexpected_input_file,
@@ -1824,15 +1887,42 @@ Job *Driver::buildJobsForAction(Compilation &C, const JobAction *JA,
         llvm::sys::fs::remove(OutputPath);
     }
 
-    // Choose the dependencies file output path.
+    // Choose the dependencies file output path. The compilation cache uses it
+    // to find out which files a job read, even if it wasn't requested.
     if (C.getArgs().hasArg(options::OPT_emit_dependencies)) {
       addAuxiliaryOutput(C, *Output, types::TY_Dependencies, OI, OutputMap);
+    } else if (C.getArgs().hasArg(options::OPT_compilation_cache_path)) {
+      addAuxiliaryOutput(C, *Output, types::TY_Dependencies, OI, nullptr);
+      StringRef Path = Output->getAnyOutputForType(types::TY_Dependencies);
+      if (!C.isTemporaryFile(Path))
+        C.addTemporaryFile(Path);
     }
     if (C.getIncrementalBuildEnabled()) {
       addAuxiliaryOutput(C, *Output, types::TY_SwiftDeps, OI, OutputMap);
     }
   }
 
+  // Choose where each frontend job writes its trace events. These are only
+  // intermediates; the Compilation merges them into a single trace file.
+  if ((isa<CompileJobAction>(JA) || isa<MergeModuleJobAction>(JA)) &&
+      C.getArgs().hasArg(options::OPT_driver_time_trace)) {
+    addAuxiliaryOutput(C, *Output, types::TY_TraceEvents, OI, OutputMap);
+    C.addTemporaryFile(Output->getAnyOutputForType(types::TY_TraceEvents));
+  }
+
+  // Choose where the optimization record is written. A path given on the
+  // command line can only be used by a single frontend job.
+  if (isa<CompileJobAction>(JA) &&
+      C.getArgs().hasArg(options::OPT_save_optimization_record,
+                         options::OPT_save_optimization_record_path)) {
+    const Arg *A =
+        C.getArgs().getLastArg(options::OPT_save_optimization_record_path);
+    if (A && OI.CompilerMode == OutputInfo::Mode::SingleCompile)
+      Output->setAdditionalOutputForType(types::TY_OptRecord, A->getValue());
+    else
+      addAuxiliaryOutput(C, *Output, types::TY_OptRecord, OI, OutputMap);
+  }
+
   // Choose the Objective-C header output path.
   if ((isa<MergeModuleJobAction>(JA) ||
        (isa<CompileJobAction>(JA) &&
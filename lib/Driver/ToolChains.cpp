@@ -126,9 +126,11 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddLastArg(arguments, options::OPT_parse_stdlib);
   inputArgs.AddLastArg(arguments, options::OPT_resource_dir);
   inputArgs.AddLastArg(arguments, options::OPT_solver_memory_threshold);
+  inputArgs.AddLastArg(arguments, options::OPT_stats_output_dir);
   inputArgs.AddLastArg(arguments, options::OPT_suppress_warnings);
   inputArgs.AddLastArg(arguments, options::OPT_profile_generate);
   inputArgs.AddLastArg(arguments, options::OPT_profile_coverage_mapping);
+  inputArgs.AddLastArg(arguments, options::OPT_profile_use);
   inputArgs.AddLastArg(arguments, options::OPT_warnings_as_errors);
 
   // Pass on any build config options
@@ -148,6 +150,20 @@ static void addCommonFrontendArgs(const ToolChain &TC,
     arguments.push_back(moduleDocOutputPath.c_str());
   }
 
+  const std::string &traceEventsPath =
+      output.getAdditionalOutputForType(types::TY_TraceEvents);
+  if (!traceEventsPath.empty()) {
+    arguments.push_back("-trace-events-output-path");
+    arguments.push_back(traceEventsPath.c_str());
+  }
+
+  const std::string &optRecordPath =
+      output.getAdditionalOutputForType(types::TY_OptRecord);
+  if (!optRecordPath.empty()) {
+    arguments.push_back("-save-optimization-record-path");
+    arguments.push_back(optRecordPath.c_str());
+  }
+
   if (llvm::sys::Process::StandardErrHasColors())
     arguments.push_back("-color-diagnostics");
 }
@@ -217,6 +233,8 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     case types::TY_Image:
     case types::TY_SwiftDeps:
     case types::TY_Remapping:
+    case types::TY_TraceEvents:
+    case types::TY_OptRecord:
       llvm_unreachable("Output type can never be primary output.");
     case types::TY_INVALID:
       llvm_unreachable("Invalid type ID");
@@ -474,6 +492,8 @@ ToolChain::constructInvocation(const BackendJobAction &job,
     case types::TY_Image:
     case types::TY_SwiftDeps:
     case types::TY_Remapping:
+    case types::TY_TraceEvents:
+    case types::TY_OptRecord:
       llvm_unreachable("Output type can never be primary output.");
     case types::TY_INVALID:
       llvm_unreachable("Invalid type ID");
@@ -564,6 +564,14 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     Opts.FixitsOutputPath = A->getValue();
   }
 
+  if (const Arg *A = Args.getLastArg(OPT_trace_events_output_path)) {
+    Opts.TraceEventsOutputPath = A->getValue();
+  }
+
+  if (const Arg *A = Args.getLastArg(OPT_stats_output_dir)) {
+    Opts.StatsOutputDir = A->getValue();
+  }
+
   bool IsSIB =
     Opts.RequestedAction == FrontendOptions::EmitSIB ||
     Opts.RequestedAction == FrontendOptions::EmitSIBGen;
@@ -1041,8 +1049,14 @@ static bool ParseSILArgs(SILOptions &Opts, ArgList &Args,
 
   Opts.GenerateProfile |= Args.hasArg(OPT_profile_generate);
   Opts.EmitProfileCoverageMapping |= Args.hasArg(OPT_profile_coverage_mapping);
+  if (const Arg *A = Args.getLastArg(OPT_profile_use))
+    Opts.UseProfile = A->getValue();
   Opts.EnableGuaranteedClosureContexts |=
     Args.hasArg(OPT_enable_guaranteed_closure_contexts);
+  Opts.ExportSpecializations |= Args.hasArg(OPT_export_specializations);
+  Opts.ReuseSpecializations |= Args.hasArg(OPT_reuse_specializations);
+  if (const Arg *A = Args.getLastArg(OPT_save_optimization_record_path))
+    Opts.OptRecordFile = A->getValue();
 
   return false;
 }
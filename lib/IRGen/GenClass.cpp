@@ -463,9 +463,23 @@ OwnedAddress irgen::projectPhysicalClassMemberAddress(IRGenFunction &IGF,
   llvm_unreachable("bad field-access strategy");
 }
 
+/// Returns the offset of the first tail-allocated element of type
+/// \p tailType in an instance of the given size: the instance size rounded up
+/// to the alignment of the element type.
+static llvm::Value *emitTailElementsOffset(IRGenFunction &IGF,
+                                           llvm::Value *instanceSize,
+                                           const TypeInfo &tailTI,
+                                           SILType tailType) {
+  llvm::Value *tailAlignMask = tailTI.getAlignmentMask(IGF, tailType);
+  llvm::Value *offset = IGF.Builder.CreateAdd(instanceSize, tailAlignMask);
+  return IGF.Builder.CreateAnd(offset, IGF.Builder.CreateNot(tailAlignMask));
+}
+
 /// Emit an allocation of a class.
 llvm::Value *irgen::emitClassAllocation(IRGenFunction &IGF, SILType selfType,
-                                        bool objc, int &StackAllocSize) {
+                                        bool objc, int &StackAllocSize,
+                                        SILType TailType,
+                                        llvm::Value *TailCount) {
   auto &classTI = IGF.getTypeInfo(selfType).as<ClassTypeInfo>();
   auto classType = selfType.getSwiftRValueType();
 
@@ -473,6 +487,7 @@ llvm::Value *irgen::emitClassAllocation(IRGenFunction &IGF, SILType selfType,
   // If the root class isn't known to use the Swift allocator, we need
   // to call [self alloc].
   if (objc) {
+    assert(!TailType && "Objective-C objects can't have tail elements");
     llvm::Value *metadata =
       emitClassHeapMetadataRef(IGF, classType, MetadataValueType::ObjCClass,
                                /*allow uninitialized*/ true);
@@ -491,19 +506,48 @@ llvm::Value *irgen::emitClassAllocation(IRGenFunction &IGF, SILType selfType,
                                    metadata);
 
   auto &layout = classTI.getLayout(IGF.IGM);
+  bool canAllocOnStack = layout.isFixedLayout();
+  uint64_t stackSize = layout.getSize().getValue();
+  Alignment stackAlignment = layout.getAlignment();
+
+  // Add the tail-allocated elements to the size and alignment of the object.
+  // The constant folding of the IRBuilder keeps them constant if the element
+  // type has a fixed layout and the number of elements is a constant.
+  if (TailType) {
+    auto &tailTI = IGF.getTypeInfo(TailType);
+    llvm::Value *count = IGF.Builder.CreateZExtOrTrunc(TailCount,
+                                                       IGF.IGM.SizeTy);
+    llvm::Value *tailSize =
+      IGF.Builder.CreateMul(count, tailTI.getStride(IGF, TailType));
+    size = IGF.Builder.CreateAdd(
+             emitTailElementsOffset(IGF, size, tailTI, TailType), tailSize);
+    // Alignment masks are of the form 2^n-1, so this is the maximum.
+    alignMask = IGF.Builder.CreateOr(alignMask,
+                                     tailTI.getAlignmentMask(IGF, TailType));
+
+    auto *constSize = dyn_cast<llvm::ConstantInt>(size);
+    auto *constAlignMask = dyn_cast<llvm::ConstantInt>(alignMask);
+    if (constSize && constAlignMask) {
+      stackSize = constSize->getZExtValue();
+      stackAlignment = Alignment(constAlignMask->getZExtValue() + 1);
+    } else {
+      canAllocOnStack = false;
+    }
+  }
+
   llvm::Type *destType = layout.getType()->getPointerTo();
   llvm::Value *val = nullptr;
-  if (layout.isFixedLayout() &&
-      (int)layout.getSize().getValue() < StackAllocSize) {
+  if (canAllocOnStack && StackAllocSize >= 0 &&
+      stackSize < (uint64_t)StackAllocSize) {
     // Allocate the object on the stack.
-    auto *Ty = layout.getType();
-    auto Alloca = IGF.createAlloca(Ty, layout.getAlignment(),
-                                   "reference.raw");
-    val = Alloca.getAddress();
-    assert(val->getType() == destType);
-    val = IGF.Builder.CreateBitCast(val, IGF.IGM.RefCountedPtrTy);
+    llvm::Type *Ty = layout.getType();
+    if (TailType)
+      Ty = llvm::ArrayType::get(IGF.IGM.Int8Ty, stackSize);
+    auto Alloca = IGF.createAlloca(Ty, stackAlignment, "reference.raw");
+    val = IGF.Builder.CreateBitCast(Alloca.getAddress(),
+                                    IGF.IGM.RefCountedPtrTy);
     val = IGF.emitInitStackObjectCall(metadata, val, "reference.new");
-    StackAllocSize = layout.getSize().getValue();
+    StackAllocSize = stackSize;
   } else {
     // Allocate the object on the heap.
     val = IGF.emitAllocObjectCall(metadata, size, alignMask, "reference.new");
@@ -512,6 +556,25 @@ llvm::Value *irgen::emitClassAllocation(IRGenFunction &IGF, SILType selfType,
   return IGF.Builder.CreateBitCast(val, destType);
 }
 
+Address irgen::emitTailProjection(IRGenFunction &IGF, llvm::Value *Base,
+                                  SILType ClassType, SILType TailType) {
+  ClassDecl *theClass = ClassType.getClassOrBoundGenericClass();
+  auto &tailTI = IGF.getTypeInfo(TailType);
+
+  // The tail elements start after the stored properties of the class. If the
+  // class doesn't have a fixed layout, get its size from the metadata.
+  llvm::Value *size = tryEmitClassConstantFragileInstanceSize(IGF.IGM,
+                                                              theClass);
+  if (!size) {
+    llvm::Value *metadata =
+      emitHeapMetadataRefForHeapObject(IGF, Base, ClassType);
+    size = emitClassResilientInstanceSizeAndAlignMask(IGF, theClass,
+                                                      metadata).first;
+  }
+  llvm::Value *offset = emitTailElementsOffset(IGF, size, tailTI, TailType);
+  return IGF.emitByteOffsetGEP(Base, offset, tailTI, "tailaddr");
+}
+
 llvm::Value *irgen::emitClassAllocationDynamic(IRGenFunction &IGF, 
                                                llvm::Value *metadata,
                                                SILType selfType,
@@ -35,6 +35,7 @@ namespace swift {
   class VarDecl;
 
 namespace irgen {
+  class Address;
   class HeapLayout;
   class IRGenFunction;
   class IRGenModule;
@@ -73,8 +74,16 @@ namespace irgen {
   /// means that no stack allocation is possible.
   /// The returned \p StackAllocSize value is the actual size if the object is
   /// allocated on the stack or -1, if the object is allocated on the heap.
+  /// If \p TailType is not null, the object is allocated with \p TailCount
+  /// tail-allocated elements of this type.
   llvm::Value *emitClassAllocation(IRGenFunction &IGF, SILType selfType,
-                                   bool objc, int &StackAllocSize);
+                                   bool objc, int &StackAllocSize,
+                                   SILType TailType, llvm::Value *TailCount);
+
+  /// Emit the address of the first tail-allocated element of a class
+  /// instance.
+  Address emitTailProjection(IRGenFunction &IGF, llvm::Value *Base,
+                             SILType ClassType, SILType TailType);
 
   /// Emit an allocation of a class using a metadata value.
   llvm::Value *emitClassAllocationDynamic(IRGenFunction &IGF, 
@@ -84,6 +84,12 @@ static void addSwiftStackPromotionPass(const PassManagerBuilder &Builder,
     PM.add(createSwiftStackPromotionPass());
 }
 
+static void addSwiftMergeFunctionsPass(const PassManagerBuilder &Builder,
+                                       PassManagerBase &PM) {
+  if (Builder.OptLevel > 0)
+    PM.add(createSwiftMergeFunctionsPass());
+}
+
 // FIXME: Copied from clang/lib/CodeGen/CGObjCMac.cpp. 
 // These should be moved to a single definition shared by clang and swift.
 enum ImageInfoFlags {
@@ -141,6 +147,11 @@ void swift::performLLVMOptimizations(IRGenOptions &Opts, llvm::Module *Module,
   PMBuilder.addExtension(PassManagerBuilder::EP_ModuleOptimizerEarly,
                          addSwiftStackPromotionPass);
 
+  // Merge the functions which only differ in the metadata they reference,
+  // after LLVM's MergeFunctions merged the equal ones.
+  PMBuilder.addExtension(PassManagerBuilder::EP_OptimizerLast,
+                         addSwiftMergeFunctionsPass);
+
   // If the optimizer is enabled, we run the ARCOpt pass in the scalar optimizer
   // and the Contract pass as late as possible.
   if (!Opts.DisableLLVMARCOpts) {
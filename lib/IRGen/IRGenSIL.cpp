@@ -20,6 +20,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
@@ -386,6 +387,10 @@ public:
   /// Calculates EstimatedStackSize.
   void estimateStackSize();
 
+  /// Returns the branch weights of \p i derived from -profile-use data, or
+  /// null if there is not enough data.
+  llvm::MDNode *getProfileBranchWeights(CondBranchInst *i);
+
   void setLoweredValue(SILValue v, LoweredValue &&lv) {
     auto inserted = LoweredValues.insert({v, std::move(lv)});
     assert(inserted.second && "already had lowered value for sil value?!");
@@ -733,6 +738,7 @@ public:
   void visitStructExtractInst(StructExtractInst *i);
   void visitStructElementAddrInst(StructElementAddrInst *i);
   void visitRefElementAddrInst(RefElementAddrInst *i);
+  void visitRefTailAddrInst(RefTailAddrInst *i);
 
   void visitClassMethodInst(ClassMethodInst *i);
   void visitSuperMethodInst(SuperMethodInst *i);
@@ -1370,6 +1376,14 @@ void IRGenSILFunction::emitSILFunction() {
   if (IGM.DebugInfo)
     IGM.DebugInfo->emitFunction(*CurSILFn, CurFn);
 
+  // Let LLVM lay out code using -profile-use data. Functions which were never
+  // called are moved out of the way of the hot code.
+  if (auto entryCount = CurSILFn->getEntryCount()) {
+    CurFn->setEntryCount(*entryCount);
+    if (*entryCount == 0)
+      CurFn->addFnAttr(llvm::Attribute::Cold);
+  }
+
   // Map the entry bb.
   LoweredBBs[&*CurSILFn->begin()] = LoweredBB(&*CurFn->begin(), {});
   // Create LLVM basic blocks for the other bbs.
@@ -2936,6 +2950,51 @@ void IRGenSILFunction::visitBranchInst(swift::BranchInst *i) {
   Builder.CreateBr(lbb.bb);
 }
 
+llvm::MDNode *
+IRGenSILFunction::getProfileBranchWeights(swift::CondBranchInst *i) {
+  Optional<uint64_t> trueCount = i->getTrueBB()->getProfileCount();
+  Optional<uint64_t> falseCount = i->getFalseBB()->getProfileCount();
+  if (!trueCount && !falseCount)
+    return nullptr;
+
+  // Usually only one side of a branch begins a counted region, e.g. the
+  // 'then' part of an 'if'. The count of the other side is the count of the
+  // region containing the branch minus that.
+  if (!trueCount || !falseCount) {
+    SILBasicBlock *countedBB = trueCount ? i->getTrueBB() : i->getFalseBB();
+    uint64_t knownCount = trueCount ? *trueCount : *falseCount;
+
+    if (!Dominance)
+      Dominance.reset(new DominanceInfo(CurSILFn));
+    // This doesn't work for the backedge of a loop.
+    if (Dominance->dominates(countedBB, i->getParent()))
+      return nullptr;
+
+    Optional<uint64_t> regionCount;
+    for (auto *node = Dominance->getNode(i->getParent()); node;
+         node = node->getIDom()) {
+      regionCount = node->getBlock()->getProfileCount();
+      if (regionCount)
+        break;
+    }
+    // The region count is only an estimate; for example, the header of a
+    // loop executes more often than the region containing the loop.
+    if (!regionCount || *regionCount < knownCount)
+      return nullptr;
+
+    if (trueCount)
+      falseCount = *regionCount - knownCount;
+    else
+      trueCount = *regionCount - knownCount;
+  }
+
+  // Branch weights are 32 bits wide.
+  uint64_t scale = std::max(*trueCount, *falseCount) / UINT32_MAX + 1;
+  return llvm::MDBuilder(IGM.getLLVMContext())
+      .createBranchWeights(uint32_t(*trueCount / scale),
+                           uint32_t(*falseCount / scale));
+}
+
 void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   LoweredBB &trueBB = getLoweredBB(i->getTrueBB());
   LoweredBB &falseBB = getLoweredBB(i->getFalseBB());
@@ -2945,7 +3004,8 @@ void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   addIncomingSILArgumentsToPHINodes(*this, trueBB, i->getTrueArgs());
   addIncomingSILArgumentsToPHINodes(*this, falseBB, i->getFalseArgs());
 
-  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb);
+  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb,
+                       getProfileBranchWeights(i));
 }
 
 void IRGenSILFunction::visitRetainValueInst(swift::RetainValueInst *i) {
@@ -3090,6 +3150,16 @@ void IRGenSILFunction::visitRefElementAddrInst(swift::RefElementAddrInst *i) {
   setLoweredAddress(i, field);
 }
 
+void IRGenSILFunction::visitRefTailAddrInst(RefTailAddrInst *i) {
+  Explosion base = getLoweredExplosion(i->getOperand());
+  llvm::Value *value = base.claimNext();
+
+  Address tailAddr = emitTailProjection(*this, value,
+                                        i->getOperand()->getType(),
+                                        i->getTailType());
+  setLoweredAddress(i, tailAddr);
+}
+
 void IRGenSILFunction::visitLoadInst(swift::LoadInst *i) {
   Explosion lowered;
   Address source = getLoweredAddress(i->getOperand());
@@ -3466,8 +3536,15 @@ void IRGenSILFunction::visitAllocRefInst(swift::AllocRefInst *i) {
     // Is there enough space for stack allocation?
     StackAllocSize = IGM.Opts.StackPromotionSizeLimit - EstimatedStackSize;
   }
+  SILType TailType;
+  llvm::Value *TailCount = nullptr;
+  if (i->hasTailAllocatedElements()) {
+    TailType = i->getTailAllocatedType();
+    TailCount = getLoweredSingletonExplosion(i->getTailAllocatedCount());
+  }
   llvm::Value *alloced = emitClassAllocation(*this, i->getType(), i->isObjC(),
-                                             StackAllocSize);
+                                             StackAllocSize, TailType,
+                                             TailCount);
   if (StackAllocSize >= 0) {
     // Remember that this alloc_ref allocates the object on the stack.
 
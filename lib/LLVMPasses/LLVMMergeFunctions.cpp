@@ -0,0 +1,398 @@
+//===--- LLVMMergeFunctions.cpp - Merge similar functions for Swift -------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass merges functions which are equal except for the pointer constants
+// they reference. Generic specializations often differ only in the type
+// metadata or witness tables they use, e.g. the specializations of a function
+// for Int and UInt.
+//
+// The body of one of the functions is moved into a new internal function,
+// with an additional parameter for each pointer constant which differs. All
+// the original functions become thunks, which call the merged function with
+// their own constants. The thunks keep the names, linkage and calling
+// convention of the original functions.
+//
+// Functions which are completely equal are handled as well, but these are
+// usually already merged by LLVM's MergeFunctions pass.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "swift-merge-functions"
+#include "swift/LLVMPasses/Passes.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace swift;
+
+STATISTIC(NumFunctionsMerged, "Number of functions turned into thunks");
+STATISTIC(NumMergedFunctions, "Number of merged functions created");
+STATISTIC(NumInstructionsRemoved,
+          "Number of instructions removed by merging functions");
+
+static cl::opt<unsigned> MergeMinInstructions(
+    "swift-merge-functions-min-size", cl::init(16), cl::Hidden,
+    cl::desc("Minimum number of instructions of functions to be merged"));
+
+static cl::opt<unsigned> MergeMaxParams(
+    "swift-merge-functions-max-params", cl::init(4), cl::Hidden,
+    cl::desc("Maximum number of parameters added to a merged function"));
+
+//===----------------------------------------------------------------------===//
+//                          SwiftMergeFunctions Pass
+//===----------------------------------------------------------------------===//
+
+char SwiftMergeFunctions::ID = 0;
+
+INITIALIZE_PASS_BEGIN(SwiftMergeFunctions,
+                      "swift-merge-functions", "Swift merge functions pass",
+                      false, false)
+INITIALIZE_PASS_END(SwiftMergeFunctions,
+                    "swift-merge-functions", "Swift merge functions pass",
+                    false, false)
+
+llvm::ModulePass *swift::createSwiftMergeFunctionsPass() {
+  initializeSwiftMergeFunctionsPass(*llvm::PassRegistry::getPassRegistry());
+  return new SwiftMergeFunctions();
+}
+
+/// An operand of an instruction in the reference function of a group.
+typedef std::pair<Instruction *, unsigned> OperandLoc;
+
+/// The pointer constants of a function which differ from the constants at the
+/// same operand locations in the reference function, in instruction order.
+typedef MapVector<OperandLoc, Constant *> ConstantDiffs;
+
+/// Returns the number of instructions if \p F can be merged, or zero.
+static unsigned getMergeableSize(Function &F) {
+  if (F.isDeclaration() || F.isVarArg() || F.hasAvailableExternallyLinkage())
+    return 0;
+
+  // The definition may be replaced at link time.
+  if (F.isWeakForLinker() && !F.hasLinkOnceODRLinkage() &&
+      !F.hasWeakODRLinkage())
+    return 0;
+
+  if (F.hasPrefixData() || F.hasPrologueData())
+    return 0;
+
+  unsigned Size = 0;
+  for (BasicBlock &BB : F) {
+    // Moving the body would invalidate block addresses.
+    if (BB.hasAddressTaken())
+      return 0;
+    for (Instruction &I : BB) {
+      // Debug locations refer to the scope of the original function.
+      if (I.getDebugLoc())
+        return 0;
+      if (auto *CI = dyn_cast<CallInst>(&I))
+        if (CI->isMustTailCall())
+          return 0;
+      ++Size;
+    }
+  }
+  return Size;
+}
+
+/// Hashes the structure of \p F, ignoring the values of its operands.
+static hash_code hashFunction(Function &F) {
+  hash_code H = hash_combine(F.getFunctionType(), F.size());
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB)
+      H = hash_combine(H, I.getOpcode(), I.getType(), I.getNumOperands());
+  }
+  return H;
+}
+
+/// Returns true if the operand \p OpIdx of \p I may be replaced by a
+/// parameter.
+static bool canParameterize(Instruction *I, unsigned OpIdx) {
+  // Intrinsics may require constant operands.
+  if (isa<IntrinsicInst>(I))
+    return false;
+  // The clauses of landing pads must be constants.
+  if (I->isEHPad())
+    return false;
+  CallSite CS(I);
+  if (CS) {
+    // The operands of inline assembly are matched against its constraints.
+    if (CS.isInlineAsm())
+      return false;
+    // Don't turn direct calls into indirect calls.
+    if (CS.isCallee(&I->getOperandUse(OpIdx)))
+      return false;
+  }
+  return true;
+}
+
+/// Returns true if \p Other is equal to \p Ref except for pointer constants.
+/// The differing constants of \p Other are added to \p Diffs.
+static bool isEquivalent(Function *Ref, Function *Other, ConstantDiffs &Diffs) {
+  if (Ref->getFunctionType() != Other->getFunctionType() ||
+      Ref->getCallingConv() != Other->getCallingConv() ||
+      Ref->getAttributes() != Other->getAttributes() ||
+      Ref->hasGC() || Other->hasGC() ||
+      StringRef(Ref->getSection()) != StringRef(Other->getSection()) ||
+      Ref->getAlignment() != Other->getAlignment() ||
+      Ref->hasPersonalityFn() != Other->hasPersonalityFn() ||
+      (Ref->hasPersonalityFn() &&
+       Ref->getPersonalityFn() != Other->getPersonalityFn()) ||
+      Ref->size() != Other->size())
+    return false;
+
+  // Map the arguments, blocks and instructions of Ref to those of Other.
+  DenseMap<Value *, Value *> ValueMap;
+  for (auto RefArg = Ref->arg_begin(), OtherArg = Other->arg_begin(),
+            End = Ref->arg_end();
+       RefArg != End; ++RefArg, ++OtherArg)
+    ValueMap[&*RefArg] = &*OtherArg;
+
+  for (auto RefBB = Ref->begin(), OtherBB = Other->begin(), End = Ref->end();
+       RefBB != End; ++RefBB, ++OtherBB) {
+    if (RefBB->size() != OtherBB->size())
+      return false;
+    ValueMap[&*RefBB] = &*OtherBB;
+    for (auto RefI = RefBB->begin(), OtherI = OtherBB->begin(),
+              EndI = RefBB->end();
+         RefI != EndI; ++RefI, ++OtherI) {
+      if (!RefI->isSameOperationAs(&*OtherI))
+        return false;
+      // The merged function keeps the metadata of the reference function,
+      // e.g. !range or !nonnull, which must also hold for the other function.
+      SmallVector<std::pair<unsigned, MDNode *>, 4> RefMD, OtherMD;
+      RefI->getAllMetadataOtherThanDebugLoc(RefMD);
+      OtherI->getAllMetadataOtherThanDebugLoc(OtherMD);
+      if (RefMD != OtherMD)
+        return false;
+      ValueMap[&*RefI] = &*OtherI;
+    }
+  }
+
+  // Compare the operands.
+  for (auto RefBB = Ref->begin(), OtherBB = Other->begin(), End = Ref->end();
+       RefBB != End; ++RefBB, ++OtherBB) {
+    for (auto RefI = RefBB->begin(), OtherI = OtherBB->begin(),
+              EndI = RefBB->end();
+         RefI != EndI; ++RefI, ++OtherI) {
+      for (unsigned Idx = 0, e = RefI->getNumOperands(); Idx != e; ++Idx) {
+        Value *RefOp = RefI->getOperand(Idx);
+        Value *OtherOp = OtherI->getOperand(Idx);
+        auto Iter = ValueMap.find(RefOp);
+        if (Iter != ValueMap.end()) {
+          if (Iter->second != OtherOp)
+            return false;
+          continue;
+        }
+        if (RefOp == OtherOp)
+          continue;
+
+        auto *OtherConst = dyn_cast<Constant>(OtherOp);
+        if (!isa<Constant>(RefOp) || !OtherConst ||
+            !RefOp->getType()->isPointerTy() ||
+            !canParameterize(&*RefI, Idx))
+          return false;
+        Diffs[OperandLoc(&*RefI, Idx)] = OtherConst;
+      }
+
+      // The incoming blocks of phis are not operands.
+      if (auto *RefPhi = dyn_cast<PHINode>(&*RefI)) {
+        auto *OtherPhi = cast<PHINode>(&*OtherI);
+        for (unsigned Idx = 0, e = RefPhi->getNumIncomingValues(); Idx != e;
+             ++Idx) {
+          if (ValueMap[RefPhi->getIncomingBlock(Idx)] !=
+              OtherPhi->getIncomingBlock(Idx))
+            return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/// Replaces the body of \p F by a call to \p Target, passing the arguments of
+/// \p F followed by \p ExtraArgs.
+static void writeThunk(Function *F, Function *Target,
+                       ArrayRef<Value *> ExtraArgs) {
+  // Deleting the body resets the linkage.
+  GlobalValue::LinkageTypes Linkage = F->getLinkage();
+  F->deleteBody();
+  F->setLinkage(Linkage);
+
+  BasicBlock *BB = BasicBlock::Create(F->getContext(), "", F);
+  IRBuilder<> Builder(BB);
+  SmallVector<Value *, 8> Args;
+  // A tail call must not access the byval or inalloca arguments of its
+  // caller, which are in the caller's frame.
+  bool CanTailCall = true;
+  for (Argument &Arg : F->args()) {
+    Args.push_back(&Arg);
+    if (Arg.hasByValOrInAllocaAttr())
+      CanTailCall = false;
+  }
+  Args.append(ExtraArgs.begin(), ExtraArgs.end());
+
+  CallInst *Call = Builder.CreateCall(Target, Args);
+  Call->setTailCall(CanTailCall);
+  Call->setCallingConv(Target->getCallingConv());
+  Call->setAttributes(Target->getAttributes());
+  if (F->getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(Call);
+  ++NumFunctionsMerged;
+}
+
+/// Merges \p Members, which are all equivalent to the first member.
+static void mergeGroup(Module &M, ArrayRef<Function *> Members,
+                       ArrayRef<ConstantDiffs> Diffs,
+                       ArrayRef<OperandLoc> Locs, unsigned Size) {
+  Function *Ref = Members.front();
+  DEBUG(dbgs() << "Merging " << Members.size() << " functions into "
+               << Ref->getName() << '\n');
+  NumInstructionsRemoved += (Members.size() - 1) * Size;
+
+  // Completely equal functions just call the first one.
+  if (Locs.empty()) {
+    for (Function *F : Members.slice(1))
+      writeThunk(F, Ref, {});
+    return;
+  }
+
+  // Operand locations which have the same constants in all members share a
+  // parameter.
+  std::map<std::vector<Constant *>, unsigned> ParamIndices;
+  std::vector<std::vector<Constant *>> ParamConsts;
+  DenseMap<OperandLoc, unsigned> ParamOfLoc;
+  for (const OperandLoc &Loc : Locs) {
+    auto *RefConst = cast<Constant>(Loc.first->getOperand(Loc.second));
+    std::vector<Constant *> Consts;
+    Consts.push_back(RefConst);
+    for (const ConstantDiffs &D : Diffs.slice(1)) {
+      auto Iter = D.find(Loc);
+      Consts.push_back(Iter != D.end() ? Iter->second : RefConst);
+    }
+    auto Inserted = ParamIndices.insert({Consts, ParamConsts.size()});
+    if (Inserted.second)
+      ParamConsts.push_back(Consts);
+    ParamOfLoc[Loc] = Inserted.first->second;
+  }
+
+  FunctionType *RefTy = Ref->getFunctionType();
+  SmallVector<Type *, 8> ParamTypes(RefTy->param_begin(), RefTy->param_end());
+  for (auto &Consts : ParamConsts)
+    ParamTypes.push_back(Consts.front()->getType());
+  auto *NewTy = FunctionType::get(RefTy->getReturnType(), ParamTypes,
+                                  /*isVarArg*/ false);
+
+  Function *NewF = Function::Create(NewTy, GlobalValue::InternalLinkage,
+                                    Ref->getName() + "Tm", &M);
+  NewF->copyAttributesFrom(Ref);
+  NewF->setLinkage(GlobalValue::InternalLinkage);
+  NewF->setVisibility(GlobalValue::DefaultVisibility);
+  NewF->setDLLStorageClass(GlobalValue::DefaultStorageClass);
+  NewF->setComdat(nullptr);
+  ++NumMergedFunctions;
+
+  // Move the body of the reference function into the merged function.
+  NewF->getBasicBlockList().splice(NewF->begin(), Ref->getBasicBlockList());
+  auto NewArg = NewF->arg_begin();
+  for (Argument &RefArg : Ref->args()) {
+    RefArg.replaceAllUsesWith(&*NewArg);
+    NewArg->takeName(&RefArg);
+    ++NewArg;
+  }
+  SmallVector<Argument *, 4> ParamArgs;
+  for (; NewArg != NewF->arg_end(); ++NewArg)
+    ParamArgs.push_back(&*NewArg);
+  for (const OperandLoc &Loc : Locs)
+    Loc.first->setOperand(Loc.second, ParamArgs[ParamOfLoc[Loc]]);
+
+  for (unsigned Idx = 0, e = Members.size(); Idx != e; ++Idx) {
+    SmallVector<Value *, 4> Consts;
+    for (auto &C : ParamConsts)
+      Consts.push_back(C[Idx]);
+    writeThunk(Members[Idx], NewF, Consts);
+  }
+}
+
+bool SwiftMergeFunctions::runOnModule(Module &M) {
+  // Group the functions by their structure.
+  MapVector<size_t, SmallVector<Function *, 4>> Buckets;
+  DenseMap<Function *, unsigned> Sizes;
+  for (Function &F : M) {
+    if (unsigned Size = getMergeableSize(F)) {
+      if (Size < MergeMinInstructions)
+        continue;
+      Sizes[&F] = Size;
+      Buckets[size_t(hashFunction(F))].push_back(&F);
+    }
+  }
+
+  bool Changed = false;
+  for (auto &Bucket : Buckets) {
+    SmallVector<Function *, 4> Candidates = Bucket.second;
+    while (Candidates.size() > 1) {
+      Function *Ref = Candidates.front();
+      SmallVector<Function *, 4> Members;
+      SmallVector<ConstantDiffs, 4> Diffs;
+      SmallVector<OperandLoc, 4> Locs;
+      SmallVector<Function *, 4> Remaining;
+      Members.push_back(Ref);
+      Diffs.emplace_back();
+
+      for (Function *F : makeArrayRef(Candidates).slice(1)) {
+        ConstantDiffs D;
+        if (!isEquivalent(Ref, F, D)) {
+          Remaining.push_back(F);
+          continue;
+        }
+        // Bound the number of parameters of the merged function.
+        SmallVector<OperandLoc, 4> NewLocs(Locs.begin(), Locs.end());
+        for (auto &Entry : D) {
+          if (std::find(NewLocs.begin(), NewLocs.end(), Entry.first) ==
+              NewLocs.end())
+            NewLocs.push_back(Entry.first);
+        }
+        if (NewLocs.size() > MergeMaxParams) {
+          Remaining.push_back(F);
+          continue;
+        }
+        Locs = NewLocs;
+        Members.push_back(F);
+        Diffs.push_back(std::move(D));
+      }
+
+      if (Members.size() > 1) {
+        mergeGroup(M, Members, Diffs, Locs, Sizes[Ref]);
+        Changed = true;
+      }
+      Candidates = Remaining;
+    }
+  }
+  return Changed;
+}
@@ -1135,6 +1135,7 @@ bool SILParser::parseSILOpcode(ValueKind &Opcode, SourceLoc &OpcodeLoc,
     .Case("existential_metatype", ValueKind::ExistentialMetatypeInst)
     .Case("raw_pointer_to_ref", ValueKind::RawPointerToRefInst)
     .Case("ref_element_addr", ValueKind::RefElementAddrInst)
+    .Case("ref_tail_addr", ValueKind::RefTailAddrInst)
     .Case("ref_to_bridge_object", ValueKind::RefToBridgeObjectInst)
     .Case("ref_to_raw_pointer", ValueKind::RefToRawPointerInst)
     .Case("ref_to_unmanaged", ValueKind::RefToUnmanagedInst)
@@ -2200,9 +2201,23 @@ bool SILParser::parseSILInstruction(SILBasicBlock *BB) {
       if (parseSILDebugVar(VarInfo))
         return true;
       ResultVal = B.createAllocStack(InstLoc, Ty, VarInfo);
-    } else if (Opcode == ValueKind::AllocRefInst)
-      ResultVal = B.createAllocRef(InstLoc, Ty, IsObjC, OnStack);
-    else {
+    } else if (Opcode == ValueKind::AllocRefInst) {
+      // Parse the optional tail-allocated elements:
+      //   ', tail_elems' sil-type ',' sil-operand
+      if (P.consumeIf(tok::comma)) {
+        SILType TailTy;
+        SILValue TailCount;
+        if (parseVerbatim("tail_elems") ||
+            parseSILType(TailTy) ||
+            P.parseToken(tok::comma, diag::expected_tok_in_sil_instr, ",") ||
+            parseTypedValueRef(TailCount, B))
+          return true;
+        ResultVal = B.createAllocRef(InstLoc, Ty, IsObjC, OnStack, TailTy,
+                                     TailCount);
+      } else {
+        ResultVal = B.createAllocRef(InstLoc, Ty, IsObjC, OnStack);
+      }
+    } else {
       assert(Opcode == ValueKind::MetatypeInst);
       ResultVal = B.createMetatype(InstLoc, Ty);
     }
@@ -2718,6 +2733,15 @@ bool SILParser::parseSILInstruction(SILBasicBlock *BB) {
     ResultVal = B.createRefElementAddr(InstLoc, Val, Field, ResultTy);
     break;
   }
+  case ValueKind::RefTailAddrInst: {
+    SILType TailTy;
+    if (parseTypedValueRef(Val, B) ||
+        P.parseToken(tok::comma, diag::expected_tok_in_sil_instr, ",") ||
+        parseSILType(TailTy))
+      return true;
+    ResultVal = B.createRefTailAddr(InstLoc, Val, TailTy.getAddressType());
+    break;
+  }
   case ValueKind::IsNonnullInst: {
     SourceLoc Loc;
     if (parseTypedValueRef(Val, Loc, B))
@@ -131,6 +131,15 @@ setArgumentBoxToStack(unsigned ArgNo) {
   Args[ArgNo].first = ArgumentModifierIntBase(ArgumentModifier::BoxToStack);
 }
 
+void
+FunctionSignatureSpecializationMangler::
+setArgumentExistentialToConcrete(unsigned ArgNo,
+                                 SILInstruction *InitExistential) {
+  auto &Info = Args[ArgNo];
+  Info.first = ArgumentModifierIntBase(ArgumentModifier::ExistentialToConcrete);
+  Info.second = InitExistential;
+}
+
 void
 FunctionSignatureSpecializationMangler::mangleConstantProp(LiteralInst *LI) {
   Mangler &M = getMangler();
@@ -218,6 +227,22 @@ void FunctionSignatureSpecializationMangler::mangleClosureProp(
   M.mangleIdentifierSymbol(FRI->getReferencedFunction()->getName());
 }
 
+void FunctionSignatureSpecializationMangler::mangleExistentialToConcrete(
+    SILInstruction *InitExistential) {
+  Mangler &M = getMangler();
+  M.append("e");
+
+  // The concrete type is the only thing that distinguishes specializations of
+  // the same argument.
+  CanType ConcreteType;
+  if (auto *IEA = dyn_cast<InitExistentialAddrInst>(InitExistential))
+    ConcreteType = IEA->getFormalConcreteType();
+  else
+    ConcreteType = cast<InitExistentialRefInst>(InitExistential)
+                       ->getFormalConcreteType();
+  M.mangleType(ConcreteType, 0);
+}
+
 void FunctionSignatureSpecializationMangler::mangleArgument(
     ArgumentModifierIntBase ArgMod, NullablePtr<SILInstruction> Inst) {
   if (ArgMod == ArgumentModifierIntBase(ArgumentModifier::ConstantProp)) {
@@ -236,6 +261,12 @@ void FunctionSignatureSpecializationMangler::mangleArgument(
     return;
   }
 
+  if (ArgMod ==
+      ArgumentModifierIntBase(ArgumentModifier::ExistentialToConcrete)) {
+    mangleExistentialToConcrete(Inst.get());
+    return;
+  }
+
   if (ArgMod == ArgumentModifierIntBase(ArgumentModifier::Unmodified)) {
     M.append("n");
     return;
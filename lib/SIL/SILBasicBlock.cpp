@@ -160,6 +160,8 @@ SILBasicBlock *SILBasicBlock::splitBasicBlock(iterator I) {
   // Move all of the specified instructions from the original basic block into
   // the new basic block.
   New->InstList.splice(New->end(), InstList, I, end());
+  // Both halves of the block execute equally often.
+  New->ProfileCount = ProfileCount;
   return New;
 }
 
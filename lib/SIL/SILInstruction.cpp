@@ -238,7 +238,11 @@ namespace {
     }
 
     bool visitAllocRefInst(const AllocRefInst *RHS) {
-      return true;
+      auto *X = cast<AllocRefInst>(LHS);
+      if (X->hasTailAllocatedElements() != RHS->hasTailAllocatedElements())
+        return false;
+      return !X->hasTailAllocatedElements() ||
+             X->getTailAllocatedType() == RHS->getTailAllocatedType();
     }
 
     bool visitAllocRefDynamicInst(const AllocRefDynamicInst *RHS) {
@@ -343,6 +347,10 @@ namespace {
       return true;
     }
 
+    bool visitRefTailAddrInst(RefTailAddrInst *RHS) {
+      return true;
+    }
+
     bool visitStructElementAddrInst(const StructElementAddrInst *RHS) {
       // We have already checked that the operands of our struct_element_addrs
       // match. Thus we only need to check the field/struct decl which are not
@@ -73,9 +73,14 @@ VarDecl *AllocStackInst::getDecl() const {
 }
 
 AllocRefInst::AllocRefInst(SILDebugLocation *Loc, SILType elementType,
-                           SILFunction &F, bool objc, bool canBeOnStack)
+                           SILFunction &F, bool objc, bool canBeOnStack,
+                           SILType TailType, ArrayRef<SILValue> Count)
     : AllocationInst(ValueKind::AllocRefInst, Loc, elementType),
-      StackPromotable(canBeOnStack), ObjC(objc) {}
+      StackPromotable(canBeOnStack), ObjC(objc), TailType(TailType),
+      Operands(this, Count) {
+  assert(bool(TailType) == (Count.size() == 1) &&
+         "tail-allocated elements need exactly one count operand");
+}
 
 AllocBoxInst::AllocBoxInst(SILDebugLocation *Loc, SILType ElementType,
                            SILFunction &F, SILDebugVariable Var)
@@ -13,6 +13,7 @@
 #define DEBUG_TYPE "sil-module"
 #include "swift/SIL/SILModule.h"
 #include "Linker.h"
+#include "swift/AST/DiagnosticsCommon.h"
 #include "swift/SIL/SILDebugScope.h"
 #include "swift/SIL/SILVisitor.h"
 #include "swift/Serialization/SerializedSILLoader.h"
@@ -22,6 +23,8 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include <algorithm>
 #include <functional>
 using namespace swift;
 using namespace Lowering;
@@ -500,6 +503,62 @@ bool SILModule::linkFunction(StringRef Name, SILModule::LinkingMode Mode) {
   return SILLinkerVisitor(*this, getSILLoader(), Mode).processFunction(Name);
 }
 
+const SILFunctionSummary *SILModule::lookUpFunctionSummary(SILFunction *F) {
+  if (!F->isExternalDeclaration())
+    return nullptr;
+
+  auto Iter = ImportedFunctionSummaries.find(F->getName());
+  if (Iter == ImportedFunctionSummaries.end()) {
+    Optional<SILFunctionSummary> Summary =
+        getSILLoader()->lookupFunctionSummary(F->getName());
+    Iter = ImportedFunctionSummaries.insert({F->getName(), Summary}).first;
+  }
+  if (!Iter->second)
+    return nullptr;
+  return Iter->second.getPointer();
+}
+
+std::vector<StringRef> SILModule::getExportedSpecializationNames() const {
+  std::vector<StringRef> Names;
+  for (const SILFunction &F : *this) {
+    if (F.isKeepAsPublic() && F.isDefinition() &&
+        F.getLinkage() == SILLinkage::Public)
+      Names.push_back(F.getName());
+  }
+  for (auto &Entry : ExportedSpecializationNames)
+    Names.push_back(Entry.getKey());
+
+  std::sort(Names.begin(), Names.end());
+  Names.erase(std::unique(Names.begin(), Names.end()), Names.end());
+  return Names;
+}
+
+bool SILModule::hasExportedSpecialization(StringRef Name) {
+  return getSILLoader()->hasSpecialization(Name);
+}
+
+llvm::raw_ostream *SILModule::getOptRecordStream() {
+  if (!isOptRecordEnabled())
+    return nullptr;
+
+  if (!OptRecordStream) {
+    std::error_code EC;
+    auto *FDOS = new llvm::raw_fd_ostream(Options.OptRecordFile, EC,
+                                          llvm::sys::fs::F_Text);
+    OptRecordStream.reset(FDOS);
+    if (EC) {
+      getASTContext().Diags.diagnose(SourceLoc(), diag::error_opening_output,
+                                     Options.OptRecordFile, EC.message());
+      // Don't try again for every remark.
+      OptRecordStreamFailed = true;
+      FDOS->clear_error();
+      OptRecordStream.reset();
+      return nullptr;
+    }
+  }
+  return OptRecordStream.get();
+}
+
 void SILModule::linkAllWitnessTables() {
   getSILLoader()->getAllWitnessTables();
 }
@@ -508,6 +508,15 @@ public:
       for (auto Id : PredIDs)
         *this << ' ' << Id;
     }
+
+    if (auto Count = BB->getProfileCount()) {
+      if (BB->pred_empty())
+        PrintState.OS.PadToColumn(50);
+      else
+        *this << ' ';
+      *this << "// Count: ";
+      PrintState.OS << *Count;
+    }
     *this << '\n';
 
     for (const SILInstruction &I : *BB)
@@ -724,6 +733,10 @@ public:
     if (ARI->canAllocOnStack())
       *this << "[stack] ";
     *this << ARI->getType();
+    if (ARI->hasTailAllocatedElements()) {
+      *this << ", tail_elems " << ARI->getTailAllocatedType() << ", "
+            << getIDAndType(ARI->getTailAllocatedCount());
+    }
   }
 
   void visitAllocRefDynamicInst(AllocRefDynamicInst *ARDI) {
@@ -1171,6 +1184,10 @@ public:
     printFullContext(EI->getField()->getDeclContext(), PrintState.OS);
     *this << EI->getField()->getName().get();
   }
+  void visitRefTailAddrInst(RefTailAddrInst *RTAI) {
+    *this << "ref_tail_addr " << getIDAndType(RTAI->getOperand()) << ", "
+          << RTAI->getTailType();
+  }
 
   void printMethodInst(MethodInst *I, SILValue Operand, StringRef Name) {
     *this << Name << " ";
@@ -1571,6 +1588,8 @@ static void printLinkage(llvm::raw_ostream &OS, SILLinkage linkage,
 void SILFunction::print(llvm::raw_ostream &OS, bool Verbose,
                         bool SortedSIL) const {
   OS << "// " << demangleSymbolAsString(getName()) << '\n';
+  if (auto Count = getEntryCount())
+    OS << "// Entry count: " << *Count << '\n';
   OS << "sil ";
   printLinkage(OS, getLinkage(), isDefinition());
 
@@ -629,6 +629,16 @@ public:
 
   void checkAllocRefInst(AllocRefInst *AI) {
     requireReferenceValue(AI, "Result of alloc_ref");
+    if (AI->hasTailAllocatedElements()) {
+      require(!AI->isObjC(),
+              "alloc_ref [objc] cannot have tail-allocated elements");
+      require(AI->getType().getClassOrBoundGenericClass(),
+              "alloc_ref with tail-allocated elements must allocate a class");
+      require(AI->getTailAllocatedType().isObject(),
+              "type of tail-allocated elements must be an object type");
+      require(AI->getTailAllocatedCount()->getType().is<BuiltinIntegerType>(),
+              "count of tail-allocated elements must be a builtin integer");
+    }
   }
 
   void checkAllocRefDynamicInst(AllocRefDynamicInst *ARDI) {
@@ -1515,6 +1525,14 @@ public:
     EI->getFieldNo();  // Make sure we can access the field without crashing.
   }
 
+  void checkRefTailAddrInst(RefTailAddrInst *RTAI) {
+    requireReferenceValue(RTAI->getOperand(), "Operand of ref_tail_addr");
+    require(RTAI->getOperand()->getType().getClassOrBoundGenericClass(),
+            "ref_tail_addr operand must be a class instance");
+    require(RTAI->getType().isAddress(),
+            "result of ref_tail_addr must be lvalue");
+  }
+
   SILType getMethodSelfType(CanSILFunctionType ft) {
     return ft->getParameters().back().getSILType();
   }
@@ -25,6 +25,10 @@
 #include "llvm/ADT/DenseMap.h"
 #include <deque>
 
+namespace llvm {
+  class IndexedInstrProfReader;
+}
+
 namespace swift {
   class SILBasicBlock;
 
@@ -59,6 +63,10 @@ public:
   /// disabled.
   std::unique_ptr<SILGenProfiling> Profiler;
 
+  /// The profile data to attach to emitted functions, or null if we are not
+  /// compiling with -profile-use.
+  std::unique_ptr<llvm::IndexedInstrProfReader> PGOReader;
+
   /// Mapping from SILDeclRefs to emitted SILFunctions.
   llvm::DenseMap<SILDeclRef, SILFunction*> emittedFunctions;
   /// Mapping from ProtocolConformances to emitted SILWitnessTables.
@@ -20,6 +20,7 @@
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/ProfileData/CoverageMapping.h"
 #include "llvm/ProfileData/CoverageMappingWriter.h"
+#include "llvm/ProfileData/InstrProfReader.h"
 
 #include <forward_list>
 
@@ -29,10 +30,11 @@ using namespace Lowering;
 ProfilerRAII::ProfilerRAII(SILGenModule &SGM, AbstractFunctionDecl *D)
     : SGM(SGM) {
   const auto &Opts = SGM.M.getOptions();
-  if (!Opts.GenerateProfile)
+  if (!Opts.GenerateProfile && !SGM.PGOReader)
     return;
-  SGM.Profiler =
-      llvm::make_unique<SILGenProfiling>(SGM, Opts.EmitProfileCoverageMapping);
+  SGM.Profiler = llvm::make_unique<SILGenProfiling>(
+      SGM, Opts.GenerateProfile,
+      Opts.GenerateProfile && Opts.EmitProfileCoverageMapping);
   SGM.Profiler->assignRegionCounters(D);
 }
 
@@ -616,6 +618,15 @@ void SILGenProfiling::assignRegionCounters(AbstractFunctionDecl *Root) {
   // TODO: Mapper needs to calculate a function hash as it goes.
   FunctionHash = 0x0;
 
+  if (auto *Reader = SGM.PGOReader.get()) {
+    // A function that is missing from the profile, or whose counters no
+    // longer match it, simply gets no counts.
+    if (Reader->getFunctionCounts(CurrentFuncName, FunctionHash,
+                                  RegionCounts) ||
+        RegionCounts.size() != NumRegionCounters)
+      RegionCounts.clear();
+  }
+
   if (EmitCoverageMapping) {
     CoverageMapping Coverage(SGM.M.getASTContext().SourceMgr);
     walkForProfiling(Root, Coverage);
@@ -642,6 +653,17 @@ void SILGenProfiling::emitCounterIncrement(SILGenBuilder &Builder,ASTNode Node){
   assert(CounterIt != RegionCounterMap.end() &&
          "cannot increment non-existent counter");
 
+  if (!RegionCounts.empty()) {
+    uint64_t Count = RegionCounts[CounterIt->second];
+    SILBasicBlock *BB = Builder.getInsertionBB();
+    BB->setProfileCount(Count);
+    if (BB->isEntry())
+      BB->getParent()->setEntryCount(Count);
+  }
+
+  if (!EmitCounters)
+    return;
+
   auto Int32Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(32, C));
   auto Int64Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(64, C));
 
@@ -37,6 +37,7 @@ struct ProfilerRAII {
 class SILGenProfiling {
 private:
   SILGenModule &SGM;
+  bool EmitCounters;
   bool EmitCoverageMapping;
 
   // The current function's name and counter data.
@@ -45,19 +46,26 @@ private:
   uint64_t FunctionHash;
   llvm::DenseMap<ASTNode, unsigned> RegionCounterMap;
 
+  /// The counter values for the current function from the -profile-use
+  /// profile, or empty if it has none.
+  std::vector<uint64_t> RegionCounts;
+
   std::vector<std::tuple<std::string, uint64_t, std::string>> CoverageData;
 
 public:
-  SILGenProfiling(SILGenModule &SGM, bool EmitCoverageMapping)
-      : SGM(SGM), EmitCoverageMapping(EmitCoverageMapping),
-        NumRegionCounters(0), FunctionHash(0) {}
+  SILGenProfiling(SILGenModule &SGM, bool EmitCounters,
+                  bool EmitCoverageMapping)
+      : SGM(SGM), EmitCounters(EmitCounters),
+        EmitCoverageMapping(EmitCoverageMapping), NumRegionCounters(0),
+        FunctionHash(0) {}
 
   bool hasRegionCounters() const { return NumRegionCounters != 0; }
 
   /// Map counters to ASTNodes and set them up for profiling the given function.
   void assignRegionCounters(AbstractFunctionDecl *Root);
 
-  /// Emit SIL to increment the counter for \c Node.
+  /// Emit SIL to increment the counter for \c Node, and attach the counter's
+  /// value from the -profile-use profile to the current block.
   void emitCounterIncrement(SILGenBuilder &Builder, ASTNode Node);
 };
 
@@ -0,0 +1,315 @@
+//===--- ARCLoopHoisting.cpp - Hoist retains and releases out of loops ----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+/// Moves retains and releases of loop invariant references out of loops.
+///
+/// If a reference is retained and released the same number of times on every
+/// path through a loop, the retains and releases inside the loop are removed.
+/// Instead the reference is retained once in the loop preheader and released
+/// once in each loop exit. The object is then kept alive during the whole
+/// loop, which is at least as long as inside the loop before.
+///
+/// To make sure that the reference count inside the loop is never lower than
+/// before, the retain count of the reference relative to the loop header must
+/// not exceed one at any point in the loop. Loops which contain anything that
+/// may check the reference count, e.g. is_unique, are not optimized.
+///
+/// Loops are visited bottom-up, so that retains which are hoisted into the
+/// body of an outer loop can be hoisted further.
+///
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "arc-loop-hoisting"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SIL/SILBuilder.h"
+#include "swift/SILOptimizer/Analysis/ARCAnalysis.h"
+#include "swift/SILOptimizer/Analysis/DominanceAnalysis.h"
+#include "swift/SILOptimizer/Analysis/LoopAnalysis.h"
+#include "swift/SILOptimizer/Analysis/RCIdentityAnalysis.h"
+#include "swift/SILOptimizer/Analysis/SideEffectAnalysis.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Utils/CFG.h"
+#include "swift/SILOptimizer/Utils/LoopUtils.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+using namespace swift;
+
+STATISTIC(NumRetainsHoisted, "Number of retains hoisted out of loops");
+STATISTIC(NumReleasesSunk, "Number of releases sunk out of loops");
+
+namespace {
+
+/// The retains and releases of a single reference in a loop.
+struct RefCountOps {
+  llvm::SmallVector<SILInstruction *, 4> Retains;
+  llvm::SmallVector<SILInstruction *, 4> Releases;
+};
+
+class LoopARCHoister : public SILLoopVisitor {
+  SILLoopInfo *LI;
+  DominanceInfo *DI;
+  RCIdentityFunctionInfo *RCFI;
+  SideEffectAnalysis *SEA;
+  bool Changed = false;
+
+  bool mayCheckRefCountInLoop(SILLoop *L);
+  bool isBalanced(SILLoop *L, SILValue Root);
+  bool getExitBlocks(SILLoop *L, llvm::SmallVectorImpl<SILBasicBlock *> &Exits);
+
+public:
+  LoopARCHoister(SILFunction *F, SILLoopInfo *LI, DominanceInfo *DI,
+                 RCIdentityFunctionInfo *RCFI, SideEffectAnalysis *SEA)
+      : SILLoopVisitor(F, LI), LI(LI), DI(DI), RCFI(RCFI), SEA(SEA) {}
+
+  bool madeChange() const { return Changed; }
+
+  void runOnLoop(SILLoop *L) override;
+  void runOnFunction(SILFunction *F) override {}
+};
+
+} // end anonymous namespace
+
+static bool isRetain(SILInstruction *I) {
+  return isa<StrongRetainInst>(I) || isa<RetainValueInst>(I);
+}
+
+static bool isRelease(SILInstruction *I) {
+  return isa<StrongReleaseInst>(I) || isa<ReleaseValueInst>(I);
+}
+
+/// Returns true if anything in the loop may observe the reference count of an
+/// object, other than by retaining or releasing it.
+bool LoopARCHoister::mayCheckRefCountInLoop(SILLoop *L) {
+  for (auto *BB : L->getBlocks()) {
+    for (auto &I : *BB) {
+      if (mayCheckRefCount(&I))
+        return true;
+      if (auto FAS = FullApplySite::isa(&I)) {
+        SideEffectAnalysis::FunctionEffects E;
+        SEA->getEffects(E, FAS);
+        if (E.mayReadRC())
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
+/// Returns true if the retains and releases of \p Root cancel out on every
+/// path from the loop header to a back edge or a loop exit, and the number of
+/// outstanding retains never exceeds one.
+bool LoopARCHoister::isBalanced(SILLoop *L, SILValue Root) {
+  SILBasicBlock *Header = L->getHeader();
+
+  // The number of outstanding retains of Root at the entry of each block.
+  llvm::DenseMap<SILBasicBlock *, int> EntryCount;
+  llvm::SmallVector<SILBasicBlock *, 16> Worklist;
+  EntryCount[Header] = 0;
+  Worklist.push_back(Header);
+
+  while (!Worklist.empty()) {
+    SILBasicBlock *BB = Worklist.pop_back_val();
+    int Count = EntryCount[BB];
+    for (auto &I : *BB) {
+      if (isRetain(&I) && RCFI->getRCIdentityRoot(I.getOperand(0)) == Root) {
+        if (++Count > 1)
+          return false;
+      } else if (isRelease(&I) &&
+                 RCFI->getRCIdentityRoot(I.getOperand(0)) == Root) {
+        --Count;
+      }
+    }
+
+    for (SILBasicBlock *Succ : BB->getSuccessors()) {
+      // The count must be back to zero when leaving the iteration.
+      if (Succ == Header || !L->contains(Succ)) {
+        if (Count != 0)
+          return false;
+        continue;
+      }
+      auto Iter = EntryCount.find(Succ);
+      if (Iter == EntryCount.end()) {
+        EntryCount[Succ] = Count;
+        Worklist.push_back(Succ);
+      } else if (Iter->second != Count) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Collects the blocks in which the hoisted releases are inserted, splitting
+/// exit edges if the exit block also has predecessors outside of the loop.
+///
+/// \returns false, without changing the function, if an exit edge can't be
+/// split.
+bool LoopARCHoister::getExitBlocks(
+    SILLoop *L, llvm::SmallVectorImpl<SILBasicBlock *> &Exits) {
+  llvm::SmallVector<std::pair<TermInst *, unsigned>, 8> EdgesToSplit;
+  for (SILBasicBlock *BB : L->getBlocks()) {
+    TermInst *Term = BB->getTerminator();
+    auto Succs = BB->getSuccessors();
+    for (unsigned Idx = 0, e = Succs.size(); Idx != e; ++Idx) {
+      SILBasicBlock *Succ = Succs[Idx];
+      if (L->contains(Succ))
+        continue;
+      if (Succ->getSinglePredecessor()) {
+        // A block may branch to the same exit block more than once.
+        if (std::find(Exits.begin(), Exits.end(), Succ) == Exits.end())
+          Exits.push_back(Succ);
+        continue;
+      }
+      // Only critical edges can be split.
+      if (!isCriticalEdge(Term, Idx))
+        return false;
+      EdgesToSplit.push_back({Term, Idx});
+    }
+  }
+
+  for (auto &Edge : EdgesToSplit) {
+    SILBasicBlock *SplitBB = splitCriticalEdge(Edge.first, Edge.second, DI, LI);
+    assert(SplitBB && "a critical edge can always be split");
+    Exits.push_back(SplitBB);
+    Changed = true;
+  }
+  return true;
+}
+
+void LoopARCHoister::runOnLoop(SILLoop *L) {
+  SILBasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader)
+    return;
+
+  // Collect the retains and releases of references which are defined outside
+  // of the loop.
+  llvm::MapVector<SILValue, RefCountOps> OpsByRoot;
+  for (auto *BB : L->getBlocks()) {
+    for (auto &I : *BB) {
+      bool Retain = isRetain(&I);
+      if (!Retain && !isRelease(&I))
+        continue;
+      SILValue Root = RCFI->getRCIdentityRoot(I.getOperand(0));
+      SILBasicBlock *DefBB = Root->getParentBB();
+      if (!DefBB || L->contains(DefBB))
+        continue;
+      if (Retain)
+        OpsByRoot[Root].Retains.push_back(&I);
+      else
+        OpsByRoot[Root].Releases.push_back(&I);
+    }
+  }
+
+  llvm::SmallVector<SILValue, 4> RootsToHoist;
+  for (auto &Entry : OpsByRoot) {
+    if (Entry.second.Retains.empty() || Entry.second.Releases.empty())
+      continue;
+    if (isBalanced(L, Entry.first))
+      RootsToHoist.push_back(Entry.first);
+  }
+  if (RootsToHoist.empty() || mayCheckRefCountInLoop(L))
+    return;
+
+  llvm::SmallVector<SILBasicBlock *, 4> Exits;
+  if (!getExitBlocks(L, Exits))
+    return;
+
+  for (SILValue Root : RootsToHoist) {
+    RefCountOps &Ops = OpsByRoot[Root];
+    DEBUG(llvm::dbgs() << "Hoisting " << Ops.Retains.size()
+                       << " retain(s) of " << Root << "  out of " << *L);
+
+    bool IsRef = Root->getType().isReferenceCounted(Preheader->getModule());
+    SILBuilderWithScope Builder(Preheader->getTerminator(),
+                                Ops.Retains.front());
+    SILLocation Loc = Ops.Retains.front()->getLoc();
+    if (IsRef)
+      Builder.createStrongRetain(Loc, Root);
+    else
+      Builder.createRetainValue(Loc, Root);
+
+    for (SILBasicBlock *ExitBB : Exits) {
+      SILBuilderWithScope ExitBuilder(&*ExitBB->begin(), Ops.Releases.front());
+      SILLocation ReleaseLoc = Ops.Releases.front()->getLoc();
+      if (IsRef)
+        ExitBuilder.createStrongRelease(ReleaseLoc, Root);
+      else
+        ExitBuilder.createReleaseValue(ReleaseLoc, Root);
+    }
+
+    NumRetainsHoisted += Ops.Retains.size();
+    NumReleasesSunk += Ops.Releases.size();
+    for (SILInstruction *I : Ops.Retains)
+      I->eraseFromParent();
+    for (SILInstruction *I : Ops.Releases)
+      I->eraseFromParent();
+  }
+  Changed = true;
+}
+
+//===----------------------------------------------------------------------===//
+//                              Top Level Driver
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class ARCLoopHoisting : public SILFunctionTransform {
+
+  void run() override {
+    auto *F = getFunction();
+
+    // If ARC optimizations are disabled, don't optimize anything and bail.
+    if (!getOptions().EnableARCOptimizations)
+      return;
+
+    auto *LA = getAnalysis<SILLoopAnalysis>();
+    auto *LI = LA->get(F);
+    if (LI->empty())
+      return;
+
+    auto *DA = getAnalysis<DominanceAnalysis>();
+    auto *DI = DA->get(F);
+
+    // Canonicalize the loops, invalidating if we need to.
+    bool CFGChanged = canonicalizeAllLoops(DI, LI);
+
+    auto *RCFI = getAnalysis<RCIdentityAnalysis>()->get(F);
+    auto *SEA = getAnalysis<SideEffectAnalysis>();
+
+    LoopARCHoister Hoister(F, LI, DI, RCFI, SEA);
+    Hoister.run();
+
+    // Splitting exit edges and canonicalizing loops keeps loop info and the
+    // dominator tree up to date.
+    if (CFGChanged || Hoister.madeChange()) {
+      DA->lockInvalidation();
+      LA->lockInvalidation();
+      PM->invalidateAnalysis(F, SILAnalysis::InvalidationKind::FunctionBody);
+      DA->unlockInvalidation();
+      LA->unlockInvalidation();
+    }
+  }
+
+  StringRef getName() override { return "ARC Loop Hoisting"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createARCLoopHoisting() {
+  return new ARCLoopHoisting();
+}
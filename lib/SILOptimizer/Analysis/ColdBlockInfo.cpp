@@ -100,7 +100,22 @@ bool ColdBlockInfo::isSlowPath(const SILBasicBlock *FromBB, const SILBasicBlock
   return ToBB == ColdTarget;
 }
 
-/// \return true if the given block is dominated by a _slowPath branch hint.
+Optional<uint64_t> ColdBlockInfo::getProfileCount(const SILBasicBlock *BB,
+                                                  DominanceInfo *DT) {
+  auto *Node = DT->getNode(const_cast<SILBasicBlock*>(BB));
+  while (Node) {
+    if (auto Count = Node->getBlock()->getProfileCount())
+      return Count;
+    Node = Node->getIDom();
+  }
+  return None;
+}
+
+/// \return true if the given block is dominated by a _slowPath branch hint,
+/// or was never executed according to -profile-use data.
+///
+/// The profile count of the closest block that has one takes precedence over
+/// any branch hints dominating that block.
 ///
 /// Cache all blocks visited to avoid introducing quadratic behavior.
 bool ColdBlockInfo::isCold(const SILBasicBlock *BB) {
@@ -118,7 +133,12 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB) {
   std::vector<const SILBasicBlock*> DomChain;
   DomChain.push_back(BB);
   bool IsCold = false;
-  Node = Node->getIDom();
+  if (auto Count = BB->getProfileCount()) {
+    IsCold = *Count == 0;
+    Node = nullptr;
+  } else {
+    Node = Node->getIDom();
+  }
   while (Node) {
     if (isSlowPath(Node->getBlock(), DomChain.back())) {
       IsCold = true;
@@ -130,6 +150,10 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB) {
       break;
     }
     DomChain.push_back(Node->getBlock());
+    if (auto Count = Node->getBlock()->getProfileCount()) {
+      IsCold = *Count == 0;
+      break;
+    }
     Node = Node->getIDom();
   }
   for (auto *ChainBB : DomChain)
@@ -17,11 +17,18 @@
 #include "swift/SILOptimizer/Analysis/ValueTracking.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILArgument.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace swift;
 
+STATISTIC(NumConGraphsBuilt, "Number of (re)built connection graphs");
+STATISTIC(NumCallersKept,
+          "Number of invalidated functions whose callers stayed valid");
+STATISTIC(NumCallersInvalidated,
+          "Number of invalidated functions whose callers were invalidated");
+
 static bool isProjection(ValueBase *V) {
   switch (V->getKind()) {
     case ValueKind::IndexAddrInst:
@@ -1034,6 +1041,7 @@ void EscapeAnalysis::buildConnectionGraph(FunctionInfo *FInfo,
         FInfo->Graph.F->getName() << '\n');
 
   FInfo->NeedUpdateSummaryGraph = true;
+  ++NumConGraphsBuilt;
 
   ConnectionGraph *ConGraph = &FInfo->Graph;
   assert(ConGraph->isEmpty());
@@ -1172,6 +1180,13 @@ void EscapeAnalysis::analyzeInstruction(SILInstruction *I,
       if (Fn->getName() == "swift_bufferAllocate")
         // The call is a buffer allocation, e.g. for Array.
         return;
+
+      // Use the summary of an external function, if its module has one.
+      if (Fn->isExternalDeclaration()) {
+        if (auto *Summary = M->lookUpFunctionSummary(Fn))
+          if (mergeFunctionSummary(FAS, Summary, ConGraph))
+            return;
+      }
     }
   }
   if (isProjection(I))
@@ -1226,8 +1241,10 @@ void EscapeAnalysis::analyzeInstruction(SILInstruction *I,
     }
     case ValueKind::LoadInst:
     case ValueKind::LoadWeakInst:
-    // We treat ref_element_addr like a load (see NodeType::Content).
+    // We treat ref_element_addr and ref_tail_addr like a load (see
+    // NodeType::Content).
     case ValueKind::RefElementAddrInst:
+    case ValueKind::RefTailAddrInst:
     case ValueKind::ProjectBoxInst:
     case ValueKind::InitExistentialAddrInst:
     case ValueKind::OpenExistentialAddrInst:
@@ -1412,6 +1429,45 @@ void EscapeAnalysis::setAllEscaping(SILInstruction *I,
   setEscapesGlobal(ConGraph, I);
 }
 
+bool EscapeAnalysis::mergeFunctionSummary(FullApplySite FAS,
+                                          const SILFunctionSummary *Summary,
+                                          ConnectionGraph *CallerGraph) {
+  unsigned NumArgs = FAS.getNumArguments();
+  if (Summary->getNumParameters() != NumArgs ||
+      FAS.getOrigCalleeType()->isCalleeConsumed())
+    return false;
+
+  // The summary does not tell where the callee stores a value it writes
+  // through a parameter, e.g. into the content of another parameter. So
+  // give up on such callees.
+  for (unsigned Idx = 0; Idx < NumArgs; ++Idx) {
+    if (Summary->getParameterEffects(Idx) & SILFunctionSummary::Writes)
+      return false;
+  }
+
+  for (unsigned Idx = 0; Idx < NumArgs; ++Idx) {
+    unsigned Depth = Summary->getNoEscapeDepth(Idx);
+    if (Depth == SILFunctionSummary::NoEscapeUnlimited)
+      continue;
+    CGNode *Node = CallerGraph->getNode(FAS.getArgument(Idx), this);
+    if (!Node)
+      continue;
+    // Everything from the first escaping level of indirection on escapes.
+    for (unsigned Level = 0; Level < Depth; ++Level)
+      Node = CallerGraph->getContentNode(Node);
+    CallerGraph->setEscapesGlobal(Node);
+  }
+
+  // We don't know where the results of the call come from.
+  if (auto *TAI = dyn_cast<TryApplyInst>(FAS.getInstruction())) {
+    setEscapesGlobal(CallerGraph, TAI->getNormalBB()->getBBArg(0));
+    setEscapesGlobal(CallerGraph, TAI->getErrorBB()->getBBArg(0));
+  } else {
+    setEscapesGlobal(CallerGraph, FAS.getInstruction());
+  }
+  return true;
+}
+
 void EscapeAnalysis::recompute(FunctionInfo *Initial) {
   allocNewUpdateID();
 
@@ -1447,6 +1503,9 @@ void EscapeAnalysis::recompute(FunctionInfo *Initial) {
         // summary graph will change.
         SummaryGraphChanged = mergeSummaryGraph(&FInfo->SummaryGraph,
                                                 &FInfo->Graph);
+        // For a pending function this is a merge into the old summary graph.
+        if (FInfo->IsPending && SummaryGraphChanged)
+          FInfo->SummaryGraphGotWorse = true;
         FInfo->NeedUpdateSummaryGraph = false;
       }
 
@@ -1495,6 +1554,13 @@ void EscapeAnalysis::recompute(FunctionInfo *Initial) {
 
   for (FunctionInfo *FInfo : BottomUpOrder) {
     if (BottomUpOrder.wasRecomputedWithCurrentUpdateID(FInfo)) {
+      if (FInfo->IsPending) {
+        // The summary graph of a pending function still contains the old
+        // summary graph. Rebuild it from the new graph only, which can only
+        // make it more precise.
+        FInfo->SummaryGraph.clear();
+        mergeSummaryGraph(&FInfo->SummaryGraph, &FInfo->Graph);
+      }
       FInfo->Graph.computeUsePoints();
       FInfo->Graph.verify();
       FInfo->SummaryGraph.verify();
@@ -1729,6 +1795,8 @@ bool EscapeAnalysis::canParameterEscape(FullApplySite FAS, int ParamIdx,
   if (!Callees.allCalleesVisible())
     return true;
 
+  updatePendingFunctions();
+
   // Derive the connection graph of the apply from the known callees.
   for (SILFunction *Callee : Callees) {
     FunctionInfo *FInfo = getFunctionInfo(Callee);
@@ -1752,27 +1820,97 @@ bool EscapeAnalysis::canParameterEscape(FullApplySite FAS, int ParamIdx,
   return false;
 }
 
+unsigned EscapeAnalysis::getParameterNoEscapeDepth(SILFunction *F,
+                                                   unsigned ParamIdx) {
+  updatePendingFunctions();
+  FunctionInfo *FInfo = getFunctionInfo(F);
+  if (!FInfo->isValid())
+    recompute(FInfo);
+
+  llvm::SmallPtrSet<CGNode *, 8> Visited;
+  CGNode *Node = FInfo->SummaryGraph.getNodeOrNull(F->getArgument(ParamIdx),
+                                                   this);
+  for (unsigned Depth = 0; Depth < SILFunctionSummary::NoEscapeUnlimited;
+       ++Depth) {
+    // Nothing escapes if we reach the end of the content chain or a cycle
+    // without seeing an escaping node.
+    if (!Node || !Visited.insert(Node).second)
+      return SILFunctionSummary::NoEscapeUnlimited;
+    if (Node->escapes())
+      return Depth;
+    Node = Node->getContentNodeOrNull();
+  }
+  // The chain is too long to be represented in a summary. Conservatively
+  // assume that the rest of it escapes.
+  return SILFunctionSummary::NoEscapeUnlimited - 1;
+}
+
+void EscapeAnalysis::updatePendingFunctions() {
+  while (!PendingFunctions.empty()) {
+    FunctionInfo *FInfo = PendingFunctions.pop_back_val();
+    // The function may have been invalidated together with its callers in
+    // the meantime.
+    if (!FInfo->IsPending)
+      continue;
+    if (!FInfo->isValid())
+      recompute(FInfo);
+    FInfo->IsPending = false;
+
+    // The callers are still correct if the new graph did not add anything to
+    // the summary graph they were computed with.
+    if (FInfo->SummaryGraphGotWorse) {
+      DEBUG(llvm::dbgs() << "  invalidate callers of " <<
+            FInfo->Graph.F->getName() << '\n');
+      FInfo->SummaryGraphGotWorse = false;
+      ++NumCallersInvalidated;
+      invalidateCallers(FInfo);
+    } else {
+      ++NumCallersKept;
+    }
+  }
+}
+
 void EscapeAnalysis::invalidate(InvalidationKind K) {
   Function2Info.clear();
+  PendingFunctions.clear();
   Allocator.DestroyAll();
   DEBUG(llvm::dbgs() << "invalidate all\n");
 }
 
 void EscapeAnalysis::invalidate(SILFunction *F, InvalidationKind K) {
-  if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
-    DEBUG(llvm::dbgs() << "  invalidate " << FInfo->Graph.F->getName() << '\n');
+  FunctionInfo *FInfo = Function2Info.lookup(F);
+  if (!FInfo)
+    return;
+
+  DEBUG(llvm::dbgs() << "  invalidate " << FInfo->Graph.F->getName() << '\n');
+  // If functions were deleted, the summary graph may refer to a dead
+  // function. Be conservative and invalidate the callers right away.
+  if (K & InvalidationKind::Functions) {
     invalidateIncludingAllCallers(FInfo);
+    return;
   }
+  // Nothing to do if the function is already invalid: either it's pending or
+  // its callers are already invalidated.
+  if (!FInfo->isValid())
+    return;
+
+  // Keep the summary graph and defer the invalidation of the callers until we
+  // know whether the summary graph actually changed.
+  FInfo->Graph.clear();
+  invalidateKeepingCallers(FInfo);
+  FInfo->IsPending = true;
+  PendingFunctions.push_back(FInfo);
 }
 
 void EscapeAnalysis::handleDeleteNotification(ValueBase *I) {
   if (SILBasicBlock *Parent = I->getParentBB()) {
     SILFunction *F = Parent->getParent();
     if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
-      if (FInfo->isValid()) {
+      if (FInfo->isValid())
         FInfo->Graph.removeFromGraph(I);
+      // The summary graph of a pending function is kept on invalidation.
+      if (FInfo->isValid() || FInfo->IsPending)
         FInfo->SummaryGraph.removeFromGraph(I);
-      }
     }
   }
 }
@@ -16,9 +16,16 @@
 #include "swift/SILOptimizer/Analysis/FunctionOrder.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILArgument.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace swift;
 
+STATISTIC(NumFunctionsAnalyzed, "Number of (re)analyzed functions");
+STATISTIC(NumCallersKept,
+          "Number of invalidated functions whose callers stayed valid");
+STATISTIC(NumCallersInvalidated,
+          "Number of invalidated functions whose callers were invalidated");
+
 using FunctionEffects = SideEffectAnalysis::FunctionEffects;
 using Effects = SideEffectAnalysis::Effects;
 using MemoryBehavior = SILInstruction::MemoryBehavior;
@@ -94,6 +101,7 @@ static SILValue skipAddrProjections(SILValue V) {
       case ValueKind::StructElementAddrInst:
       case ValueKind::TupleElementAddrInst:
       case ValueKind::RefElementAddrInst:
+      case ValueKind::RefTailAddrInst:
       case ValueKind::ProjectBoxInst:
       case ValueKind::UncheckedTakeEnumDataAddrInst:
       case ValueKind::PointerToAddressInst:
@@ -171,6 +179,37 @@ bool SideEffectAnalysis::getDefinedEffects(FunctionEffects &Effects,
   return false;
 }
 
+bool SideEffectAnalysis::getSummaryEffects(FunctionEffects &Effects,
+                                           SILFunction *F) {
+  const SILFunctionSummary *Summary = F->getModule().lookUpFunctionSummary(F);
+  if (!Summary)
+    return false;
+
+  auto setSummaryEffects = [](Effects &E, unsigned SummaryEffects) {
+    E.Reads = SummaryEffects & SILFunctionSummary::Reads;
+    E.Writes = SummaryEffects & SILFunctionSummary::Writes;
+    E.Retains = SummaryEffects & SILFunctionSummary::Retains;
+    E.Releases = SummaryEffects & SILFunctionSummary::Releases;
+  };
+
+  // The effects of a declaration don't have any parameters yet.
+  unsigned NumParams = Summary->getNumParameters();
+  if (Effects.ParamEffects.empty())
+    Effects.ParamEffects.resize(NumParams);
+  else if (Effects.ParamEffects.size() != NumParams)
+    return false;
+
+  setSummaryEffects(Effects.GlobalEffects, Summary->getGlobalEffects());
+  for (unsigned Idx = 0; Idx < NumParams; ++Idx)
+    setSummaryEffects(Effects.ParamEffects[Idx],
+                      Summary->getParameterEffects(Idx));
+  unsigned Flags = Summary->getFlags();
+  Effects.AllocsObjects = Flags & SILFunctionSummary::AllocsObjects;
+  Effects.Traps = Flags & SILFunctionSummary::Traps;
+  Effects.ReadsRC = Flags & SILFunctionSummary::ReadsRC;
+  return true;
+}
+
 bool SideEffectAnalysis::getSemanticEffects(FunctionEffects &FE,
                                             ArraySemanticsCall ASC) {
   assert(ASC.hasSelf());
@@ -253,6 +292,13 @@ void SideEffectAnalysis::analyzeFunction(FunctionInfo *FInfo,
   }
   
   if (!FInfo->F->isDefinition()) {
+    // Use the summary which was computed when the module of the function was
+    // compiled, if there is one.
+    if (getSummaryEffects(FInfo->FE, FInfo->F)) {
+      DEBUG(llvm::dbgs() << "  -- has summary " <<
+            FInfo->F->getName() << '\n');
+      return;
+    }
     // We can't assume anything about external functions.
     DEBUG(llvm::dbgs() << "  -- is external " << FInfo->F->getName() << '\n');
     FInfo->FE.setWorstEffects();
@@ -260,6 +306,7 @@ void SideEffectAnalysis::analyzeFunction(FunctionInfo *FInfo,
   }
   
   DEBUG(llvm::dbgs() << "  >> analyze " << FInfo->F->getName() << '\n');
+  ++NumFunctionsAnalyzed;
 
   // Check all instructions of the function
   for (auto &BB : *FInfo->F) {
@@ -289,6 +336,16 @@ void SideEffectAnalysis::analyzeInstruction(FunctionInfo *FInfo,
       // Does the function have any @effects?
       if (getDefinedEffects(FInfo->FE, SingleCallee))
         return;
+
+      // Does the function have a summary from its module?
+      if (SingleCallee->isExternalDeclaration() &&
+          !FAS.getOrigCalleeType()->isCalleeConsumed()) {
+        FunctionEffects ApplyEffects(FAS.getNumArguments());
+        if (getSummaryEffects(ApplyEffects, SingleCallee)) {
+          FInfo->FE.mergeFromApply(ApplyEffects, FAS);
+          return;
+        }
+      }
     }
 
     if (RecursionDepth < MaxRecursionDepth) {
@@ -468,6 +525,12 @@ void SideEffectAnalysis::getEffects(FunctionEffects &ApplyEffects, FullApplySite
     // Does the function have any @effects?
     if (getDefinedEffects(ApplyEffects, SingleCallee))
       return;
+
+    // Does the function have a summary from its module?
+    if (SingleCallee->isExternalDeclaration() &&
+        !FAS.getOrigCalleeType()->isCalleeConsumed() &&
+        getSummaryEffects(ApplyEffects, SingleCallee))
+      return;
   }
 
   auto Callees = BCA->getCalleeList(FAS);
@@ -488,17 +551,63 @@ void SideEffectAnalysis::getEffects(FunctionEffects &ApplyEffects, FullApplySite
   }
 }
 
+void SideEffectAnalysis::updatePendingFunctions() {
+  while (!PendingFunctions.empty()) {
+    FunctionInfo *FInfo = PendingFunctions.pop_back_val();
+    // The function may have been invalidated together with its callers in
+    // the meantime.
+    if (!FInfo->IsPending)
+      continue;
+    FInfo->IsPending = false;
+    if (!FInfo->isValid())
+      recompute(FInfo);
+
+    // The callers are still correct if the old side-effects include the new
+    // ones.
+    FunctionEffects Merged = FInfo->OldFE;
+    FInfo->OldFE = FunctionEffects();
+    if (Merged.mergeFrom(FInfo->FE)) {
+      DEBUG(llvm::dbgs() << "  invalidate callers of " <<
+            FInfo->F->getName() << '\n');
+      ++NumCallersInvalidated;
+      invalidateCallers(FInfo);
+    } else {
+      ++NumCallersKept;
+    }
+  }
+}
+
 void SideEffectAnalysis::invalidate(InvalidationKind K) {
   Function2Info.clear();
+  PendingFunctions.clear();
   Allocator.DestroyAll();
   DEBUG(llvm::dbgs() << "invalidate all\n");
 }
 
 void SideEffectAnalysis::invalidate(SILFunction *F, InvalidationKind K) {
-  if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
-    DEBUG(llvm::dbgs() << "  invalidate " << FInfo->F->getName() << '\n');
+  FunctionInfo *FInfo = Function2Info.lookup(F);
+  if (!FInfo)
+    return;
+
+  DEBUG(llvm::dbgs() << "  invalidate " << FInfo->F->getName() << '\n');
+  // If functions were deleted, the old side-effects may refer to a dead
+  // function. Be conservative and invalidate the callers right away.
+  if (K & InvalidationKind::Functions) {
     invalidateIncludingAllCallers(FInfo);
+    return;
   }
+  // Nothing to do if the function is already invalid: either it's pending or
+  // its callers are already invalidated.
+  if (!FInfo->isValid())
+    return;
+
+  // Defer the invalidation of the callers until we know whether the
+  // side-effects of the function actually changed.
+  FInfo->OldFE = FInfo->FE;
+  FInfo->FE.clear();
+  invalidateKeepingCallers(FInfo);
+  FInfo->IsPending = true;
+  PendingFunctions.push_back(FInfo);
 }
 
 SILAnalysis *swift::createSideEffectAnalysis(SILModule *M) {
@@ -0,0 +1,201 @@
+//===--- ClassMethodDevirtualizer.cpp - Devirtualize class methods --------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Replaces class_method calls by direct calls if the method has only a single
+// implementation in the class of the instance and all of its subclasses.
+//
+// In whole-module compilation all subclasses of an internal or private class
+// are visible, and so are all overrides of an internal or private method. The
+// pass looks up the method in the vtables of the class and its subclasses; if
+// all of them contain the same implementation, the method is effectively final
+// for this class, even if it is overridden somewhere else in the hierarchy.
+//
+// Unlike the function-level devirtualizer, this also handles instances whose
+// type is a generic parameter constrained to a class, e.g. in the protocol
+// witness thunks of non-final classes, which upcast Self to the class before
+// calling the method.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "class-method-devirtualizer"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SIL/SILInstruction.h"
+#include "swift/SIL/SILModule.h"
+#include "swift/SIL/InstructionUtils.h"
+#include "swift/SILOptimizer/Analysis/ClassHierarchyAnalysis.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Utils/Devirtualize.h"
+#include "swift/SILOptimizer/Utils/Local.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+using namespace swift;
+
+STATISTIC(NumDynamicDispatchesRemoved,
+          "Number of class_method calls replaced by direct calls");
+
+namespace {
+
+class ClassMethodDevirtualizer : public SILModuleTransform {
+  ClassHierarchyAnalysis *CHA = nullptr;
+
+  /// Caches the implementation of a method which is shared by a class and
+  /// all of its subclasses, or null if there is none.
+  llvm::DenseMap<std::pair<ClassDecl *, SILDeclRef>, SILFunction *>
+    UniqueImplementations;
+
+  SILFunction *getUniqueImplementation(ClassDecl *CD, SILDeclRef Member);
+  bool devirtualizeApply(FullApplySite AI);
+
+  void run() override;
+
+  StringRef getName() override { return "Class Method Devirtualizer"; }
+};
+
+} // end anonymous namespace
+
+/// Returns the class declaration of a class or class metatype type.
+static ClassDecl *getClassDecl(SILType Ty, SILModule &M) {
+  if (Ty.is<MetatypeType>())
+    Ty = Ty.getMetatypeInstanceType(M);
+  return Ty.getClassOrBoundGenericClass();
+}
+
+SILFunction *
+ClassMethodDevirtualizer::getUniqueImplementation(ClassDecl *CD,
+                                                  SILDeclRef Member) {
+  auto Key = std::make_pair(CD, Member);
+  auto Iter = UniqueImplementations.find(Key);
+  if (Iter != UniqueImplementations.end())
+    return Iter->second;
+
+  SILModule &M = *getModule();
+  SILFunction *Impl = M.lookUpFunctionInVTable(CD, Member);
+
+  // Note that getDirectSubClasses must not be called for a class without
+  // subclasses, because it would register the class as having subclasses.
+  if (Impl && CHA->hasKnownDirectSubclasses(CD)) {
+    auto isSameImpl = [&](ClassDecl *Sub) {
+      return M.lookUpFunctionInVTable(Sub, Member) == Impl;
+    };
+    const auto &DirectSubs = CHA->getDirectSubClasses(CD);
+    const auto &IndirectSubs = CHA->getIndirectSubClasses(CD);
+    if (!std::all_of(DirectSubs.begin(), DirectSubs.end(), isSameImpl) ||
+        !std::all_of(IndirectSubs.begin(), IndirectSubs.end(), isSameImpl))
+      Impl = nullptr;
+  }
+
+  UniqueImplementations[Key] = Impl;
+  return Impl;
+}
+
+bool ClassMethodDevirtualizer::devirtualizeApply(FullApplySite AI) {
+  auto *CMI = cast<ClassMethodInst>(AI.getCallee());
+  if (CMI->isVolatile())
+    return false;
+
+  SILModule &M = AI.getModule();
+  SILDeclRef Member = CMI->getMember();
+
+  // Are all overrides of the method visible in this module?
+  if (!calleesAreStaticallyKnowable(M, Member))
+    return false;
+
+  // Use the most derived static type of the instance. If the instance is a
+  // generic parameter which is upcast to its class bound, use the class.
+  SILValue Instance = stripUpCasts(CMI->getOperand());
+  ClassDecl *CD = getClassDecl(Instance->getType(), M);
+  if (!CD) {
+    Instance = CMI->getOperand();
+    CD = getClassDecl(Instance->getType(), M);
+    if (!CD)
+      return false;
+  }
+
+  if (!getUniqueImplementation(CD, Member)) {
+    DEBUG(llvm::dbgs() << "  Multiple implementations for " << CD->getName()
+                       << ": " << *AI.getInstruction());
+    if (OptRemark::isEnabled(M))
+      OptRemark::missed(DEBUG_TYPE, "MultipleImplementations",
+                        AI.getInstruction())
+        .arg("Class", CD->getName().str())
+        .emit();
+    return false;
+  }
+
+  if (!canDevirtualizeClassMethod(AI, Instance->getType()))
+    return false;
+
+  auto Result = devirtualizeClassMethod(AI, Instance);
+  if (!Result.second)
+    return false;
+
+  DEBUG(llvm::dbgs() << "  Devirtualized: " << *AI.getInstruction());
+  if (OptRemark::isEnabled(M))
+    OptRemark::passed(DEBUG_TYPE, "Devirtualized", AI.getInstruction())
+      .arg("Callee", Result.second.getCalleeFunction()->getName())
+      .emit();
+
+  replaceDeadApply(AI, Result.first);
+  return true;
+}
+
+void ClassMethodDevirtualizer::run() {
+  SILModule &M = *getModule();
+
+  // Without whole-module compilation only private methods could be handled,
+  // which the function-level devirtualizer already does.
+  if (!M.isWholeModule())
+    return;
+
+  CHA = PM->getAnalysis<ClassHierarchyAnalysis>();
+  UniqueImplementations.clear();
+
+  unsigned NumRemoved = 0;
+  for (auto &F : M) {
+    // Don't optimize functions that are marked with the opt.never attribute.
+    if (!F.shouldOptimize())
+      continue;
+
+    llvm::SmallVector<FullApplySite, 16> Applies;
+    for (auto &BB : F) {
+      for (auto &I : BB) {
+        auto AI = FullApplySite::isa(&I);
+        if (AI && isa<ClassMethodInst>(AI.getCallee()))
+          Applies.push_back(AI);
+      }
+    }
+
+    bool Changed = false;
+    for (FullApplySite AI : Applies) {
+      if (devirtualizeApply(AI)) {
+        Changed = true;
+        ++NumRemoved;
+      }
+    }
+    if (Changed)
+      invalidateAnalysis(&F,
+                         SILAnalysis::InvalidationKind::CallsAndInstructions);
+  }
+
+  NumDynamicDispatchesRemoved += NumRemoved;
+  DEBUG(llvm::dbgs() << "Removed " << NumRemoved
+                     << " dynamic dispatches of class methods\n");
+}
+
+SILTransform *swift::createClassMethodDevirtualizer() {
+  return new ClassMethodDevirtualizer();
+}
@@ -52,6 +52,18 @@
 /// 3. Handling addresses. We currently do not handle address types. We can in
 ///    the future by introducing alloc_stacks.
 ///
+/// 4. Closures stored in a struct. If the closure is the only function typed
+///    field of a struct which is created in the same basic block as the
+///    closure and passed to the callee, the callee takes the other fields of
+///    the struct instead of the struct itself. The specialized function
+///    rebuilds the struct from them and the copy of the closure. If the struct
+///    has no other uses in the caller, it is removed so that the original
+///    closure can be eliminated.
+///
+/// 5. Generic callees. The callee may be generic as long as the type of the
+///    closure parameter does not depend on its generic parameters. The
+///    specialized function keeps the generic signature of the callee.
+///
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "closure-specialization"
@@ -151,6 +163,11 @@ class CallSiteDescriptor {
   unsigned ClosureIndex;
   SILParameterInfo ClosureParamInfo;
 
+  // If the closure is passed as a field of a struct, the struct and the index
+  // of the closure field.
+  StructInst *ClosureStruct;
+  unsigned FieldIndex;
+
   // This is only needed if we have guaranteed parameters. In most cases it will
   // have only one element, a return inst.
   llvm::TinyPtrVector<SILBasicBlock *> NonFailureExitBBs;
@@ -158,10 +175,12 @@ class CallSiteDescriptor {
 public:
   CallSiteDescriptor(ClosureInfo *CInfo, FullApplySite AI,
                      unsigned ClosureIndex, SILParameterInfo ClosureParamInfo,
-                     llvm::TinyPtrVector<SILBasicBlock *> &&NonFailureExitBBs)
+                     llvm::TinyPtrVector<SILBasicBlock *> &&NonFailureExitBBs,
+                     StructInst *ClosureStruct = nullptr,
+                     unsigned FieldIndex = 0)
     : CInfo(CInfo), AI(AI), ClosureIndex(ClosureIndex),
-      ClosureParamInfo(ClosureParamInfo),
-      NonFailureExitBBs(NonFailureExitBBs) {}
+      ClosureParamInfo(ClosureParamInfo), ClosureStruct(ClosureStruct),
+      FieldIndex(FieldIndex), NonFailureExitBBs(NonFailureExitBBs) {}
 
   CallSiteDescriptor(CallSiteDescriptor&&) =default;
   CallSiteDescriptor &operator=(CallSiteDescriptor &&) =default;
@@ -184,6 +203,13 @@ public:
 
   unsigned getClosureIndex() const { return ClosureIndex; }
 
+  /// Returns the struct in which the closure is passed, or null if the closure
+  /// is passed directly.
+  StructInst *getClosureStruct() const { return ClosureStruct; }
+
+  /// Returns the index of the closure field in the closure struct.
+  unsigned getFieldIndex() const { return FieldIndex; }
+
   SILParameterInfo getClosureParameterInfo() const { return ClosureParamInfo; }
 
   SILInstruction *
@@ -280,6 +306,13 @@ static void rewriteApplyInst(const CallSiteDescriptor &CSDesc,
     Index++;
   }
 
+  // ... passing the other fields of a closure struct directly...
+  if (StructInst *SI = CSDesc.getClosureStruct()) {
+    for (unsigned i = 0, e = SI->getNumOperands(); i != e; ++i)
+      if (i != CSDesc.getFieldIndex())
+        NewArgs.push_back(SI->getOperand(i));
+  }
+
   // ... and appending the captured arguments. We also insert retains here at
   // the location of the original closure. This is needed to balance the
   // implicit release of all captured arguments that occurs when the partial
@@ -346,13 +379,16 @@ static void rewriteApplyInst(const CallSiteDescriptor &CSDesc,
     }
   }
 
+  // A generic callee is called with the substitutions of the original call.
+  ArrayRef<Substitution> Subs = AI.getSubstitutions();
   SILType LoweredType = NewF->getLoweredType();
+  if (!Subs.empty())
+    LoweredType = LoweredType.substGenericArgs(M, Subs);
   SILType ResultType = LoweredType.castTo<SILFunctionType>()->getSILResult();
   Builder.setInsertionPoint(AI.getInstruction());
   FullApplySite NewAI;
   if (auto *TAI = dyn_cast<TryApplyInst>(AI)) {
-    NewAI = Builder.createTryApply(AI.getLoc(), FRI, LoweredType,
-                                   ArrayRef<Substitution>(),
+    NewAI = Builder.createTryApply(AI.getLoc(), FRI, LoweredType, Subs,
                                    NewArgs,
                                    TAI->getNormalBB(), TAI->getErrorBB());
     // If we passed in the original closure as @owned, then insert a release
@@ -367,8 +403,8 @@ static void rewriteApplyInst(const CallSiteDescriptor &CSDesc,
     }
   } else {
     NewAI = Builder.createApply(AI.getLoc(), FRI, LoweredType,
-                                ResultType, ArrayRef<Substitution>(),
-                                NewArgs, cast<ApplyInst>(AI)->isNonThrowing());
+                                ResultType, Subs, NewArgs,
+                                cast<ApplyInst>(AI)->isNonThrowing());
     // If we passed in the original closure as @owned, then insert a release
     // right after NewAI. This is to balance the +1 from being an @owned
     // argument to AI.
@@ -382,6 +418,12 @@ static void rewriteApplyInst(const CallSiteDescriptor &CSDesc,
   // Erase the old apply.
   AI.getInstruction()->eraseFromParent();
 
+  // Remove the closure struct if this was its last use, so that the closure
+  // can be eliminated.
+  if (StructInst *SI = CSDesc.getClosureStruct())
+    if (SI->use_empty())
+      SI->eraseFromParent();
+
   // TODO: Maybe include invalidation code for CallSiteDescriptor after we erase
   // AI from parent?
 }
@@ -478,6 +520,45 @@ static bool isSupportedClosure(const SILInstruction *Closure) {
   return true;
 }
 
+/// Returns the index of \p Closure in the struct \p SI if it is the only
+/// function typed field of the struct.
+static Optional<unsigned> getClosureFieldIndex(StructInst *SI,
+                                               SILInstruction *Closure) {
+  Optional<unsigned> FieldIndex;
+  for (unsigned i = 0, e = SI->getNumOperands(); i != e; ++i) {
+    if (!SI->getOperand(i)->getType().is<SILFunctionType>())
+      continue;
+    if (FieldIndex.hasValue() || SI->getOperand(i) != SILValue(Closure))
+      return None;
+    FieldIndex = i;
+  }
+  return FieldIndex;
+}
+
+/// Returns true if \p V is called by an apply.
+static bool isAppliedCallee(SILValue V) {
+  return std::any_of(V->use_begin(), V->use_end(), [&V](Operand *Op) -> bool {
+    auto UserAI = FullApplySite::isa(Op->getUser());
+    return UserAI && UserAI.getCallee() == V;
+  });
+}
+
+/// Returns true if the closure which is passed as the argument \p Arg of the
+/// callee is invoked in the callee. If the closure is passed in a struct, the
+/// closure field has to be extracted from the argument and invoked.
+static bool isClosureInvoked(SILValue Arg, StructInst *ClosureStruct,
+                             unsigned FieldIndex) {
+  if (!ClosureStruct)
+    return isAppliedCallee(Arg);
+
+  for (auto *Op : Arg->getUses()) {
+    auto *SEI = dyn_cast<StructExtractInst>(Op->getUser());
+    if (SEI && SEI->getFieldNo() == FieldIndex && isAppliedCallee(SEI))
+      return true;
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 //                     Closure Spec Cloner Implementation
 //===----------------------------------------------------------------------===//
@@ -508,13 +589,28 @@ ClosureSpecCloner::initCloned(const CallSiteDescriptor &CallSiteDesc,
       NewParameterInfoList.push_back(param);
     ++Index;
   }
+  SILModule &M = ClosureUser->getModule();
+
+  // If the closure is passed in a struct, add the other fields of the struct
+  // with the convention of the struct parameter.
+  if (StructInst *SI = CallSiteDesc.getClosureStruct()) {
+    auto StructConv = CallSiteDesc.getClosureParameterInfo().getConvention();
+    for (unsigned i = 0, e = SI->getNumOperands(); i != e; ++i) {
+      if (i == CallSiteDesc.getFieldIndex())
+        continue;
+      SILType FieldTy = SI->getOperand(i)->getType();
+      auto Conv = FieldTy.isTrivial(M) ? ParameterConvention::Direct_Unowned
+                                       : StructConv;
+      NewParameterInfoList.push_back(
+          SILParameterInfo(FieldTy.getSwiftRValueType(), Conv));
+    }
+  }
 
   // Then add any arguments that are captured in the closure to the function's
   // argument type. Since they are captured, we need to pass them directly into
   // the new specialized function.
   SILFunction *ClosedOverFun = CallSiteDesc.getClosureCallee();
   CanSILFunctionType ClosedOverFunTy = ClosedOverFun->getLoweredFunctionType();
-  SILModule &M = ClosureUser->getModule();
 
   // Captured parameters are always appended to the function signature. If the
   // type of the captured argument is trivial, pass the argument as
@@ -592,6 +688,21 @@ void ClosureSpecCloner::populateCloned() {
     ValueMap.insert(std::make_pair(Arg, MappedValue));
   }
 
+  // Add the other fields of a closure struct.
+  StructInst *ClosureStruct = CallSiteDesc.getClosureStruct();
+  llvm::SmallVector<SILValue, 4> StructFields;
+  if (ClosureStruct) {
+    for (unsigned i = 0, e = ClosureStruct->getNumOperands(); i != e; ++i) {
+      if (i == CallSiteDesc.getFieldIndex()) {
+        // This is filled in with the new closure below.
+        StructFields.push_back(SILValue());
+        continue;
+      }
+      StructFields.push_back(new (M) SILArgument(
+          ClonedEntryBB, ClosureStruct->getOperand(i)->getType()));
+    }
+  }
+
   // Next we need to add in any arguments that are not captured as arguments to
   // the cloned function.
   //
@@ -618,7 +729,15 @@ void ClosureSpecCloner::populateCloned() {
   SILValue FnVal =
       Builder.createFunctionRef(CallSiteDesc.getLoc(), ClosedOverFun);
   auto *NewClosure = CallSiteDesc.createNewClosure(Builder, FnVal, NewPAIArgs);
-  ValueMap.insert(std::make_pair(ClosureArg, SILValue(NewClosure)));
+  if (ClosureStruct) {
+    // Rebuild the struct with the new closure.
+    StructFields[CallSiteDesc.getFieldIndex()] = NewClosure;
+    auto *NewStruct = Builder.createStruct(CallSiteDesc.getLoc(),
+                                           ClosureArg->getType(), StructFields);
+    ValueMap.insert(std::make_pair(ClosureArg, SILValue(NewStruct)));
+  } else {
+    ValueMap.insert(std::make_pair(ClosureArg, SILValue(NewClosure)));
+  }
 
   BBMap.insert(std::make_pair(ClosureUserEntryBB, ClonedEntryBB));
   // Recursively visit original BBs in depth-first preorder, starting with the
@@ -720,13 +839,37 @@ void ClosureSpecializer::gatherCallSites(
 
       ClosureInfo *CInfo = nullptr;
 
-      // Go through all uses of our closure.
+      // Collect the uses of our closure, either directly or through a struct
+      // which is created in the same basic block.
+      llvm::SmallVector<std::pair<Operand *, StructInst *>, 8> ClosureUses;
       for (auto *Use : II.getUses()) {
-        // If this use is not an apply inst or an apply inst with
-        // substitutions, there is nothing interesting for us to do, so
-        // continue...
+        auto *SI = dyn_cast<StructInst>(Use->getUser());
+        if (!SI) {
+          ClosureUses.push_back({Use, nullptr});
+          continue;
+        }
+        if (SI->getParent() != &BB || !getClosureFieldIndex(SI, &II))
+          continue;
+        for (auto *StructUse : SI->getUses())
+          ClosureUses.push_back({StructUse, SI});
+      }
+
+      // Go through all uses of our closure.
+      for (auto &ClosureUse : ClosureUses) {
+        Operand *Use = ClosureUse.first;
+        StructInst *ClosureStruct = ClosureUse.second;
+        SILValue PassedValue = ClosureStruct ? SILValue(ClosureStruct)
+                                             : SILValue(&II);
+
+        // If this use is not an apply inst, there is nothing interesting for
+        // us to do, so continue...
         auto AI = FullApplySite::isa(Use->getUser());
-        if (!AI || AI.hasSubstitutions())
+        if (!AI)
+          continue;
+
+        // We don't know the lifetime of a struct beyond its basic block, so
+        // it must be passed in the block where it and the closure are created.
+        if (ClosureStruct && AI.getParent() != &BB)
           continue;
 
         // Check if we have already associated this apply inst with a closure to
@@ -748,7 +891,7 @@ void ClosureSpecializer::gatherCallSites(
         // corresponding to our partial apply.
         Optional<unsigned> ClosureIndex;
         for (unsigned i = 0, e = AI.getNumArguments(); i != e; ++i) {
-          if (AI.getArgument(i) != SILValue(&II))
+          if (AI.getArgument(i) != PassedValue)
             continue;
           ClosureIndex = i;
           DEBUG(llvm::dbgs() << "    Found callsite with closure argument at "
@@ -761,20 +904,23 @@ void ClosureSpecializer::gatherCallSites(
         if (!ClosureIndex.hasValue())
           continue;
 
+        // If the callee is generic, the type of the closure parameter must
+        // not depend on its generic parameters: the specialized function
+        // stays generic, but the copy of the closure has concrete types.
+        SILValue Arg = ApplyCallee->getArgument(ClosureIndex.getValue());
+        if (Arg->getType() != PassedValue->getType())
+          continue;
+
         // Make sure that the Closure is invoked in the Apply's callee. We only
         // want to perform closure specialization if we know that we will be
         // able to change a partial_apply into an apply.
         //
         // TODO: Maybe just call the function directly instead of moving the
         // partial apply?
-        SILValue Arg = ApplyCallee->getArgument(ClosureIndex.getValue());
-        if (std::none_of(Arg->use_begin(), Arg->use_end(),
-                         [&Arg](Operand *Op) -> bool {
-                           auto UserAI = FullApplySite::isa(Op->getUser());
-                           return UserAI && UserAI.getCallee() == Arg;
-                         })) {
+        unsigned FieldIndex =
+            ClosureStruct ? *getClosureFieldIndex(ClosureStruct, &II) : 0;
+        if (!isClosureInvoked(Arg, ClosureStruct, FieldIndex))
           continue;
-        }
 
         auto ParamInfo = AI.getSubstCalleeType()->getParameters();
         SILParameterInfo ClosureParamInfo = ParamInfo[ClosureIndex.getValue()];
@@ -802,7 +948,8 @@ void ClosureSpecializer::gatherCallSites(
         // call site list.
         CInfo->CallSites.push_back(
           CallSiteDescriptor(CInfo, AI, ClosureIndex.getValue(),
-                             ClosureParamInfo, std::move(NonFailureExitBBs)));
+                             ClosureParamInfo, std::move(NonFailureExitBBs),
+                             ClosureStruct, FieldIndex));
       }
       if (CInfo)
         ClosureCandidates.push_back(CInfo);
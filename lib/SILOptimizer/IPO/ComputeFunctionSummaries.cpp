@@ -0,0 +1,101 @@
+//===--- ComputeFunctionSummaries.cpp - Summaries of public functions -----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Computes the side effects and the escaping parameters of the public
+// functions of the module and records them as SILFunctionSummaries, which are
+// serialized into the module file. SideEffectAnalysis and EscapeAnalysis use
+// them in client modules, which only see declarations of these functions.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "compute-function-summaries"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Analysis/EscapeAnalysis.h"
+#include "swift/SILOptimizer/Analysis/SideEffectAnalysis.h"
+#include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILModule.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+
+using namespace swift;
+
+STATISTIC(NumFunctionSummaries, "Number of computed function summaries");
+
+static unsigned getSummaryEffects(const SideEffectAnalysis::Effects &E) {
+  unsigned Result = 0;
+  if (E.mayRead())
+    Result |= SILFunctionSummary::Reads;
+  if (E.mayWrite())
+    Result |= SILFunctionSummary::Writes;
+  if (E.mayRetain())
+    Result |= SILFunctionSummary::Retains;
+  if (E.mayRelease())
+    Result |= SILFunctionSummary::Releases;
+  return Result;
+}
+
+namespace {
+
+class ComputeFunctionSummaries : public SILModuleTransform {
+
+  void run() override {
+    SILModule *M = getModule();
+    auto *SEA = PM->getAnalysis<SideEffectAnalysis>();
+    auto *EA = PM->getAnalysis<EscapeAnalysis>();
+
+    for (SILFunction &F : *M) {
+      // Only public functions can be called from other modules.
+      if (!F.isDefinition() || !hasPublicVisibility(F.getLinkage()))
+        continue;
+
+      const SideEffectAnalysis::FunctionEffects &FE = SEA->getEffects(&F);
+      auto ParamEffects = FE.getParameterEffects();
+      if (ParamEffects.size() != F.getArguments().size())
+        continue;
+
+      SILFunctionSummary Summary;
+      Summary.setGlobalEffects(getSummaryEffects(FE.getGlobalEffects()));
+      unsigned Flags = 0;
+      if (FE.mayAllocObjects())
+        Flags |= SILFunctionSummary::AllocsObjects;
+      if (FE.mayTrap())
+        Flags |= SILFunctionSummary::Traps;
+      if (FE.mayReadRC())
+        Flags |= SILFunctionSummary::ReadsRC;
+      Summary.setFlags(Flags);
+
+      for (unsigned Idx = 0, E = ParamEffects.size(); Idx < E; ++Idx) {
+        Summary.addParameter(getSummaryEffects(ParamEffects[Idx]),
+                             EA->getParameterNoEscapeDepth(&F, Idx));
+      }
+
+      // Don't waste space in the module file for summaries which don't tell
+      // anything.
+      if (Summary.isWorstCase())
+        continue;
+
+      DEBUG(llvm::dbgs() << "  summary for " << F.getName() << ": " << FE
+                         << '\n');
+      M->setFunctionSummary(F.getName(), Summary);
+      ++NumFunctionSummaries;
+    }
+  }
+
+  StringRef getName() override { return "Compute Function Summaries"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createComputeFunctionSummaries() {
+  return new ComputeFunctionSummaries();
+}
@@ -0,0 +1,388 @@
+//===--- ConventionInference.cpp - Infer ownership conventions ------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Changes the ownership conventions of functions which are only called
+// directly from within the module and are not shared, e.g. specializations.
+// Unlike FunctionSignatureOpts, the function is rewritten in place and no
+// thunk is created, so this works for all callers at once.
+//
+// *) An @owned parameter, which is released at the end of the function, is
+//    changed to @guaranteed. The release is removed from the callee and a
+//    release is inserted after each call. If the argument of a call is
+//    retained right before the call and the caller already guarantees the
+//    lifetime of the argument, the retain is removed instead.
+//
+// *) An @owned result, which is retained right before the return, is changed
+//    to @unowned. The retain is moved from the callee to the callers.
+//
+// Functions are processed top-down, so that the arguments of a caller are
+// already converted when its call sites are rewritten.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "convention-inference"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SIL/SILArgument.h"
+#include "swift/SIL/SILBuilder.h"
+#include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILModule.h"
+#include "swift/SILOptimizer/Analysis/ARCAnalysis.h"
+#include "swift/SILOptimizer/Analysis/BasicCalleeAnalysis.h"
+#include "swift/SILOptimizer/Analysis/FunctionOrder.h"
+#include "swift/SILOptimizer/Analysis/RCIdentityAnalysis.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Utils/Local.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+
+using namespace swift;
+
+STATISTIC(NumOwnedToGuaranteed, "Number of owned parameters made guaranteed");
+STATISTIC(NumOwnedToUnowned, "Number of owned results made unowned");
+STATISTIC(NumCallSitesUpdated, "Number of call sites updated");
+STATISTIC(NumRetainReleasePairsRemoved,
+          "Number of retain/release pairs removed at call sites");
+
+namespace {
+
+using ApplyList = llvm::SmallVector<FullApplySite, 4>;
+
+/// The changes to the conventions of a single function.
+struct ConventionChange {
+  /// The indices of the parameters which are changed to guaranteed.
+  llvm::SmallVector<unsigned, 4> GuaranteedParams;
+
+  /// True if the result is changed to unowned.
+  bool UnownedResult = false;
+
+  bool empty() const { return GuaranteedParams.empty() && !UnownedResult; }
+};
+
+class ConventionInference : public SILModuleTransform {
+  RCIdentityAnalysis *RCIA = nullptr;
+
+  /// Maps functions to the call sites which call them directly.
+  llvm::DenseMap<SILFunction *, ApplyList> CallSites;
+
+  /// The number of function_refs of each function, which are only used as
+  /// callee of full apply sites.
+  llvm::DenseMap<SILFunction *, unsigned> NumDirectRefs;
+
+  /// Functions which are referenced in a way other than a direct call.
+  llvm::SmallPtrSet<SILFunction *, 16> EscapingFunctions;
+
+  void collectCallSites();
+  bool canChangeConventions(SILFunction *F);
+  ConventionChange changeCalleeConventions(SILFunction *F);
+  void updateCallSite(FullApplySite AI, SILFunction *F,
+                      const ConventionChange &Change);
+
+  void run() override;
+
+  StringRef getName() override { return "Convention Inference"; }
+};
+
+} // end anonymous namespace
+
+void ConventionInference::collectCallSites() {
+  for (auto &Caller : *getModule()) {
+    for (auto &BB : Caller) {
+      for (auto &I : BB) {
+        auto *FRI = dyn_cast<FunctionRefInst>(&I);
+        if (!FRI)
+          continue;
+        SILFunction *F = FRI->getReferencedFunction();
+
+        // A function_ref which is used for anything else than the callee of
+        // a full apply site lets the function escape.
+        bool IsDirect = true;
+        for (Operand *Use : FRI->getUses()) {
+          if (!FullApplySite::isa(Use->getUser()) ||
+              Use->getOperandNumber() != 0) {
+            IsDirect = false;
+            break;
+          }
+        }
+        if (!IsDirect) {
+          EscapingFunctions.insert(F);
+          continue;
+        }
+        ++NumDirectRefs[F];
+        for (Operand *Use : FRI->getUses())
+          CallSites[F].push_back(FullApplySite(Use->getUser()));
+      }
+    }
+  }
+}
+
+/// Returns true if the conventions of \p F can be changed without changing
+/// any code outside the module.
+bool ConventionInference::canChangeConventions(SILFunction *F) {
+  if (F->isExternalDeclaration() || !F->shouldOptimize())
+    return false;
+
+  if (F->isPossiblyUsedExternally() || F->isKeepAsPublic())
+    return false;
+
+  // Other object files may contain a definition of a shared function with the
+  // same name, e.g. a specialization, which keeps the original conventions.
+  // The linker picks one of the definitions for all callers.
+  if (hasSharedVisibility(F->getLinkage()) ||
+      isAvailableExternally(F->getLinkage()))
+    return false;
+
+  // All references to the function must be function_refs which are only
+  // used for direct calls. Any other reference, e.g. from a vtable or
+  // witness table, is counted in the function's reference count.
+  if (EscapingFunctions.count(F) || F->getRefCount() != NumDirectRefs[F])
+    return false;
+
+  // For now ignore generic functions to keep things simple.
+  CanSILFunctionType FTy = F->getLoweredFunctionType();
+  if (FTy->isPolymorphic())
+    return false;
+
+  switch (FTy->getRepresentation()) {
+  case SILFunctionTypeRepresentation::Thin:
+  case SILFunctionTypeRepresentation::Method:
+    return true;
+  case SILFunctionTypeRepresentation::Thick:
+  case SILFunctionTypeRepresentation::WitnessMethod:
+  case SILFunctionTypeRepresentation::CFunctionPointer:
+  case SILFunctionTypeRepresentation::ObjCMethod:
+  case SILFunctionTypeRepresentation::Block:
+    return false;
+  }
+}
+
+/// Returns the retain of the returned value in the return block of \p F, if
+/// it is the last instruction which may change the reference count of the
+/// returned value before returning.
+static SILInstruction *findEpilogueRetain(SILFunction *F,
+                                          RCIdentityFunctionInfo *RCFI) {
+  auto RetBB = F->findReturnBB();
+  if (RetBB == F->end())
+    return nullptr;
+  auto *Ret = cast<ReturnInst>(RetBB->getTerminator());
+  SILValue RetRoot = RCFI->getRCIdentityRoot(Ret->getOperand());
+
+  for (auto Iter = Ret->getIterator(); Iter != RetBB->begin();) {
+    SILInstruction *I = &*--Iter;
+    if (isa<StrongRetainInst>(I) || isa<RetainValueInst>(I)) {
+      if (RCFI->getRCIdentityRoot(I->getOperand(0)) == RetRoot)
+        return I;
+      continue;
+    }
+    // Anything which may release an object could free the returned value,
+    // once the callee doesn't retain it anymore.
+    if (I->mayRelease())
+      return nullptr;
+  }
+  return nullptr;
+}
+
+ConventionChange ConventionInference::changeCalleeConventions(SILFunction *F) {
+  ConventionChange Change;
+  RCIdentityFunctionInfo *RCFI = RCIA->get(F);
+  CanSILFunctionType FTy = F->getLoweredFunctionType();
+
+  // Find the owned parameters, which are released at the end of the
+  // function. If the function throws, they must also be released in the
+  // throw block.
+  ConsumedArgToEpilogueReleaseMatcher ReturnReleases(RCFI, F);
+  ConsumedArgToEpilogueReleaseMatcher ThrowReleases(
+      RCFI, F, ConsumedArgToEpilogueReleaseMatcher::ExitKind::Throw);
+
+  llvm::SmallVector<SILParameterInfo, 8> Params;
+  llvm::SmallVector<SILInstruction *, 8> ReleasesToRemove;
+  ArrayRef<SILArgument *> Args = F->begin()->getBBArgs();
+  for (unsigned i = 0, e = Args.size(); i != e; ++i) {
+    SILParameterInfo Param = FTy->getParameters()[i];
+    if (Param.getConvention() == ParameterConvention::Direct_Owned) {
+      SILInstruction *Release = ReturnReleases.releaseForArgument(Args[i]);
+      SILInstruction *ThrowRelease = nullptr;
+      if (Release && (!ThrowReleases.hasBlock() ||
+          (ThrowRelease = ThrowReleases.releaseForArgument(Args[i])))) {
+        Param = SILParameterInfo(Param.getType(),
+                                 ParameterConvention::Direct_Guaranteed);
+        Change.GuaranteedParams.push_back(i);
+        ReleasesToRemove.push_back(Release);
+        if (ThrowRelease)
+          ReleasesToRemove.push_back(ThrowRelease);
+        ++NumOwnedToGuaranteed;
+      }
+    }
+    Params.push_back(Param);
+  }
+  for (SILInstruction *Release : ReleasesToRemove)
+    Release->eraseFromParent();
+
+  // Look for an owned result, which is retained right before the return.
+  // This must be done after removing the releases of the parameters, because
+  // they usually come after the retain of the result.
+  SILResultInfo Result = FTy->getResult();
+  if (Result.getConvention() == ResultConvention::Owned &&
+      !FTy->hasIndirectResult()) {
+    if (SILInstruction *Retain = findEpilogueRetain(F, RCFI)) {
+      Retain->eraseFromParent();
+      Result = SILResultInfo(Result.getType(), ResultConvention::Unowned);
+      Change.UnownedResult = true;
+      ++NumOwnedToUnowned;
+    }
+  }
+
+  if (Change.empty())
+    return Change;
+
+  F->rewriteLoweredTypeUnsafe(SILFunctionType::get(
+      FTy->getGenericSignature(), FTy->getExtInfo(),
+      FTy->getCalleeConvention(), Params, Result,
+      FTy->getOptionalErrorResult(), F->getModule().getASTContext()));
+  return Change;
+}
+
+/// Returns the retain of \p Arg right before the call \p AI, if \p Arg is
+/// guaranteed to be alive in the caller anyway. Such a retain and the release
+/// after the call can be removed.
+static SILInstruction *findRedundantRetain(FullApplySite AI, SILValue Arg,
+                                           RCIdentityFunctionInfo *RCFI) {
+  auto *Root = dyn_cast<SILArgument>(RCFI->getRCIdentityRoot(Arg));
+  if (!Root || !Root->isFunctionArg() ||
+      !Root->hasConvention(ParameterConvention::Direct_Guaranteed))
+    return nullptr;
+
+  SILInstruction *Call = AI.getInstruction();
+  for (auto Iter = Call->getIterator(); Iter != Call->getParent()->begin();) {
+    SILInstruction *I = &*--Iter;
+    if ((isa<StrongRetainInst>(I) || isa<RetainValueInst>(I)) &&
+        I->getOperand(0) == Arg)
+      return I;
+    if (I->mayRelease())
+      return nullptr;
+  }
+  return nullptr;
+}
+
+void ConventionInference::updateCallSite(FullApplySite AI, SILFunction *F,
+                                         const ConventionChange &Change) {
+  SILInstruction *Call = AI.getInstruction();
+  SILFunction *Caller = Call->getFunction();
+  RCIdentityFunctionInfo *RCFI = RCIA->get(Caller);
+  SILLocation Loc = Call->getLoc();
+
+  // Find the arguments which must be released after the call.
+  llvm::SmallVector<SILValue, 4> ArgsToRelease;
+  for (unsigned Idx : Change.GuaranteedParams) {
+    SILValue Arg = AI.getArgument(Idx);
+    if (SILInstruction *Retain = findRedundantRetain(AI, Arg, RCFI)) {
+      Retain->eraseFromParent();
+      ++NumRetainReleasePairsRemoved;
+      continue;
+    }
+    ArgsToRelease.push_back(Arg);
+  }
+
+  // Create a new call with the new function type.
+  SILBuilderWithScope Builder(Call);
+  SILType FnTy = F->getLoweredType();
+  SILType ResultTy = FnTy.getFunctionInterfaceResultType();
+  auto *FRI = Builder.createFunctionRef(Loc, F);
+  llvm::SmallVector<SILValue, 8> Args(AI.getArguments().begin(),
+                                     AI.getArguments().end());
+
+  SILValue Result;
+  if (auto *Apply = dyn_cast<ApplyInst>(Call)) {
+    auto *NewAI = Builder.createApply(Loc, FRI, FnTy, ResultTy,
+                                      ArrayRef<Substitution>(), Args,
+                                      Apply->isNonThrowing());
+    Call->replaceAllUsesWith(NewAI);
+    Builder.setInsertionPoint(&*std::next(NewAI->getIterator()));
+    Result = NewAI;
+  } else {
+    auto *TAI = cast<TryApplyInst>(Call);
+    Builder.createTryApply(Loc, FRI, FnTy, ArrayRef<Substitution>(), Args,
+                           TAI->getNormalBB(), TAI->getErrorBB());
+
+    SILBasicBlock *ErrorBB = TAI->getErrorBB();
+    Builder.setInsertionPoint(ErrorBB, ErrorBB->begin());
+    for (SILValue Arg : ArgsToRelease)
+      Builder.createReleaseValue(Loc, Arg);
+
+    SILBasicBlock *NormalBB = TAI->getNormalBB();
+    Builder.setInsertionPoint(NormalBB, NormalBB->begin());
+    Result = NormalBB->getBBArg(0);
+  }
+
+  // The caller now gets the result at +0 and has to retain it.
+  if (Change.UnownedResult)
+    Builder.createRetainValue(Loc, Result);
+
+  for (SILValue Arg : ArgsToRelease)
+    Builder.createReleaseValue(Loc, Arg);
+
+  recursivelyDeleteTriviallyDeadInstructions(Call, true);
+  ++NumCallSitesUpdated;
+}
+
+void ConventionInference::run() {
+  SILModule *M = getModule();
+  RCIA = getAnalysis<RCIdentityAnalysis>();
+  auto *BCA = getAnalysis<BasicCalleeAnalysis>();
+
+  CallSites.clear();
+  NumDirectRefs.clear();
+  EscapingFunctions.clear();
+  collectCallSites();
+
+  DEBUG(llvm::dbgs() << "** Convention Inference **\n");
+
+  // Visit callers before callees, so that the call sites in a caller can make
+  // use of the already changed parameter conventions of the caller.
+  BottomUpFunctionOrder BottomUpOrder(*M, BCA);
+  ArrayRef<SILFunction *> Functions = BottomUpOrder.getFunctions();
+
+  bool Changed = false;
+  for (auto Iter = Functions.rbegin(); Iter != Functions.rend(); ++Iter) {
+    SILFunction *F = *Iter;
+    if (!canChangeConventions(F))
+      continue;
+
+    ConventionChange Change = changeCalleeConventions(F);
+    if (Change.empty())
+      continue;
+
+    DEBUG(llvm::dbgs() << "  Changed conventions of " << F->getName()
+                       << ": " << Change.GuaranteedParams.size()
+                       << " guaranteed parameters"
+                       << (Change.UnownedResult ? ", unowned result" : "")
+                       << '\n');
+
+    invalidateAnalysis(F, SILAnalysis::InvalidationKind::Instructions);
+    for (FullApplySite AI : CallSites[F]) {
+      SILFunction *Caller = AI.getFunction();
+      updateCallSite(AI, F, Change);
+      invalidateAnalysis(Caller,
+                         SILAnalysis::InvalidationKind::CallsAndInstructions);
+    }
+    Changed = true;
+  }
+
+  if (Changed)
+    invalidateAnalysis(SILAnalysis::InvalidationKind::Everything);
+}
+
+SILTransform *swift::createConventionInference() {
+  return new ConventionInference();
+}
@@ -0,0 +1,413 @@
+//===--- ExistentialSpecializer.cpp - Specialize existential arguments ----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Specializes functions with protocol-typed (existential) parameters for the
+// concrete types which their callers wrap into the existentials.
+//
+// The specialized function takes the concrete value and wraps it into the
+// existential itself in its entry block. This makes the init_existential
+// visible to the open_existential instructions in the body, so that SILCombine
+// can propagate the concrete type into witness_method instructions and
+// devirtualize the protocol method calls.
+//
+// Both class existentials, which are passed by value, and opaque existentials,
+// which are passed @in, are handled. For an opaque existential the caller must
+// build the existential in an alloc_stack which is used for nothing but this
+// call.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "existential-specializer"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/Basic/Range.h"
+#include "swift/SIL/Mangle.h"
+#include "swift/SIL/SILCloner.h"
+#include "swift/SIL/SILInstruction.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Utils/Local.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+
+using namespace swift;
+
+STATISTIC(NumExistentialArgsSpecialized,
+          "Number of existential arguments specialized");
+STATISTIC(NumExistentialSpecializations,
+          "Number of functions specialized for concrete existential arguments");
+
+namespace {
+
+/// An argument of a call which can be passed as its concrete type.
+struct ExistentialArg {
+  unsigned Idx;
+
+  /// The init_existential_ref or init_existential_addr which creates the
+  /// existential in the caller.
+  SILInstruction *InitExistential;
+
+  /// For opaque existentials, the alloc_stack which holds the existential.
+  AllocStackInst *ASI;
+};
+
+/// Clones a function, replacing existential parameters by parameters of the
+/// concrete type.
+class ExistentialSpecializerCloner
+  : public SILClonerWithScopes<ExistentialSpecializerCloner> {
+  using SuperTy = SILClonerWithScopes<ExistentialSpecializerCloner>;
+  friend class SILVisitor<ExistentialSpecializerCloner>;
+  friend class SILCloner<ExistentialSpecializerCloner>;
+
+  SILFunction *OrigF;
+  ArrayRef<ExistentialArg> Args;
+
+public:
+  ExistentialSpecializerCloner(SILFunction *OrigF, SILFunction *NewF,
+                               ArrayRef<ExistentialArg> Args)
+    : SuperTy(*NewF), OrigF(OrigF), Args(Args) {}
+
+  void cloneBlocks();
+};
+
+} // end anonymous namespace
+
+void ExistentialSpecializerCloner::cloneBlocks() {
+  SILFunction &CloneF = getBuilder().getFunction();
+  SILModule &M = CloneF.getModule();
+
+  SILBasicBlock *OrigEntryBB = &*OrigF->begin();
+  SILBasicBlock *ClonedEntryBB = new (M) SILBasicBlock(&CloneF);
+  BBMap.insert(std::make_pair(OrigEntryBB, ClonedEntryBB));
+  getBuilder().setInsertionPoint(ClonedEntryBB);
+
+  // The existentials which are re-created on the stack of the clone.
+  llvm::SmallVector<AllocStackInst *, 4> StackExistentials;
+
+  CanSILFunctionType CloneFTy = CloneF.getLoweredFunctionType();
+  const ExistentialArg *NextArg = Args.begin();
+  for (unsigned Idx = 0, e = OrigEntryBB->bbarg_size(); Idx != e; ++Idx) {
+    SILArgument *Arg = OrigEntryBB->getBBArg(Idx);
+    SILType ArgTy = CloneFTy->getParameters()[Idx].getSILType();
+    SILValue NewArg = new (M) SILArgument(ClonedEntryBB, ArgTy,
+                                          Arg->getDecl());
+    if (NextArg == Args.end() || NextArg->Idx != Idx) {
+      ValueMap.insert(std::make_pair(Arg, NewArg));
+      continue;
+    }
+
+    // Wrap the concrete argument into an existential again.
+    SILLocation Loc = RegularLocation::getAutoGeneratedLocation();
+    SILValue Existential;
+    SILInstruction *IE = NextArg->InitExistential;
+    if (auto *IER = dyn_cast<InitExistentialRefInst>(IE)) {
+      Existential = getBuilder().createInitExistentialRef(
+          Loc, Arg->getType(), IER->getFormalConcreteType(), NewArg,
+          IER->getConformances());
+    } else {
+      auto *IEA = cast<InitExistentialAddrInst>(IE);
+      auto *ASI =
+          getBuilder().createAllocStack(Loc, Arg->getType().getObjectType());
+      auto *Payload = getBuilder().createInitExistentialAddr(
+          Loc, ASI, IEA->getFormalConcreteType(), IEA->getLoweredConcreteType(),
+          IEA->getConformances());
+      getBuilder().createCopyAddr(Loc, NewArg, Payload, IsTake,
+                                  IsInitialization);
+      StackExistentials.push_back(ASI);
+      Existential = ASI;
+    }
+    ValueMap.insert(std::make_pair(Arg, Existential));
+    ++NextArg;
+  }
+
+  // Recursively visit original BBs in depth-first preorder, starting with the
+  // entry block, cloning all instructions other than terminators.
+  visitSILBasicBlock(OrigEntryBB);
+
+  // Now iterate over the BBs and fix up the terminators.
+  for (auto BI = BBMap.begin(), BE = BBMap.end(); BI != BE; ++BI) {
+    getBuilder().setInsertionPoint(BI->second);
+    visit(BI->first->getTerminator());
+  }
+
+  if (StackExistentials.empty())
+    return;
+
+  // The original function consumed the @in existentials, so only their stack
+  // memory is left to deallocate.
+  for (auto &BB : CloneF) {
+    TermInst *TI = BB.getTerminator();
+    if (!isa<ReturnInst>(TI) && !isa<ThrowInst>(TI))
+      continue;
+    SILBuilderWithScope Builder(TI);
+    for (AllocStackInst *ASI : reversed(StackExistentials))
+      Builder.createDeallocStack(TI->getLoc(), ASI);
+  }
+}
+
+/// Returns the init_existential_ref for a class existential argument, or null.
+static InitExistentialRefInst *getInitExistentialRef(SILValue Arg) {
+  auto *IER = dyn_cast<InitExistentialRefInst>(Arg);
+  if (!IER || IER->getFormalConcreteType()->hasArchetype())
+    return nullptr;
+  return IER;
+}
+
+/// Returns the init_existential_addr for an opaque existential which is passed
+/// as the argument \p Arg of \p AI, or null.
+///
+/// The existential must be initialized in an alloc_stack which is only used
+/// to pass it to \p AI.
+static InitExistentialAddrInst *getInitExistentialAddr(FullApplySite AI,
+                                                       SILValue Arg) {
+  auto *ASI = dyn_cast<AllocStackInst>(Arg);
+  if (!ASI)
+    return nullptr;
+
+  InitExistentialAddrInst *IEA = nullptr;
+  unsigned NumApplyUses = 0;
+  for (Operand *Use : ASI->getUses()) {
+    SILInstruction *User = Use->getUser();
+    if (isa<DeallocStackInst>(User))
+      continue;
+    if (User == AI.getInstruction()) {
+      ++NumApplyUses;
+      continue;
+    }
+    if (auto *I = dyn_cast<InitExistentialAddrInst>(User)) {
+      if (IEA)
+        return nullptr;
+      IEA = I;
+      continue;
+    }
+    return nullptr;
+  }
+  if (!IEA || NumApplyUses != 1 ||
+      IEA->getFormalConcreteType()->hasArchetype())
+    return nullptr;
+  return IEA;
+}
+
+/// Returns true if the existential parameter \p Arg is opened in the body of
+/// its function, which means that the specialization can devirtualize
+/// protocol method calls.
+static bool isOpened(SILArgument *Arg) {
+  for (Operand *Use : Arg->getUses()) {
+    if (isa<OpenExistentialAddrInst>(Use->getUser()) ||
+        isa<OpenExistentialRefInst>(Use->getUser()))
+      return true;
+  }
+  return false;
+}
+
+/// Collect the arguments of \p AI which can be passed as their concrete type.
+static void findExistentialArgs(FullApplySite AI, SILFunction *Callee,
+                                SmallVectorImpl<ExistentialArg> &Args) {
+  SILBasicBlock *EntryBB = &*Callee->begin();
+  auto Params = Callee->getLoweredFunctionType()->getParameters();
+  for (unsigned Idx = 0, e = AI.getNumArguments(); Idx != e; ++Idx) {
+    SILArgument *CalleeArg = EntryBB->getBBArg(Idx);
+    if (!CalleeArg->getType().isExistentialType() || !isOpened(CalleeArg))
+      continue;
+
+    SILValue Arg = AI.getArgument(Idx);
+    switch (Params[Idx].getConvention()) {
+    case ParameterConvention::Direct_Owned:
+    case ParameterConvention::Direct_Guaranteed:
+    case ParameterConvention::Direct_Unowned:
+      if (auto *IER = getInitExistentialRef(Arg))
+        Args.push_back({Idx, IER, nullptr});
+      break;
+    case ParameterConvention::Indirect_In:
+      if (auto *IEA = getInitExistentialAddr(AI, Arg))
+        Args.push_back({Idx, IEA, cast<AllocStackInst>(Arg)});
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static std::string getClonedName(SILFunction *F,
+                                 ArrayRef<ExistentialArg> Args) {
+  Mangle::Mangler M;
+  auto P = SpecializationPass::ExistentialSpecializer;
+  FunctionSignatureSpecializationMangler Mangler(P, M, F);
+  for (const ExistentialArg &Arg : Args)
+    Mangler.setArgumentExistentialToConcrete(Arg.Idx, Arg.InitExistential);
+  Mangler.mangle();
+  return M.finalize();
+}
+
+/// Create the specialization of \p OrigF for the concrete types of \p Args,
+/// or return the existing one.
+static SILFunction *specializeFunction(SILFunction *OrigF,
+                                       ArrayRef<ExistentialArg> Args) {
+  SILModule &M = OrigF->getModule();
+  std::string Name = getClonedName(OrigF, Args);
+  if (auto *NewF = M.lookUpFunction(Name))
+    return NewF;
+
+  CanSILFunctionType OrigFTy = OrigF->getLoweredFunctionType();
+  auto OrigParams = OrigFTy->getParameters();
+  llvm::SmallVector<SILParameterInfo, 4> Params(OrigParams.begin(),
+                                                OrigParams.end());
+  for (const ExistentialArg &Arg : Args) {
+    CanType ConcreteTy;
+    if (auto *IEA = dyn_cast<InitExistentialAddrInst>(Arg.InitExistential))
+      ConcreteTy = IEA->getLoweredConcreteType().getSwiftRValueType();
+    else
+      ConcreteTy = cast<InitExistentialRefInst>(Arg.InitExistential)
+                       ->getOperand()->getType().getSwiftRValueType();
+    Params[Arg.Idx] = SILParameterInfo(ConcreteTy,
+                                       Params[Arg.Idx].getConvention());
+  }
+  auto NewFTy = SILFunctionType::get(
+      OrigFTy->getGenericSignature(), OrigFTy->getExtInfo(),
+      OrigFTy->getCalleeConvention(), Params, OrigFTy->getResult(),
+      OrigFTy->getOptionalErrorResult(), M.getASTContext());
+
+  SILFunction *NewF = M.getOrCreateFunction(
+      getSpecializedLinkage(OrigF, OrigF->getLinkage()), Name, NewFTy,
+      /*contextGenericParams*/ nullptr, OrigF->getLocation(), OrigF->isBare(),
+      OrigF->isTransparent(), OrigF->isFragile(), OrigF->isThunk(),
+      OrigF->getClassVisibility(), OrigF->getInlineStrategy(),
+      OrigF->getEffectsKind(),
+      /*InsertBefore*/ OrigF, OrigF->getDebugScope(), OrigF->getDeclContext());
+  NewF->setDeclCtx(OrigF->getDeclContext());
+  for (auto &Attr : OrigF->getSemanticsAttrs())
+    NewF->addSemanticsAttr(Attr);
+
+  DEBUG(llvm::dbgs() << "  Specialize callee as ";
+        NewF->printName(llvm::dbgs()); llvm::dbgs() << " " << NewFTy << "\n");
+
+  ExistentialSpecializerCloner Cloner(OrigF, NewF, Args);
+  Cloner.cloneBlocks();
+  ++NumExistentialSpecializations;
+  return NewF;
+}
+
+/// Replace \p AI by a call of \p NewF, which takes the concrete values of
+/// \p Args instead of the existentials.
+static void rewriteApply(FullApplySite AI, SILFunction *NewF,
+                         ArrayRef<ExistentialArg> Args) {
+  llvm::SmallVector<SILValue, 8> NewArgs(AI.getArguments().begin(),
+                                         AI.getArguments().end());
+  llvm::SmallVector<SILInstruction *, 4> DeadInsts;
+  for (const ExistentialArg &Arg : Args) {
+    if (auto *IER = dyn_cast<InitExistentialRefInst>(Arg.InitExistential)) {
+      NewArgs[Arg.Idx] = IER->getOperand();
+      DeadInsts.push_back(IER);
+      continue;
+    }
+
+    // Build the concrete value in a new alloc_stack instead of the
+    // existential.
+    auto *IEA = cast<InitExistentialAddrInst>(Arg.InitExistential);
+    SILBuilderWithScope Builder(Arg.ASI);
+    auto *NewASI = Builder.createAllocStack(
+        Arg.ASI->getLoc(), IEA->getLoweredConcreteType().getObjectType());
+    IEA->replaceAllUsesWith(NewASI);
+    IEA->eraseFromParent();
+    for (auto UI = Arg.ASI->use_begin(); UI != Arg.ASI->use_end();) {
+      auto *DSI = dyn_cast<DeallocStackInst>((*UI)->getUser());
+      ++UI;
+      if (!DSI)
+        continue;
+      SILBuilderWithScope(DSI).createDeallocStack(DSI->getLoc(), NewASI);
+      DSI->eraseFromParent();
+    }
+    NewArgs[Arg.Idx] = NewASI;
+  }
+
+  SILBuilderWithScope Builder(AI.getInstruction());
+  auto *FRI = Builder.createFunctionRef(AI.getLoc(), NewF);
+  if (auto *TAI = dyn_cast<TryApplyInst>(AI.getInstruction())) {
+    Builder.createTryApply(AI.getLoc(), FRI, NewF->getLoweredType(), {},
+                           NewArgs, TAI->getNormalBB(), TAI->getErrorBB());
+  } else {
+    auto *OrigAI = cast<ApplyInst>(AI.getInstruction());
+    auto *NewAI = Builder.createApply(AI.getLoc(), FRI, NewArgs,
+                                      OrigAI->isNonThrowing());
+    OrigAI->replaceAllUsesWith(NewAI);
+  }
+  DeadInsts.push_back(cast<FunctionRefInst>(AI.getCallee()));
+  AI.getInstruction()->eraseFromParent();
+
+  // The opaque existential stack locations are dead now.
+  for (const ExistentialArg &Arg : Args) {
+    if (Arg.ASI)
+      Arg.ASI->eraseFromParent();
+  }
+  // So are the class existentials, unless they are used otherwise.
+  recursivelyDeleteTriviallyDeadInstructions(DeadInsts);
+}
+
+/// Try to specialize the callee of \p AI for the concrete types of its
+/// existential arguments.
+static bool specializeApply(FullApplySite AI) {
+  auto *FRI = dyn_cast<FunctionRefInst>(AI.getCallee());
+  if (!FRI || AI.hasSubstitutions())
+    return false;
+
+  SILFunction *Callee = FRI->getReferencedFunction();
+  if (Callee->isExternalDeclaration() || !Callee->shouldOptimize() ||
+      Callee->getLoweredFunctionType()->isPolymorphic() ||
+      Callee == AI.getFunction())
+    return false;
+
+  llvm::SmallVector<ExistentialArg, 4> Args;
+  findExistentialArgs(AI, Callee, Args);
+  if (Args.empty())
+    return false;
+
+  DEBUG(llvm::dbgs() << "Specializing existential arguments of "
+                     << Callee->getName() << " in:\n" << *AI.getInstruction());
+
+  SILFunction *NewF = specializeFunction(Callee, Args);
+  rewriteApply(AI, NewF, Args);
+  NumExistentialArgsSpecialized += Args.size();
+  return true;
+}
+
+namespace {
+
+class ExistentialSpecializer : public SILModuleTransform {
+  void run() override {
+    bool Changed = false;
+    for (auto &F : *getModule()) {
+      // Don't optimize functions that are marked with the opt.never attribute.
+      if (!F.shouldOptimize())
+        continue;
+
+      llvm::SmallVector<FullApplySite, 16> Applies;
+      for (auto &BB : F) {
+        for (auto &I : BB) {
+          if (auto AI = FullApplySite::isa(&I))
+            Applies.push_back(AI);
+        }
+      }
+      for (FullApplySite AI : Applies)
+        Changed |= specializeApply(AI);
+    }
+
+    if (Changed)
+      invalidateAnalysis(SILAnalysis::InvalidationKind::Everything);
+  }
+
+  StringRef getName() override { return "Existential Specializer"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createExistentialSpecializer() {
+  return new ExistentialSpecializer();
+}
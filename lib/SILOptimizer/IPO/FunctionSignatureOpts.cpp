@@ -666,10 +666,11 @@ SILFunction *SignatureOptimizer::createEmptyFunctionWithOptimizedSig(
 
   NewF->setDeclCtx(F->getDeclContext());
 
-  // Array semantic clients rely on the signature being as in the original
-  // version.
+  // Array and copy-on-write semantic clients rely on the signature being as in
+  // the original version.
   for (auto &Attr : F->getSemanticsAttrs())
-    if (!StringRef(Attr).startswith("array."))
+    if (!StringRef(Attr).startswith("array.") &&
+        !StringRef(Attr).startswith("cow."))
       NewF->addSemanticsAttr(Attr);
 
   return NewF;
@@ -550,6 +550,116 @@ static SILFunction *findInitializer(SILModule *Module, SILFunction *AddrF,
   return getCalleeOfOnceCall(CallToOnce);
 }
 
+/// Returns the value which is stored to \p Addr, either by a single store or
+/// element by element through struct_element_addr and tuple_element_addr
+/// projections of \p Addr. In the latter case the aggregate is rebuilt with
+/// \p B. The replaced stores and projections are added to \p Dead, users
+/// before their operands.
+///
+/// Returns a null value if \p Addr has other uses or if not every element is
+/// stored exactly once.
+static SILValue getStoredValue(SILValue Addr, SILBuilder &B,
+                               SmallVectorImpl<SILInstruction *> &Dead,
+                               SmallVectorImpl<SILInstruction *> &Created) {
+  StoreInst *Store = nullptr;
+  SmallVector<SILInstruction *, 8> Projections;
+  for (auto *Use : Addr->getUses()) {
+    SILInstruction *User = Use->getUser();
+    if (auto *SI = dyn_cast<StoreInst>(User)) {
+      if (Store || SI->getDest() != Addr)
+        return SILValue();
+      Store = SI;
+    } else if (isa<StructElementAddrInst>(User) ||
+               isa<TupleElementAddrInst>(User)) {
+      Projections.push_back(User);
+    } else {
+      return SILValue();
+    }
+  }
+  if (Store) {
+    if (!Projections.empty())
+      return SILValue();
+    Dead.push_back(Store);
+    return Store->getSrc();
+  }
+
+  SILType Ty = Addr->getType().getObjectType();
+  unsigned NumElements = 0;
+  if (auto *SD = Ty.getStructOrBoundGenericStruct()) {
+    for (auto *Field : SD->getStoredProperties()) {
+      (void)Field;
+      ++NumElements;
+    }
+  } else if (auto TT = Ty.getAs<TupleType>()) {
+    NumElements = TT->getNumElements();
+  }
+  if (NumElements == 0 || Projections.size() != NumElements)
+    return SILValue();
+
+  SmallVector<SILValue, 8> Elements(NumElements);
+  for (SILInstruction *Proj : Projections) {
+    unsigned FieldNo;
+    if (auto *SEAI = dyn_cast<StructElementAddrInst>(Proj))
+      FieldNo = SEAI->getFieldNo();
+    else
+      FieldNo = cast<TupleElementAddrInst>(Proj)->getFieldNo();
+    if (Elements[FieldNo])
+      return SILValue();
+
+    SILValue Element = getStoredValue(Proj, B, Dead, Created);
+    if (!Element)
+      return SILValue();
+    Elements[FieldNo] = Element;
+    Dead.push_back(Proj);
+  }
+
+  SILInstruction *Aggregate;
+  auto Loc = RegularLocation::getAutoGeneratedLocation();
+  if (Ty.getStructOrBoundGenericStruct())
+    Aggregate = B.createStruct(Loc, Ty, Elements);
+  else
+    Aggregate = B.createTuple(Loc, Ty, Elements);
+  Created.push_back(Aggregate);
+  return Aggregate;
+}
+
+/// SILGen initializes tuples, and the optimizer may leave structs, element by
+/// element. Replaces such stores in the global initializer \p InitF by a single
+/// store of the aggregate, so that the global can be statically initialized.
+static bool combineElementStores(SILFunction *InitF) {
+  if (InitF->size() != 1)
+    return false;
+
+  SILBasicBlock *BB = &InitF->front();
+  GlobalAddrInst *GAI = nullptr;
+  for (auto &I : *BB) {
+    if (auto *Addr = dyn_cast<GlobalAddrInst>(&I)) {
+      if (GAI)
+        return false;
+      GAI = Addr;
+    }
+  }
+  if (!GAI || (GAI->hasOneUse() && isa<StoreInst>(GAI->use_begin()->getUser())))
+    return false;
+
+  SILBuilderWithScope B(BB->getTerminator());
+  SmallVector<SILInstruction *, 16> Dead;
+  SmallVector<SILInstruction *, 8> Created;
+  SILValue Value = getStoredValue(GAI, B, Dead, Created);
+  if (!Value) {
+    while (!Created.empty())
+      Created.pop_back_val()->eraseFromParent();
+    return false;
+  }
+
+  DEBUG(llvm::dbgs() << "GlobalOpt: combine element-wise stores in "
+                     << InitF->getName() << '\n');
+  B.createStore(RegularLocation::getAutoGeneratedLocation(), Value, GAI);
+  for (SILInstruction *I : Dead)
+    I->eraseFromParent();
+  return true;
+}
+
 /// Checks if a given global variable is assigned only once.
 static bool isAssignedOnlyOnceInInitializer(SILGlobalVariable *SILG) {
   if (SILG->isLet())
@@ -868,6 +978,11 @@ void SILGlobalOpt::optimizeGlobalAccess(SILGlobalVariable *SILG,
 }
 
 bool SILGlobalOpt::run() {
+  for (auto &F : *Module) {
+    if (F.getName().startswith("globalinit_") && F.shouldOptimize())
+      HasChanged |= combineElementStores(&F);
+  }
+
   for (auto &F : *Module) {
 
     // Don't optimize functions that are marked with the opt.never attribute.
@@ -23,7 +23,10 @@
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "swift/SILOptimizer/Utils/Local.h"
 #include "swift/SILOptimizer/Utils/ConstantFolding.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
 #include "swift/SILOptimizer/Utils/SILInliner.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -49,6 +52,11 @@ namespace {
   llvm::cl::opt<int> TestOpt("sil-inline-test",
                                    llvm::cl::init(0), llvm::cl::Hidden);
 
+  // Print the optimization remark of each inlining decision to stderr.
+  llvm::cl::opt<bool> InlineRemarks("sil-inline-remarks",
+                                    llvm::cl::init(false), llvm::cl::Hidden,
+                       llvm::cl::desc("Print the inliner's decisions as YAML"));
+
   // The following constants define the cost model for inlining.
 
   // The base value for every call: it represents the benefit of removing the
@@ -67,6 +75,11 @@ namespace {
   // Additional benefit for each loop level.
   const unsigned LoopBenefitFactor = 40;
 
+  // Additional benefit for a call site which was executed at least
+  // HotCallSiteCount times according to -profile-use data.
+  const unsigned HotCallSiteBenefit = 80;
+  const uint64_t HotCallSiteCount = 1000;
+
   // Approximately up to this cost level a function can be inlined without
   // increasing the code size.
   const unsigned TrivialFunctionThreshold = 20;
@@ -74,6 +87,11 @@ namespace {
   // Configuration for the caller block limit.
   const unsigned BlockLimitDenominator = 10000;
 
+  // The maximum number of nested calls in the callee through which constants
+  // of the caller are tracked, e.g. a closure which is passed down through
+  // several wrapper functions.
+  const unsigned MaxCallChainDepth = 3;
+
   // Represents a value in integer constant evaluation.
   struct IntConst {
     IntConst() : isValid(false), isFromCaller(false) { }
@@ -139,16 +157,32 @@ namespace {
     SILValue getStoredValue(SILInstruction *loadInst,
                             ProjectionPath &projStack);
 
-    // Gets the parameter in the caller for a function argument.
+    // Gets the parameter in the caller for a function argument. The argument
+    // can be in any function of the call chain.
     SILValue getParam(SILValue value) {
       if (SILArgument *arg = dyn_cast<SILArgument>(value)) {
-        if (AI && arg->isFunctionArg() && arg->getFunction() == F) {
-          // Continue at the caller.
-          return AI.getArgument(arg->getIndex());
+        if (!arg->isFunctionArg())
+          return SILValue();
+        for (ConstantTracker *T = this; T && T->AI; T = T->callerTracker) {
+          if (arg->getFunction() == T->F) {
+            // Continue at the caller.
+            return T->AI.getArgument(arg->getIndex());
+          }
         }
       }
       return SILValue();
     }
+
+    // Gets the store instruction which is linked to a load in any function
+    // of the call chain.
+    SILInstruction *getLink(SILInstruction *loadInst) {
+      for (ConstantTracker *T = this; T; T = T->callerTracker) {
+        auto Iter = T->links.find(loadInst);
+        if (Iter != T->links.end())
+          return Iter->second;
+      }
+      return nullptr;
+    }
     
     SILInstruction *getMemoryContent(SILValue addr) {
       // The memory content can be stored in this ConstantTracker or in the
@@ -195,10 +229,30 @@ namespace {
       return getDef(val, projStack);
     }
     
-    // Gets the estimated definition of a value if it is in the caller.
+    // Returns true if \p function is tracked by this tracker or by one of its
+    // callers.
+    bool isOnCallChain(SILFunction *function) const {
+      for (const ConstantTracker *T = this; T; T = T->callerTracker)
+        if (T->F == function)
+          return true;
+      return false;
+    }
+
+    // Returns the function at the root of the call chain, i.e. the function
+    // into which the callees would be inlined.
+    SILFunction *getRootFunction() const {
+      const ConstantTracker *T = this;
+      while (T->callerTracker)
+        T = T->callerTracker;
+      return T->F;
+    }
+
+    // Gets the estimated definition of a value if it is in the root caller.
+    // Definitions in intermediate functions of the call chain don't count:
+    // they are already there, whether or not the chain gets inlined.
     SILInstruction *getDefInCaller(SILValue val) {
       SILInstruction *def = getDef(val);
-      if (def && def->getFunction() != F)
+      if (def && def->getFunction() == getRootFunction())
         return def;
       return nullptr;
     }
@@ -229,6 +283,24 @@ namespace {
     /// B into A.
     llvm::DenseSet<std::pair<StringRef, StringRef>> InlinedFunctions;
 
+    /// The nested apply, its loop and chain depth, and the caller definitions
+    /// of its arguments.
+    typedef llvm::SmallVector<uintptr_t, 8> CallChainKey;
+
+    /// The result of getCallChainBenefit for a nested call.
+    struct CallChainBenefit {
+      CallChainKey Key;
+      unsigned Benefit;
+      bool HasConstCallee;
+    };
+
+    /// Caches getCallChainBenefit for the call site currently being evaluated
+    /// by isProfitableToInline, indexed by the hash of the key. Without the
+    /// cache, a function which is reached on several paths of the call chain
+    /// is scanned once for each path.
+    llvm::DenseMap<unsigned, llvm::SmallVector<CallChainBenefit, 1>>
+      CallChainCache;
+
     SILFunction *getEligibleFunction(FullApplySite AI);
 
     bool isProfitableToInline(FullApplySite AI, unsigned loopDepthOfAI,
@@ -237,6 +309,12 @@ namespace {
                               ConstantTracker &constTracker,
                               unsigned &NumCallerBlocks);
 
+    unsigned getCallChainBenefit(FullApplySite AI,
+                                 ConstantTracker &callerTracker,
+                                 DominanceAnalysis *DA, SILLoopAnalysis *LA,
+                                 unsigned loopDepth, unsigned chainDepth,
+                                 bool &hasConstCallee);
+
     void visitColdBlocks(SmallVectorImpl<FullApplySite> &AppliesToInline,
                          SILBasicBlock *root, DominanceInfo *DT);
 
@@ -310,9 +388,7 @@ SILValue ConstantTracker::scanProjections(SILValue addr,
 
 SILValue ConstantTracker::getStoredValue(SILInstruction *loadInst,
                                   ProjectionPath &projStack) {
-  SILInstruction *store = links[loadInst];
-  if (!store && callerTracker)
-    store = callerTracker->links[loadInst];
+  SILInstruction *store = getLink(loadInst);
   if (!store) return SILValue();
 
   assert(isa<LoadInst>(loadInst) || isa<CopyAddrInst>(loadInst));
@@ -489,7 +565,7 @@ IntConst ConstantTracker::getIntConst(SILValue val, int depth) {
     return IntConst();
   
   if (auto *IL = dyn_cast<IntegerLiteralInst>(I)) {
-    return IntConst(IL->getValue(), IL->getFunction() != F);
+    return IntConst(IL->getValue(), IL->getFunction() == getRootFunction());
   }
   if (auto *BI = dyn_cast<BuiltinInst>(I)) {
     if (constCache.count(BI) != 0)
@@ -700,6 +776,118 @@ static SILBasicBlock *getTakenBlock(TermInst *term,
   return nullptr;
 }
 
+/// Record an inlining decision as optimization remark. With
+/// -sil-inline-remarks it is also printed to stderr.
+static void emitInlineRemark(FullApplySite AI, bool Inlined, StringRef Reason,
+                             unsigned Cost, unsigned Threshold,
+                             unsigned ChainBenefit) {
+  if (!InlineRemarks && !OptRemark::isEnabled(AI.getModule()))
+    return;
+  OptRemark Remark(Inlined ? OptRemark::Kind::Passed : OptRemark::Kind::Missed,
+                   "sil-inliner", Reason, AI.getInstruction());
+  Remark.arg("Callee", AI.getCalleeFunction()->getName())
+        .arg("Cost", Cost)
+        .arg("Threshold", Threshold)
+        .arg("CallChainBenefit", ChainBenefit);
+  Remark.emit();
+  if (InlineRemarks)
+    Remark.print(llvm::errs());
+}
+
+/// Returns the callee of an apply inside a callee, if constants of the
+/// original caller should be tracked into it.
+static SILFunction *getCallChainCallee(FullApplySite AI,
+                                       ConstantTracker &constTracker) {
+  SILFunction *Callee = AI.getCalleeFunction();
+  if (!Callee || !Callee->isDefinition() || AI.hasSubstitutions())
+    return nullptr;
+  if (Callee->getInlineStrategy() == NoInline || !Callee->shouldOptimize())
+    return nullptr;
+  if (constTracker.isOnCallChain(Callee) || calleeIsSelfRecursive(Callee))
+    return nullptr;
+
+  // Only follow the call if something of the caller is passed to it.
+  for (SILValue Arg : AI.getArguments())
+    if (constTracker.getDefInCaller(Arg))
+      return Callee;
+  return nullptr;
+}
+
+/// Computes the benefit of the constants and closures of the caller which are
+/// passed down through \p AI in a callee, i.e. the benefit which is only
+/// visible if the whole chain of calls gets inlined. Benefits inside loops are
+/// weighted by the sum of the loop depths along the call chain.
+unsigned SILPerformanceInliner::getCallChainBenefit(
+    FullApplySite AI, ConstantTracker &callerTracker, DominanceAnalysis *DA,
+    SILLoopAnalysis *LA, unsigned loopDepth, unsigned chainDepth,
+    bool &hasConstCallee) {
+  CallChainKey Key;
+  Key.push_back(reinterpret_cast<uintptr_t>(AI.getInstruction()));
+  Key.push_back(loopDepth);
+  Key.push_back(chainDepth);
+  for (SILValue Arg : AI.getArguments())
+    Key.push_back(reinterpret_cast<uintptr_t>(
+        callerTracker.getDefInCaller(Arg)));
+
+  unsigned KeyHash = llvm::hash_combine_range(Key.begin(), Key.end());
+  auto CacheIter = CallChainCache.find(KeyHash);
+  if (CacheIter != CallChainCache.end()) {
+    for (const CallChainBenefit &Entry : CacheIter->second) {
+      if (Entry.Key == Key) {
+        hasConstCallee |= Entry.HasConstCallee;
+        return Entry.Benefit;
+      }
+    }
+  }
+
+  SILFunction *Callee = AI.getCalleeFunction();
+  bool calleeHasConstCallee = false;
+  ConstantTracker constTracker(Callee, &callerTracker, AI);
+  DominanceInfo *DT = DA->get(Callee);
+  SILLoopInfo *LI = LA->get(Callee);
+  DominanceOrder domOrder(&Callee->front(), DT, Callee->size());
+
+  unsigned Benefit = 0;
+  while (SILBasicBlock *block = domOrder.getNext()) {
+    constTracker.beginBlock();
+    unsigned blockLoopDepth = loopDepth + LI->getLoopDepth(block);
+    for (SILInstruction &I : *block) {
+      constTracker.trackInst(&I);
+
+      auto NestedAI = FullApplySite::isa(&I);
+      if (!NestedAI)
+        continue;
+
+      SILInstruction *def = constTracker.getDefInCaller(NestedAI.getCallee());
+      if (def && (isa<FunctionRefInst>(def) || isa<PartialApplyInst>(def))) {
+        DEBUG(llvm::dbgs() << "        Boost: apply const function in "
+                           << Callee->getName() << " at" << I);
+        Benefit += ConstCalleeBenefit + blockLoopDepth * LoopBenefitFactor;
+        calleeHasConstCallee = true;
+      } else if (chainDepth < MaxCallChainDepth) {
+        if (getCallChainCallee(NestedAI, constTracker))
+          Benefit += getCallChainBenefit(NestedAI, constTracker, DA, LA,
+                                         blockLoopDepth, chainDepth + 1,
+                                         calleeHasConstCallee);
+      }
+    }
+    SILBasicBlock *takenBlock = getTakenBlock(block->getTerminator(),
+                                              constTracker);
+    if (takenBlock) {
+      Benefit += ConstTerminatorBenefit;
+      domOrder.pushChildrenIf(block, [=] (SILBasicBlock *child) {
+        return child->getSinglePredecessor() != block || child == takenBlock;
+      });
+    } else {
+      domOrder.pushChildren(block);
+    }
+  }
+
+  CallChainCache[KeyHash].push_back({Key, Benefit, calleeHasConstCallee});
+  hasConstCallee |= calleeHasConstCallee;
+  return Benefit;
+}
+
 /// Return true if inlining this call site is profitable.
 bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
                                               unsigned loopDepthOfAI,
@@ -709,10 +897,13 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
                                               unsigned &NumCallerBlocks) {
   SILFunction *Callee = AI.getCalleeFunction();
   
-  if (Callee->getInlineStrategy() == AlwaysInline)
+  if (Callee->getInlineStrategy() == AlwaysInline) {
+    emitInlineRemark(AI, true, "AlwaysInline", 0, 0, 0);
     return true;
+  }
   
   ConstantTracker constTracker(Callee, &callerTracker, AI);
+  CallChainCache.clear();
   
   DominanceInfo *DT = DA->get(Callee);
   SILLoopInfo *LI = LA->get(Callee);
@@ -721,11 +912,20 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
   
   // Calculate the inlining cost of the callee.
   unsigned CalleeCost = 0;
+  unsigned ChainBenefit = 0;
   unsigned Benefit = InlineCostThreshold > 0 ? InlineCostThreshold :
                                                RemovedCallBenefit;
   Benefit += loopDepthOfAI * LoopBenefitFactor;
   int testThreshold = TestThreshold;
 
+  auto CallCount = ColdBlockInfo::getProfileCount(AI.getParent(),
+                                                  DA->get(AI.getFunction()));
+  if (CallCount && *CallCount >= HotCallSiteCount) {
+    DEBUG(llvm::dbgs() << "        Boost: hot call site, count: "
+                       << *CallCount << "\n");
+    Benefit += HotCallSiteBenefit;
+  }
+
   while (SILBasicBlock *block = domOrder.getNext()) {
     constTracker.beginBlock();
     for (SILInstruction &I : *block) {
@@ -753,6 +953,22 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
           unsigned loopDepth = LI->getLoopDepth(block);
           Benefit += ConstCalleeBenefit + loopDepth * LoopBenefitFactor;
           testThreshold *= 2;
+        } else if (getCallChainCallee(AI, constTracker)) {
+          // The callee passes constants or closures of the caller further
+          // down to another function. Inlining the callee is the first step
+          // of flattening the whole chain of calls.
+          bool hasConstCallee = false;
+          unsigned loopDepth = LI->getLoopDepth(block);
+          unsigned NestedBenefit =
+            getCallChainBenefit(AI, constTracker, DA, LA, loopDepth, 1,
+                                hasConstCallee);
+          if (NestedBenefit) {
+            DEBUG(llvm::dbgs() << "        Boost: call chain benefit "
+                               << NestedBenefit << " at" << *AI);
+            ChainBenefit += NestedBenefit;
+            if (hasConstCallee)
+              testThreshold *= 2;
+          }
         }
       }
     }
@@ -771,6 +987,7 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
     }
   }
 
+  Benefit += ChainBenefit;
   unsigned Threshold = Benefit; // The default.
   if (testThreshold >= 0) {
     // We are in testing mode.
@@ -796,10 +1013,13 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
   if (CalleeCost > Threshold) {
     DEBUG(llvm::dbgs() << "        NO: Function too big to inline, "
           "cost: " << CalleeCost << ", threshold: " << Threshold << "\n");
+    emitInlineRemark(AI, false, "TooCostly", CalleeCost, Threshold,
+                     ChainBenefit);
     return false;
   }
   DEBUG(llvm::dbgs() << "        YES: ready to inline, "
         "cost: " << CalleeCost << ", threshold: " << Threshold << "\n");
+  emitInlineRemark(AI, true, "Inlined", CalleeCost, Threshold, ChainBenefit);
   NumCallerBlocks += Callee->size();
   return true;
 }
@@ -841,6 +1061,17 @@ void SILPerformanceInliner::collectAppliesToInline(
 
   unsigned NumCallerBlocks = Caller->size();
 
+  // A function which was never executed in the profiled run is cold as a
+  // whole.
+  auto isNeverExecuted = [](SILBasicBlock *BB) {
+    auto Count = BB->getProfileCount();
+    return Count && *Count == 0;
+  };
+  if (isNeverExecuted(&Caller->front())) {
+    visitColdBlocks(Applies, &Caller->front(), DT);
+    return;
+  }
+
   // Go through all instructions and find candidates for inlining.
   // We do this in dominance order for the constTracker.
   SmallVector<FullApplySite, 8> InitialCandidates;
@@ -865,7 +1096,7 @@ void SILPerformanceInliner::collectAppliesToInline(
       }
     }
     domOrder.pushChildrenIf(block, [&] (SILBasicBlock *child) {
-      if (ColdBlockInfo::isSlowPath(block, child)) {
+      if (ColdBlockInfo::isSlowPath(block, child) || isNeverExecuted(child)) {
         // Handle cold blocks separately.
         visitColdBlocks(InitialCandidates, child, DT);
         return false;
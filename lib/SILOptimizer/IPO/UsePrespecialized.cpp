@@ -114,7 +114,7 @@ bool UsePrespecialized::replaceByPrespecialized(SILFunction &F) {
       if (PrevF->getLinkage() != SILLinkage::SharedExternal)
         NewF = PrevF;
     } else {
-      PrevF = getExistingSpecialization(M, ClonedName);
+      PrevF = getExistingSpecialization(M, ClonedName, SubsFunctionType);
       if (!PrevF)
         continue;
       NewF = PrevF;
@@ -26,6 +26,8 @@
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "swift/SILOptimizer/Utils/CFG.h"
 #include "swift/SILOptimizer/Utils/Local.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
+#include "swift/SILOptimizer/Utils/RegionCloner.h"
 #include "swift/SILOptimizer/Utils/SILSSAUpdater.h"
 #include "swift/SIL/Dominance.h"
 #include "swift/SIL/PatternMatch.h"
@@ -38,6 +40,7 @@
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Allocator.h"
@@ -59,6 +62,18 @@ static llvm::cl::opt<bool> EnableABCOpts("enable-abcopts",
 static llvm::cl::opt<bool> EnableABCHoisting("enable-abc-hoisting",
                                              llvm::cl::init(true));
 
+static llvm::cl::opt<bool> EnableABCVersioning("enable-abc-versioning",
+                                               llvm::cl::init(true));
+
+static llvm::cl::opt<unsigned>
+ABCVersioningSizeLimit("abc-versioning-size-limit", llvm::cl::init(200),
+                       llvm::cl::desc("The maximum number of instructions in "
+                                      "a loop which is versioned to remove "
+                                      "bounds checks"));
+
+STATISTIC(NumLoopsVersioned, "Number of loops versioned on bounds checks");
+STATISTIC(NumChecksVersioned, "Number of bounds checks removed by versioning");
+
 
 using ArraySet = llvm::SmallPtrSet<SILValue, 16>;
 // A pair of the array pointer and the array check kind (kCheckIndex or
@@ -913,6 +928,8 @@ public:
     return nullptr;
   }
 
+  InductionInfo *getInduction() { return Ind; }
+
   /// Returns true if the loop iterates from 0 until count of \p Array.
   bool isZeroToCount(SILValue Array) {
     return getZeroToCountArray(Ind->Start, Ind->End) == Array;
@@ -957,6 +974,13 @@ static bool hasArrayType(SILValue Value, SILModule &M) {
            M.getASTContext().getArrayDecl();
 }
 
+/// Record what happened to the bounds check \p Check in a loop.
+static void emitCheckRemark(SILInstruction *Check, OptRemark::Kind K,
+                            StringRef Name) {
+  if (OptRemark::isEnabled(Check->getModule()))
+    OptRemark(K, DEBUG_TYPE, Name, Check).emit();
+}
+
 /// Hoist bounds check in the loop to the loop preheader.
 static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
                               ABCAnalysis &ABC, InductionAnalysis &IndVars,
@@ -986,6 +1010,7 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
     // The array must strictly dominate the header.
     if (!dominates(DT, Array, Preheader)) {
       DEBUG(llvm::dbgs() << " does not dominated header" << *Array);
+      emitCheckRemark(Inst, OptRemark::Kind::Missed, "ArrayDefinedInLoop");
       continue;
     }
 
@@ -994,6 +1019,7 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
     // array, which loaded from memory and the memory is not changed in the loop.
     if (!dominates(DT, ArrayVal, Preheader) && ABC.isUnsafe(Array)) {
       DEBUG(llvm::dbgs() << " not a safe array argument " << *Array);
+      emitCheckRemark(Inst, OptRemark::Kind::Missed, "ArrayMayChange");
       continue;
     }
 
@@ -1007,6 +1033,7 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
       assert(ArrayCall.canHoist(Preheader->getTerminator(), DT) &&
              "Must be able to hoist the instruction.");
       Changed = true;
+      emitCheckRemark(Inst, OptRemark::Kind::Passed, "HoistedInvariantCheck");
       ArrayCall.hoist(Preheader->getTerminator(), DT);
       DEBUG(llvm::dbgs() << " could hoist invariant bounds check: " << *Inst);
       continue;
@@ -1017,6 +1044,7 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
     auto F = AccessFunction::getLinearFunction(ArrayIndex, IndVars);
     if (!F) {
       DEBUG(llvm::dbgs() << " not a linear function " << *Inst);
+      emitCheckRemark(Inst, OptRemark::Kind::Missed, "NonLinearIndex");
       continue;
     }
 
@@ -1027,20 +1055,24 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
       // We can remove the check. This is even possible if the block does not
       // dominate the loop exit block.
       Changed = true;
+      emitCheckRemark(Inst, OptRemark::Kind::Passed, "RemovedCheck");
       ArrayCall.removeCall();
       DEBUG(llvm::dbgs() << "  Bounds check removed\n");
       continue;
     }
     
     // For hoisting bounds checks the block must dominate the exit block.
-    if (!blockAlwaysExecutes)
+    if (!blockAlwaysExecutes) {
+      emitCheckRemark(Inst, OptRemark::Kind::Missed, "NotAlwaysExecuted");
       continue;
+    }
 
     // Hoist the access function and the check to the preheader for start and
     // end of the induction.
     assert(ArrayCall.canHoist(Preheader->getTerminator(), DT) &&
            "Must be able to hoist the call");
 
+    emitCheckRemark(Inst, OptRemark::Kind::Passed, "HoistedCheck");
     F.hoistCheckToPreheader(ArrayCall, Preheader, DT);
 
     // Remove the old check in the loop and the match the retain with a release.
@@ -1059,11 +1091,219 @@ static bool hoistChecksInLoop(DominanceInfo *DT, DominanceInfoNode *DTNode,
   return Changed;
 }
 
+/// A bounds check which cannot be hoisted, but which is known to succeed if
+/// the indices of all iterations of the loop are in range.
+struct VersionedCheck {
+  ArrayCallKind Kind;
+  /// The count of the checked array, computed before the loop.
+  SILValue Count;
+  /// The index of a loop invariant check.
+  SILValue Index;
+  /// The range [Start, End) of the induction variable of a linear check.
+  SILValue Start;
+  SILValue End;
+};
+
+/// A loop which is versioned into a fast loop without any bounds checks and
+/// the original loop. A single range check in front of the loops selects which
+/// one is executed.
+struct LoopVersioningCandidate {
+  SILBasicBlock *Preheader;
+  SmallVector<SILBasicBlock *, 2> ExitBlocks;
+  SmallVector<VersionedCheck, 4> Checks;
+};
+
+/// Returns the result of an array.get_count call on \p Array which dominates
+/// the preheader.
+static SILValue getCountBeforeLoop(SILValue Array, SILBasicBlock *Preheader,
+                                   DominanceInfo *DT) {
+  for (auto *Use : Array->getUses()) {
+    ArraySemanticsCall Call(Use->getUser());
+    if (Call.getKind() != ArrayCallKind::kGetCount ||
+        Call.getSelf() != Array)
+      continue;
+    ApplyInst *AI = Call;
+    if (dominates(DT, AI, Preheader))
+      return AI;
+  }
+  return SILValue();
+}
+
+/// Values used by the versioning check must not be defined in a loop which
+/// does not contain \p Loop: versioning that loop would rewrite them.
+static bool isDefinedOutsideOtherLoops(SILValue V, SILLoop *Loop,
+                                       SILLoopInfo *LI) {
+  auto *DefBB = V->getParentBB();
+  if (!DefBB)
+    return false;
+  auto *DefLoop = LI->getLoopFor(DefBB);
+  return !DefLoop || DefLoop->contains(Loop);
+}
+
+/// Collects the bounds checks which remain in the loop after hoisting. Returns
+/// false if any of them is not known to succeed for a range of indices which
+/// can be computed in the preheader.
+static bool getVersionedChecks(SILLoop *Loop, DominanceInfo *DT,
+                               SILLoopInfo *LI, InductionAnalysis &IndVars,
+                               SILBasicBlock *Preheader,
+                               SmallVectorImpl<VersionedCheck> &Checks) {
+  unsigned NumInsts = 0;
+  for (auto *BB : Loop->getBlocks()) {
+    for (auto &Inst : *BB) {
+      if (++NumInsts > ABCVersioningSizeLimit)
+        return false;
+
+      ArraySemanticsCall ArrayCall(&Inst);
+      auto Kind = ArrayCall.getKind();
+      if (Kind != ArrayCallKind::kCheckSubscript &&
+          Kind != ArrayCallKind::kCheckIndex)
+        continue;
+
+      // The count of the array must be known in front of the loop. This works
+      // only for Arrays, which are indexed from zero, but not e.g. for
+      // ArraySlice.
+      auto ArrayVal = ArrayCall.getSelf();
+      if (!dominates(DT, ArrayVal, Preheader) ||
+          !hasArrayType(ArrayVal, BB->getModule()))
+        return false;
+      VersionedCheck Check;
+      Check.Kind = Kind;
+      Check.Count = getCountBeforeLoop(ArrayVal, Preheader, DT);
+      if (!Check.Count || !isDefinedOutsideOtherLoops(Check.Count, Loop, LI))
+        return false;
+
+      auto ArrayIndex = ArrayCall.getIndex();
+      if (!ArrayIndex)
+        return false;
+      if (dominates(DT, ArrayIndex, Preheader)) {
+        if (!isDefinedOutsideOtherLoops(ArrayIndex, Loop, LI))
+          return false;
+        Check.Index = ArrayIndex;
+      } else {
+        auto F = AccessFunction::getLinearFunction(ArrayIndex, IndVars);
+        if (!F)
+          return false;
+        Check.Start = F.getInduction()->Start;
+        Check.End = F.getInduction()->End;
+        if (!isDefinedOutsideOtherLoops(Check.Start, Loop, LI) ||
+            !isDefinedOutsideOtherLoops(Check.End, Loop, LI))
+          return false;
+      }
+      Checks.push_back(Check);
+    }
+  }
+  return !Checks.empty();
+}
+
+/// Returns the builtin integer value of an Int.
+static SILValue getBuiltinInteger(SILBuilder &B, SILLocation Loc,
+                                  SILValue Int) {
+  if (auto *SI = dyn_cast<StructInst>(Int))
+    return SI->getElements()[0];
+  auto *SD = Int->getType().getStructOrBoundGenericStruct();
+  assert(SD && "Int must be a struct");
+  return B.createStructExtract(Loc, Int, *SD->getStoredProperties().begin());
+}
+
+/// Creates the condition under which all versioned checks succeed: the first
+/// and the last index of each check is in the range of its array.
+static SILValue createInRangeCheck(ArrayRef<VersionedCheck> Checks,
+                                   SILBuilder &B, SILLocation Loc) {
+  auto Int1Ty = SILType::getBuiltinIntegerType(1, B.getASTContext());
+  SILValue Result = B.createIntegerLiteral(Loc, Int1Ty, 1);
+
+  for (auto &Check : Checks) {
+    SILValue First, Last;
+    if (Check.Index) {
+      First = Last = getBuiltinInteger(B, Loc, Check.Index);
+    } else {
+      First = Check.Start;
+      Last = getSub(Loc, Check.End, 1, B);
+    }
+    SILValue Count = getBuiltinInteger(B, Loc, Check.Count);
+    SILType IntTy = First->getType();
+
+    // check_subscript requires 0 <= index < count, check_index requires
+    // 0 <= index <= count.
+    SILValue Zero = B.createIntegerLiteral(Loc, IntTy, 0);
+    auto *FirstInRange = B.createBuiltinBinaryFunction(
+        Loc, "cmp_sge", IntTy, Int1Ty, {First, Zero});
+    StringRef LastCmp =
+        Check.Kind == ArrayCallKind::kCheckSubscript ? "cmp_slt" : "cmp_sle";
+    auto *LastInRange = B.createBuiltinBinaryFunction(Loc, LastCmp, IntTy,
+                                                      Int1Ty, {Last, Count});
+    Result = B.createBuiltinBinaryFunction(Loc, "and", Int1Ty, Int1Ty,
+                                           {Result, FirstInRange});
+    Result = B.createBuiltinBinaryFunction(Loc, "and", Int1Ty, Int1Ty,
+                                           {Result, LastInRange});
+  }
+  return Result;
+}
+
+/// Clones the loop and removes all bounds checks in the clone. The clone is
+/// executed if the indices of all checks are in range, otherwise the original
+/// loop is executed.
+static void versionLoop(LoopVersioningCandidate &Candidate,
+                        DominanceInfo *DT) {
+  // Split off an empty block from the preheader which holds the range check.
+  // We don't want to duplicate the original preheader, it might contain
+  // instructions which we can't clone.
+  SILBuilder B(Candidate.Preheader);
+  auto *CheckBlock = splitBasicBlockAndBranch(
+      B, Candidate.Preheader->getTerminator(), DT, nullptr);
+
+  // The exit blocks dominated by the loop will be dominated by the check
+  // block.
+  SmallVector<SILBasicBlock *, 2> ExitBlocksDominatedByCheck;
+  for (auto *ExitBlock : Candidate.ExitBlocks)
+    if (DT->dominates(CheckBlock, ExitBlock))
+      ExitBlocksDominatedByCheck.push_back(ExitBlock);
+
+  SILBasicBlock *NewPreheader =
+      splitBasicBlockAndBranch(B, &*CheckBlock->begin(), DT, nullptr);
+
+  RegionCloner Cloner(NewPreheader, Candidate.ExitBlocks, *DT);
+  auto *FastPreheader = Cloner.cloneRegion();
+
+  SmallVector<ArraySemanticsCall, 8> FastChecks;
+  for (auto &P : Cloner.getBBMap()) {
+    // Skip the exit blocks.
+    if (P.first == P.second)
+      continue;
+    for (auto &Inst : *P.second) {
+      ArraySemanticsCall ArrayCall(&Inst);
+      auto Kind = ArrayCall.getKind();
+      if (Kind == ArrayCallKind::kCheckSubscript ||
+          Kind == ArrayCallKind::kCheckIndex)
+        FastChecks.push_back(ArrayCall);
+    }
+  }
+
+  auto *Term = CheckBlock->getTerminator();
+  B.setInsertionPoint(Term);
+  SILValue InRange = createInRangeCheck(Candidate.Checks, B, Term->getLoc());
+  B.createCondBranch(Term->getLoc(), InRange, FastPreheader, NewPreheader);
+  Term->eraseFromParent();
+
+  for (auto *BB : ExitBlocksDominatedByCheck)
+    DT->changeImmediateDominator(DT->getNode(BB), DT->getNode(CheckBlock));
+
+  for (auto ArrayCall : FastChecks) {
+    ApplyInst *AI = ArrayCall;
+    emitCheckRemark(AI, OptRemark::Kind::Passed, "VersionedCheck");
+    ArrayCall.removeCall();
+  }
+  ++NumLoopsVersioned;
+  NumChecksVersioned += FastChecks.size();
+}
+
 /// Analyse the loop for arrays that are not modified and perform dominator tree
 /// based redundant bounds check removal.
-static bool hoistBoundsChecks(SILLoop *Loop, DominanceInfo *DT, SILLoopInfo *LI,
-                              IVInfo &IVs, ArraySet &Arrays,
-                              RCIdentityFunctionInfo *RCIA, bool ShouldVerify) {
+static bool
+hoistBoundsChecks(SILLoop *Loop, DominanceInfo *DT, SILLoopInfo *LI,
+                  IVInfo &IVs, ArraySet &Arrays, RCIdentityFunctionInfo *RCIA,
+                  SmallVectorImpl<LoopVersioningCandidate> &VersioningCandidates,
+                  bool ShouldVerify) {
   auto *Header = Loop->getHeader();
   if (!Header) return false;
 
@@ -1136,6 +1376,20 @@ static bool hoistBoundsChecks(SILLoop *Loop, DominanceInfo *DT, SILLoopInfo *LI,
   if (Changed) {
     Preheader->getParent()->verify();
   }
+
+  // Version the loop on the checks which could not be hoisted. This is done
+  // after all loops have been processed, because it invalidates the loop info.
+  if (EnableABCVersioning) {
+    LoopVersioningCandidate Candidate;
+    Candidate.Preheader = Preheader;
+    Candidate.ExitBlocks.push_back(ExitBlk);
+    if (getVersionedChecks(Loop, DT, LI, IndVars, Preheader,
+                           Candidate.Checks)) {
+      DEBUG(llvm::dbgs() << "Versioning " << Candidate.Checks.size()
+                         << " bounds checks in " << *Loop);
+      VersioningCandidates.push_back(Candidate);
+    }
+  }
   return Changed;
 }
 
@@ -1227,6 +1481,7 @@ public:
     if (ShouldReportBoundsChecks) { reportBoundsChecks(F); };
 
     bool ShouldVerify = getOptions().VerifyAll;
+    SmallVector<LoopVersioningCandidate, 4> VersioningCandidates;
 
     if (LI->empty()) {
       DEBUG(llvm::dbgs() << "No loops in " << F->getName() << "\n");
@@ -1246,14 +1501,28 @@ public:
 
         while (!Worklist.empty()) {
           Changed |= hoistBoundsChecks(Worklist.pop_back_val(), DT, LI, IVs,
-                                       ReleaseSafeArrays, RCIA, ShouldVerify);
+                                       ReleaseSafeArrays, RCIA,
+                                       VersioningCandidates, ShouldVerify);
         }
       }
 
+      // Version loops on the checks which could not be hoisted. The cloner
+      // keeps the dominator tree up to date.
+      for (auto &Candidate : VersioningCandidates)
+        versionLoop(Candidate, DT);
+      if (!VersioningCandidates.empty()) {
+        splitAllCriticalEdges(*F, true /* only cond_br terminators*/, DT,
+                              nullptr);
+        if (ShouldVerify)
+          F->verify();
+      }
+
       if (ShouldReportBoundsChecks) { reportBoundsChecks(F); };
     }
 
-    if (Changed) {
+    if (!VersioningCandidates.empty()) {
+      PM->invalidateAnalysis(F, SILAnalysis::InvalidationKind::FunctionBody);
+    } else if (Changed) {
       PM->invalidateAnalysis(F,
                           SILAnalysis::InvalidationKind::CallsAndInstructions);
     }
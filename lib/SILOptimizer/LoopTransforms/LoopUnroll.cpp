@@ -173,6 +173,11 @@ static bool canAndShouldUnrollLoop(SILLoop *Loop, uint64_t TripCount) {
   // We can unroll a loop if we can duplicate the instructions it holds.
   uint64_t Cost = 0;
   for (auto *BB : Loop->getBlocks()) {
+    // Unrolling a loop which -profile-use data shows was never entered only
+    // grows the code.
+    auto Count = BB->getProfileCount();
+    if (Count && *Count == 0)
+      return false;
     for (auto &Inst : *BB) {
       if (!Loop->canDuplicate(&Inst))
         return false;
@@ -253,6 +253,9 @@ void swift::runSILOptimizationPasses(SILModule &Module) {
   PM.addDeadFunctionElimination();
   // Start by cloning functions from stdlib.
   PM.addSILLinker();
+  // Resolve class methods with a single implementation in the module before
+  // the first inlining.
+  PM.addClassMethodDevirtualizer();
   PM.run();
   PM.resetAndRemoveTransformations();
 
@@ -304,12 +307,21 @@ void swift::runSILOptimizationPasses(SILModule &Module) {
   // Specialize closure.
   PM.addClosureSpecializer();
 
+  // Pass concrete values instead of existentials, so that the following SSA
+  // passes can devirtualize protocol method calls in the callees. Like the
+  // passes above, this should run after inlining.
+  PM.addExistentialSpecializer();
+
   // Do the second stack promotion on low-level SIL.
   PM.addStackPromotion();
 
   // Speculate virtual call targets.
   PM.addSpeculativeDevirtualization();
 
+  // Change the conventions of functions which are only called directly before
+  // function signature opts, which would otherwise create thunks for them.
+  PM.addConventionInference();
+
   // We do this late since it is a pass like the inline caches that we only want
   // to run once very late. Make sure to run at least one round of the ARC
   // optimizer after this.
@@ -364,6 +376,10 @@ void swift::runSILOptimizationPasses(SILModule &Module) {
   PM.addCodeSinking();
   PM.addLICM();
 
+  // Move the remaining retains and releases of references, which LICM made
+  // loop invariant, out of loops.
+  PM.addARCLoopHoisting();
+
   // Optimize overflow checks.
   PM.addRedundantOverflowCheckRemoval();
   PM.addMergeCondFails();
@@ -372,6 +388,20 @@ void swift::runSILOptimizationPasses(SILModule &Module) {
   PM.addDCE();
   PM.addSimplifyCFG();
   PM.runOneIteration();
+  PM.resetAndRemoveTransformations();
+
+  // Summarize the public functions for the module file, now that their bodies
+  // are final.
+  PM.setStageName("FunctionSummaries");
+  PM.addComputeFunctionSummaries();
+  PM.runOneIteration();
+  PM.resetAndRemoveTransformations();
+
+  // Lay out the code for IRGen.
+  PM.setStageName("CodeLayout");
+  PM.addBlockLayout();
+  PM.addFunctionLayout();
+  PM.runOneIteration();
 
   // Call the CFG viewer.
   if (SILViewCFG) {
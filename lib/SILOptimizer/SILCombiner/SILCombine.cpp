@@ -16,6 +16,12 @@
 // work queue in order to reduce compile time by not visiting trivially dead
 // instructions.
 //
+// The function is walked once. After that, only instructions which may be
+// affected by a change are revisited: newly created instructions, users of
+// replaced or modified instructions, and operands of erased instructions and
+// the other users of their address operands. The function is walked again
+// until an iteration doesn't make any changes, in case a change was missed.
+//
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "sil-combine"
@@ -31,13 +37,25 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
 
 using namespace swift;
 
 STATISTIC(NumSimplified, "Number of instructions simplified");
 STATISTIC(NumCombined, "Number of instructions combined");
 STATISTIC(NumDeadInst, "Number of dead insts eliminated");
+STATISTIC(NumWorklistAdds, "Number of instructions revisited by SILCombine");
+STATISTIC(NumIterations, "Number of SILCombine iterations");
+STATISTIC(NumMissedByWorklist,
+          "Number of SILCombine iterations after the first which made changes");
+
+static llvm::cl::opt<bool> SILCombineVerifyFixpoint(
+    "sil-combine-verify-fixpoint", llvm::cl::init(false),
+    llvm::cl::desc("Verify that a second SILCombine iteration over the whole "
+                   "function does not make any changes"));
+
 
 //===----------------------------------------------------------------------===//
 //                              Utility Methods
@@ -109,6 +127,7 @@ void SILCombineWorklist::add(SILInstruction *I) {
     return;
 
   DEBUG(llvm::dbgs() << "SC: ADD: " << *I << '\n');
+  ++NumWorklistAdds;
   Worklist.push_back(I);
 }
 
@@ -170,8 +189,12 @@ bool SILCombiner::doOneIteration(SILFunction &F, unsigned Iteration) {
     DEBUG(llvm::raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     DEBUG(llvm::dbgs() << "SC: Visiting: " << OrigI << '\n');
 
+#ifndef NDEBUG
+    ValueKind Kind = I->getKind();
+#endif
     if (SILInstruction *Result = visit(I)) {
       ++NumCombined;
+      DEBUG(++CombinedByKind[unsigned(Kind)]);
       // Should we replace the old instruction with a new one?
       if (Result != I) {
         assert(&*std::prev(SILBasicBlock::iterator(I)) == Result &&
@@ -236,16 +259,48 @@ void SILCombineWorklist::addInitialGroup(ArrayRef<SILInstruction *> List) {
     }
 }
 
+#ifndef NDEBUG
+/// Returns the name of an instruction kind for debug output.
+static StringRef getKindName(ValueKind Kind) {
+  switch (Kind) {
+#define VALUE(Id, Parent) case ValueKind::Id: return #Id;
+#include "swift/SIL/SILNodes.def"
+  }
+  llvm_unreachable("Unhandled ValueKind in switch.");
+}
+#endif
+
 bool SILCombiner::runOnFunction(SILFunction &F) {
   clear();
 
-  bool Changed = false;
-  // Perform iterations until we do not make any changes.
-  while (doOneIteration(F, Iteration)) {
-    Changed = true;
-    Iteration++;
+  // Everything which may be affected by a change is put back on the worklist,
+  // so usually the second iteration doesn't find anything to do.
+  ++NumIterations;
+  bool Changed = doOneIteration(F, Iteration);
+
+  if (Changed && SILCombineVerifyFixpoint) {
+    ++Iteration;
+    if (doOneIteration(F, Iteration))
+      llvm::report_fatal_error("SILCombine did not reach a fixpoint in " +
+                               F.getName());
+  } else if (Changed) {
+    // Perform iterations until we do not make any changes, in case a combine
+    // changed something which it didn't put back on the worklist.
+    bool LocalChanged;
+    do {
+      ++Iteration;
+      ++NumIterations;
+      LocalChanged = doOneIteration(F, Iteration);
+      if (LocalChanged)
+        ++NumMissedByWorklist;
+    } while (LocalChanged);
   }
 
+  DEBUG(for (auto &Entry : CombinedByKind)
+          llvm::dbgs() << "SC: Combined " << Entry.second << " "
+                       << getKindName(ValueKind(Entry.first)) << " in "
+                       << F.getName() << '\n';);
+
   // Cleanup the builder and return whether or not we made any changes.
   return Changed;
 }
@@ -269,6 +324,8 @@ SILInstruction *SILCombiner::insertNewInstBefore(SILInstruction *New,
 SILInstruction *SILCombiner::replaceInstUsesWith(SILInstruction &I,
                                                  ValueBase *V) {
   Worklist.addUsersToWorklist(&I);   // Add all modified instrs to worklist.
+  // The replacement gets new users, which may enable combining it.
+  Worklist.addValue(V);
 
   DEBUG(llvm::dbgs() << "SC: Replacing " << I << "\n"
         "    with " << *V << '\n');
@@ -292,13 +349,19 @@ SILInstruction *SILCombiner::eraseInstFromFunction(SILInstruction &I,
   assert(hasNoUsesExceptDebug(&I) && "Cannot erase instruction that is used!");
   // Make sure that we reprocess all operands now that we reduced their
   // use counts.
-  if (I.getNumOperands() < 8 && AddOperandsToWorklist) {
+  if (AddOperandsToWorklist) {
     for (auto &OpI : I.getAllOperands()) {
-      if (SILInstruction *Op = llvm::dyn_cast<SILInstruction>(&*OpI.get())) {
+      ValueBase *OpV = &*OpI.get();
+      if (SILInstruction *Op = llvm::dyn_cast<SILInstruction>(OpV)) {
         DEBUG(llvm::dbgs() << "SC: add op " << *Op <<
               " from erased inst to worklist\n");
         Worklist.add(Op);
       }
+      // Some combines of an address user look at all the other users of the
+      // address, e.g. the ones of inject_enum_addr, load and alloc_stack.
+      // Removing a user may enable them.
+      if (OpV->getType().isAddress())
+        Worklist.addUsersToWorklist(OpV);
     }
   }
 
@@ -28,6 +28,7 @@
 #include "swift/SILOptimizer/Utils/Local.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
 
 namespace swift {
 
@@ -119,6 +120,12 @@ class SILCombiner :
   /// The current iteration of the SILCombine.
   unsigned Iteration;
 
+#ifndef NDEBUG
+  /// The number of successful combines per instruction kind in the current
+  /// function, which is printed with -debug-only=sil-combine.
+  llvm::MapVector<unsigned, unsigned> CombinedByKind;
+#endif
+
   /// Builder used to insert instructions.
   SILBuilder &Builder;
 
@@ -140,6 +147,9 @@ public:
 
   void clear() {
     Iteration = 0;
+#ifndef NDEBUG
+    CombinedByKind.clear();
+#endif
     Worklist.zap();
     MadeChange = false;
   }
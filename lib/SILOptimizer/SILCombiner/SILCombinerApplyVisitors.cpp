@@ -1174,6 +1174,7 @@ bool SILCombiner::optimizeIdentityCastComposition(ApplyInst *FInverse,
       continue;
     }
     User->setOperand(0, X);
+    Worklist.add(User);
   }
 
   // Simulate the reference count effects of the calls before removing
@@ -390,7 +390,6 @@ SILInstruction *SILCombiner::visitBuiltinInst(BuiltinInst *I) {
           I->getLoc(), getBuiltinName(I->getBuiltinInfo().ID),
           LCast->getType(), I->getType(), {LCast, RCast});
 
-      I->replaceAllUsesWith(NewCmp);
       replaceInstUsesWith(*I, NewCmp);
       return eraseInstFromFunction(*I);
     }
@@ -39,7 +39,9 @@ SILCombiner::visitRefToRawPointerInst(RefToRawPointerInst *RRPI) {
     if (URCI->getOperand()->getType().getSwiftType()
         ->isAnyClassReferenceType()) {
       RRPI->setOperand(URCI->getOperand());
-      return URCI->use_empty() ? eraseInstFromFunction(*URCI) : nullptr;
+      if (URCI->use_empty())
+        eraseInstFromFunction(*URCI);
+      return RRPI;
     }
     // (ref_to_raw_pointer (unchecked_ref_cast x))
     //    -> (unchecked_trivial_bit_cast x)
@@ -64,7 +66,9 @@ SILInstruction *SILCombiner::visitUpcastInst(UpcastInst *UCI) {
   // (upcast (upcast x)) -> (upcast x)
   if (auto *Op = dyn_cast<UpcastInst>(UCI->getOperand())) {
     UCI->setOperand(Op->getOperand());
-    return Op->use_empty() ? eraseInstFromFunction(*Op) : nullptr;
+    if (Op->use_empty())
+      eraseInstFromFunction(*Op);
+    return UCI;
   }
 
   return nullptr;
@@ -524,6 +528,7 @@ SILInstruction *SILCombiner::visitConvertFunctionInst(ConvertFunctionInst *CFI)
     auto *Use = *(CFI->use_begin());
     assert(!Use->getUser()->hasValue() && "Did not expect user with a result!");
     Use->set(Converted);
+    Worklist.add(Use->getUser());
   }
 
   eraseInstFromFunction(*CFI);
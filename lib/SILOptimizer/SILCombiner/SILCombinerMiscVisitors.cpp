@@ -312,7 +312,7 @@ SILInstruction *SILCombiner::visitAllocStackInst(AllocStackInst *AS) {
   if (IEI && !OEI) {
     auto *ConcAlloc = Builder.createAllocStack(
         AS->getLoc(), IEI->getLoweredConcreteType(), AS->getVarInfo());
-    IEI->replaceAllUsesWith(ConcAlloc);
+    replaceInstUsesWith(*IEI, ConcAlloc);
     eraseInstFromFunction(*IEI);
 
     for (auto UI = AS->use_begin(), UE = AS->use_end(); UI != UE;) {
@@ -1157,7 +1157,7 @@ SILInstruction *SILCombiner::visitWitnessMethodInst(WitnessMethodInst *WMI) {
     if (auto AI = ApplySite::isa(User)) {
       auto Result = tryDevirtualizeWitnessMethod(AI);
       if (Result.first) {
-        User->replaceAllUsesWith(Result.first);
+        replaceInstUsesWith(*User, Result.first);
         eraseInstFromFunction(*User);
       }
     }
@@ -0,0 +1,203 @@
+//===--- CodeLayout.cpp - Order blocks and functions for code locality ----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// IRGen emits functions in the order of the SIL module and blocks in the order
+// of the SIL function. These passes choose that order, so that hot code is
+// packed together:
+//
+// BlockLayout moves cold blocks to the end of each function, keeping the
+// relative order of the remaining blocks. Blocks are cold if ColdBlockInfo
+// considers them cold, if they end in unreachable, if they are the error
+// destination of a try_apply, or if they are only reachable from, or only lead
+// to, other cold blocks.
+//
+// FunctionLayout orders the functions of the module top-down in the call
+// graph, so that callees are emitted close to their callers. With -profile-use
+// data, functions which were called are placed first and functions which were
+// never called are placed last. IRGen marks the latter as cold, which moves
+// them out of the hot text section.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "code-layout"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILModule.h"
+#include "swift/SILOptimizer/Analysis/BasicCalleeAnalysis.h"
+#include "swift/SILOptimizer/Analysis/ColdBlockInfo.h"
+#include "swift/SILOptimizer/Analysis/DominanceAnalysis.h"
+#include "swift/SILOptimizer/Analysis/FunctionOrder.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+using namespace swift;
+
+STATISTIC(NumColdBlocksMoved, "Number of cold blocks moved to function ends");
+STATISTIC(NumFunctionsMoved, "Number of functions reordered");
+
+//===----------------------------------------------------------------------===//
+//                               Block Layout
+//===----------------------------------------------------------------------===//
+
+/// Returns true if \p BB is a seed for the cold region of its function.
+static bool isColdSeed(SILBasicBlock *BB, ColdBlockInfo &CBI) {
+  if (isa<UnreachableInst>(BB->getTerminator()))
+    return true;
+
+  for (SILBasicBlock *Pred : BB->getPreds()) {
+    auto *TAI = dyn_cast<TryApplyInst>(Pred->getTerminator());
+    if (TAI && TAI->getErrorBB() == BB)
+      return true;
+  }
+  return CBI.isCold(BB);
+}
+
+/// Collects the cold blocks of \p F in function order.
+static void getColdBlocks(SILFunction &F, ColdBlockInfo &CBI,
+                          llvm::SmallVectorImpl<SILBasicBlock *> &ColdBlocks) {
+  SILBasicBlock *Entry = &*F.begin();
+  llvm::SmallPtrSet<SILBasicBlock *, 16> Cold;
+  for (auto &BB : F) {
+    if (&BB != Entry && isColdSeed(&BB, CBI))
+      Cold.insert(&BB);
+  }
+  if (Cold.empty())
+    return;
+
+  // Extend the cold region to the blocks which are only reachable from cold
+  // blocks and to the blocks which only lead to cold blocks.
+  auto isCold = [&](SILBasicBlock *BB) { return Cold.count(BB) != 0; };
+  bool Changed;
+  do {
+    Changed = false;
+    for (auto &BB : F) {
+      if (&BB == Entry || isCold(&BB))
+        continue;
+      auto Preds = BB.getPreds();
+      auto Succs = BB.getSuccessors();
+      if ((!BB.pred_empty() &&
+           std::all_of(Preds.begin(), Preds.end(), isCold)) ||
+          (!Succs.empty() && std::all_of(Succs.begin(), Succs.end(), isCold))) {
+        Cold.insert(&BB);
+        Changed = true;
+      }
+    }
+  } while (Changed);
+
+  for (auto &BB : F) {
+    if (isCold(&BB))
+      ColdBlocks.push_back(&BB);
+  }
+}
+
+namespace {
+
+class BlockLayout : public SILFunctionTransform {
+
+  void run() override {
+    SILFunction &F = *getFunction();
+    ColdBlockInfo CBI(getAnalysis<DominanceAnalysis>());
+
+    llvm::SmallVector<SILBasicBlock *, 8> ColdBlocks;
+    getColdBlocks(F, CBI, ColdBlocks);
+    if (ColdBlocks.empty())
+      return;
+
+    // Nothing to do if the cold blocks are already at the end.
+    if (std::equal(ColdBlocks.begin(), ColdBlocks.end(),
+                   std::prev(F.end(), ColdBlocks.size()),
+                   [](SILBasicBlock *BB, SILBasicBlock &InPlace) {
+                     return BB == &InPlace;
+                   }))
+      return;
+
+    DEBUG(llvm::dbgs() << "Moving " << ColdBlocks.size()
+                       << " cold block(s) to the end of " << F.getName()
+                       << '\n');
+    auto &Blocks = F.getBlocks();
+    for (SILBasicBlock *BB : ColdBlocks)
+      Blocks.splice(Blocks.end(), Blocks, BB);
+    NumColdBlocksMoved += ColdBlocks.size();
+
+    // The CFG is the same, but analyses may have cached the order of blocks.
+    invalidateAnalysis(SILAnalysis::InvalidationKind::Branches);
+  }
+
+  StringRef getName() override { return "Block Layout"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createBlockLayout() {
+  return new BlockLayout();
+}
+
+//===----------------------------------------------------------------------===//
+//                              Function Layout
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class FunctionLayout : public SILModuleTransform {
+
+  /// Functions which were called according to -profile-use data come first,
+  /// functions which were never called come last.
+  static unsigned getHotnessRank(SILFunction *F) {
+    auto Count = F->getEntryCount();
+    if (!Count)
+      return 1;
+    return *Count == 0 ? 2 : 0;
+  }
+
+  void run() override {
+    SILModule &M = *getModule();
+    BottomUpFunctionOrder Orderer(M, getAnalysis<BasicCalleeAnalysis>());
+
+    // Callers come before their callees.
+    auto BottomUp = Orderer.getFunctions();
+    llvm::SmallVector<SILFunction *, 32> Order(BottomUp.rbegin(),
+                                               BottomUp.rend());
+    std::stable_sort(Order.begin(), Order.end(),
+                     [](SILFunction *LHS, SILFunction *RHS) {
+                       return getHotnessRank(LHS) < getHotnessRank(RHS);
+                     });
+
+    auto &Functions = M.getFunctionList();
+    unsigned NumMoved = 0;
+    SILModule::iterator Expected = Functions.begin();
+    for (SILFunction *F : Order) {
+      if (Expected != Functions.end() && &*Expected == F)
+        ++Expected;
+      else
+        ++NumMoved;
+    }
+    if (!NumMoved)
+      return;
+
+    for (SILFunction *F : Order)
+      Functions.splice(Functions.end(), Functions, F);
+    NumFunctionsMoved += NumMoved;
+    DEBUG(llvm::dbgs() << "Reordered " << NumMoved << " function(s)\n");
+  }
+
+  StringRef getName() override { return "Function Layout"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createFunctionLayout() {
+  return new FunctionLayout();
+}
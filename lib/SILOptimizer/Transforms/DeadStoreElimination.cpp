@@ -155,9 +155,12 @@ namespace {
 /// behavior or alias query we need to do in worst case is roughly linear to
 /// # of BBs x(times) # of locations.
 ///
-/// we could run DSE on functions with 256 basic blocks and 256 locations,
-/// which is a large function.  
-constexpr unsigned MaxLSLocationBBMultiplicationNone = 256*256;
+/// The transfer functions only visit the locations which are currently
+/// tracked, so the cost of the pessimistic single iteration grows with the
+/// number of live stores rather than with the number of locations in the
+/// function. This allows us to run DSE on functions with 1024 basic blocks and
+/// 1024 locations.
+constexpr unsigned MaxLSLocationBBMultiplicationNone = 1024*1024;
 
 /// we could run optimistic DSE on functions with less than 64 basic blocks
 /// and 64 locations which is a sizeable function.
@@ -695,9 +698,8 @@ void DSEContext::invalidateLSLocationBaseForGenKillSet(SILInstruction *I) {
 
 void DSEContext::invalidateLSLocationBaseForDSE(SILInstruction *I) {
   BlockState *S = getBlockState(I);
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->BBWriteSetMid.test(i))
-      continue;
+  for (int i = S->BBWriteSetMid.find_first(); i != -1;
+       i = S->BBWriteSetMid.find_next(i)) {
     if (LocationVault[i].getBase() != I)
       continue;
     S->stopTrackingLocation(S->BBWriteSetMid, i);
@@ -727,9 +729,8 @@ void DSEContext::processReadForDSE(BlockState *S, unsigned bit) {
   // Remove any may/must-aliasing stores to the LSLocation, as they cant be
   // used to kill any upward visible stores due to the interfering load.
   LSLocation &R = LocationVault[bit];
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-      continue;
+  for (int i = S->BBWriteSetMid.find_first(); i != -1;
+       i = S->BBWriteSetMid.find_next(i)) {
     LSLocation &L = LocationVault[i];
     if (!L.isMayAliasLSLocation(R, AA))
       continue;
@@ -744,9 +745,8 @@ void DSEContext::processReadForGenKillSet(BlockState *S, unsigned bit) {
   // Even though, LSLocations are canonicalized, we still need to consult
   // alias analysis to determine whether 2 LSLocations are disjointed.
   LSLocation &R = LocationVault[bit];
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->BBMaxStoreSet.test(i))
-      continue;
+  for (int i = S->BBMaxStoreSet.find_first(); i != -1;
+       i = S->BBMaxStoreSet.find_next(i)) {
     // Do nothing if the read location NoAlias with the current location.
     LSLocation &L = LocationVault[i];
     if (!L.isMayAliasLSLocation(R, AA))
@@ -817,9 +817,8 @@ bool DSEContext::processWriteForDSE(BlockState *S, unsigned bit) {
   // If a tracked store must aliases with this store, then this store is dead.
   bool StoreDead = false;
   LSLocation &R = LocationVault[bit];
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-      continue;
+  for (int i = S->BBWriteSetMid.find_first(); i != -1;
+       i = S->BBWriteSetMid.find_next(i)) {
     // If 2 locations may alias, we can still keep both stores.
     LSLocation &L = LocationVault[i];
     if (!L.isMustAliasLSLocation(R, AA))
@@ -978,9 +977,8 @@ void DSEContext::processStoreInst(SILInstruction *I, DSEKind Kind) {
 void DSEContext::processDebugValueAddrInstForGenKillSet(SILInstruction *I) {
   BlockState *S = getBlockState(I);
   SILValue Mem = cast<DebugValueAddrInst>(I)->getOperand();
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->BBMaxStoreSet.test(i))
-      continue;
+  for (int i = S->BBMaxStoreSet.find_first(); i != -1;
+       i = S->BBMaxStoreSet.find_next(i)) {
     if (AA->isNoAlias(Mem, LocationVault[i].getBase()))
       continue;
     S->stopTrackingLocation(S->BBGenSet, i);
@@ -991,9 +989,8 @@ void DSEContext::processDebugValueAddrInstForGenKillSet(SILInstruction *I) {
 void DSEContext::processDebugValueAddrInstForDSE(SILInstruction *I) {
   BlockState *S = getBlockState(I);
   SILValue Mem = cast<DebugValueAddrInst>(I)->getOperand();
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-      continue;
+  for (int i = S->BBWriteSetMid.find_first(); i != -1;
+       i = S->BBWriteSetMid.find_next(i)) {
     if (AA->isNoAlias(Mem, LocationVault[i].getBase()))
       continue;
     S->stopTrackingLocation(S->BBWriteSetMid, i);
@@ -1018,9 +1015,8 @@ void DSEContext::processDebugValueAddrInst(SILInstruction *I, DSEKind Kind) {
 
 void DSEContext::processUnknownReadInstForGenKillSet(SILInstruction *I) {
   BlockState *S = getBlockState(I);
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->BBMaxStoreSet.test(i))
-      continue;
+  for (int i = S->BBMaxStoreSet.find_first(); i != -1;
+       i = S->BBMaxStoreSet.find_next(i)) {
     if (!AA->mayReadFromMemory(I, LocationVault[i].getBase()))
       continue;
     // Update the genset and kill set.
@@ -1031,9 +1027,8 @@ void DSEContext::processUnknownReadInstForGenKillSet(SILInstruction *I) {
 
 void DSEContext::processUnknownReadInstForDSE(SILInstruction *I) {
   BlockState *S = getBlockState(I);
-  for (unsigned i = 0; i < S->LocationNum; ++i) {
-    if (!S->isTrackingLocation(S->BBWriteSetMid, i))
-      continue;
+  for (int i = S->BBWriteSetMid.find_first(); i != -1;
+       i = S->BBWriteSetMid.find_next(i)) {
     if (!AA->mayReadFromMemory(I, LocationVault[i].getBase()))
       continue;
     S->stopTrackingLocation(S->BBWriteSetMid, i);
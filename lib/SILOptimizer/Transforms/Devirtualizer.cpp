@@ -21,6 +21,7 @@
 #include "swift/SIL/SILInstruction.h"
 #include "swift/SILOptimizer/Analysis/ClassHierarchyAnalysis.h"
 #include "swift/SILOptimizer/Utils/Devirtualize.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "llvm/ADT/SmallVector.h"
 
@@ -49,6 +50,21 @@ class Devirtualizer : public SILFunctionTransform {
 
 } // end anonymous namespace
 
+/// Record why the dynamic call \p Apply could not be devirtualized.
+static void emitMissedRemark(FullApplySite Apply) {
+  SILValue Callee = Apply.getCallee();
+  StringRef Reason;
+  if (isa<WitnessMethodInst>(Callee))
+    Reason = "UnknownConformance";
+  else if (isa<ClassMethodInst>(Callee))
+    Reason = "UnknownDynamicType";
+  else if (isa<SuperMethodInst>(Callee))
+    Reason = "NoSuperclassImplementation";
+  else
+    return;
+  OptRemark::missed(DEBUG_TYPE, Reason, Apply.getInstruction()).emit();
+}
+
 bool Devirtualizer::devirtualizeAppliesInFunction(SILFunction &F,
                                                   ClassHierarchyAnalysis *CHA) {
   bool Changed = false;
@@ -66,8 +82,16 @@ bool Devirtualizer::devirtualizeAppliesInFunction(SILFunction &F,
         continue;
 
       auto NewInstPair = tryDevirtualizeApply(Apply, CHA);
-      if (!NewInstPair.second)
+      if (!NewInstPair.second) {
+        if (OptRemark::isEnabled(F.getModule()))
+          emitMissedRemark(Apply);
         continue;
+      }
+
+      if (OptRemark::isEnabled(F.getModule()))
+        OptRemark::passed(DEBUG_TYPE, "Devirtualized", Apply.getInstruction())
+          .arg("Callee", NewInstPair.second.getCalleeFunction()->getName())
+          .emit();
 
       Changed = true;
 
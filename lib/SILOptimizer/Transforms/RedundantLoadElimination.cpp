@@ -165,9 +165,12 @@ namespace {
 /// behavior or alias query we need to do in worst case is roughly linear to
 /// # of BBs x(times) # of locations.
 ///
-/// we could run RLE on functions with 128 basic blocks and 128 locations,
-/// which is a large function.  
-constexpr unsigned MaxLSLocationBBMultiplicationNone = 128*128;
+/// The transfer functions only visit the locations which are currently
+/// tracked, so the cost of the pessimistic single iteration grows with the
+/// number of live locations rather than with the number of locations in the
+/// function. This allows us to run RLE on functions with 1024 basic blocks and
+/// 1024 locations.
+constexpr unsigned MaxLSLocationBBMultiplicationNone = 1024*1024;
 
 /// we could run optimistic RLE on functions with less than 64 basic blocks
 /// and 64 locations which is a sizeable function.
@@ -578,24 +581,25 @@ void BlockState::mergePredecessorAvailSetAndValue(RLEContext &Ctx) {
   ForwardSetIn = Ctx.getBlockState(*Iter).ForwardSetOut;
   ForwardValIn = Ctx.getBlockState(*Iter).ForwardValOut;
   Iter = std::next(Iter);
-  for (auto EndIter = BB->pred_end(); Iter != EndIter; ++Iter) {
-    BlockState &OtherState = Ctx.getBlockState(*Iter);
-    ForwardSetIn &= OtherState.ForwardSetOut;
-
-    // Merge in the predecessor state.
-    for (unsigned i = 0; i < LocationNum; ++i) {
-      if (OtherState.ForwardSetOut[i]) {
-        // There are multiple values from multiple predecessors, set this as
-        // a covering value. We do not need to track the value itself, as we
-        // can always go to the predecessors BlockState to find it.
-        ForwardValIn[i] = Ctx.getValueBit(LSValue(true));
-        continue;
-      }
-      // If this location does have an available value, then clear it.
-      stopTrackingValue(ForwardValIn, i);
-      stopTrackingLocation(ForwardSetIn, i);
-    }
-  }
+  if (Iter == BB->pred_end())
+    return;
+
+  for (auto EndIter = BB->pred_end(); Iter != EndIter; ++Iter)
+    ForwardSetIn &= Ctx.getBlockState(*Iter).ForwardSetOut;
+
+  // There are multiple values from multiple predecessors for every location
+  // which is still available, set them as covering values. We do not need to
+  // track the values themselves, as we can always go to the predecessors
+  // BlockState to find them.
+  //
+  // Only visit the available locations, so that merging does not become
+  // proportional to the number of locations in the function.
+  ValueTableMap MergedValIn;
+  unsigned CoveringValue = Ctx.getValueBit(LSValue(true));
+  for (int i = ForwardSetIn.find_first(); i != -1;
+       i = ForwardSetIn.find_next(i))
+    MergedValIn[i] = CoveringValue;
+  ForwardValIn = std::move(MergedValIn);
 }
 
 void BlockState::processBasicBlockWithKind(RLEContext &Ctx, RLEKind Kind) {
@@ -705,9 +709,8 @@ void BlockState::updateGenKillSetForWrite(RLEContext &Ctx, unsigned B) {
   // This is a store, invalidate any location that this location may alias, as
   // their values can no longer be forwarded.
   LSLocation &R = Ctx.getLocation(B);
-  for (unsigned i = 0; i < LocationNum; ++i) {
-    if (!isTrackingLocation(ForwardSetMax, i))
-      continue;
+  for (int i = ForwardSetMax.find_first(); i != -1;
+       i = ForwardSetMax.find_next(i)) {
     LSLocation &L = Ctx.getLocation(i);
     if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
       continue;
@@ -733,9 +736,8 @@ void BlockState::updateForwardSetForWrite(RLEContext &Ctx, unsigned B) {
   // This is a store, invalidate any location that this location may alias, as
   // their values can no longer be forwarded.
   LSLocation &R = Ctx.getLocation(B);
-  for (unsigned i = 0; i < LocationNum; ++i) {
-    if (!isTrackingLocation(ForwardSetIn, i))
-      continue;
+  for (int i = ForwardSetIn.find_first(); i != -1;
+       i = ForwardSetIn.find_next(i)) {
     LSLocation &L = Ctx.getLocation(i);
     if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
       continue;
@@ -752,9 +754,8 @@ void BlockState::updateForwardSetAndValForWrite(RLEContext &Ctx, unsigned L,
   // This is a store, invalidate any location that this location may alias, as
   // their values can no longer be forwarded.
   LSLocation &R = Ctx.getLocation(L);
-  for (unsigned i = 0; i < LocationNum; ++i) {
-    if (!isTrackingLocation(ForwardSetIn, i))
-      continue;
+  for (int i = ForwardSetIn.find_first(); i != -1;
+       i = ForwardSetIn.find_next(i)) {
     LSLocation &L = Ctx.getLocation(i);
     if (!L.isMayAliasLSLocation(R, Ctx.getAA()))
       continue;
@@ -898,9 +899,8 @@ void BlockState::processLoadInst(RLEContext &Ctx, LoadInst *LI, RLEKind Kind) {
 void BlockState::processUnknownWriteInstForGenKillSet(RLEContext &Ctx,
                                                       SILInstruction *I) {
   auto *AA = Ctx.getAA();
-  for (unsigned i = 0; i < LocationNum; ++i) {
-    if (!isTrackingLocation(ForwardSetMax, i))
-      continue;
+  for (int i = ForwardSetMax.find_first(); i != -1;
+       i = ForwardSetMax.find_next(i)) {
     // Invalidate any location this instruction may write to.
     //
     // TODO: checking may alias with Base is overly conservative,
@@ -917,9 +917,8 @@ void BlockState::processUnknownWriteInstForGenKillSet(RLEContext &Ctx,
 void BlockState::processUnknownWriteInstForRLE(RLEContext &Ctx,
                                                SILInstruction *I) {
   auto *AA = Ctx.getAA();
-  for (unsigned i = 0; i < LocationNum; ++i) {
-    if (!isTrackingLocation(ForwardSetIn, i))
-      continue;
+  for (int i = ForwardSetIn.find_first(); i != -1;
+       i = ForwardSetIn.find_next(i)) {
     // Invalidate any location this instruction may write to.
     //
     // TODO: checking may alias with Base is overly conservative,
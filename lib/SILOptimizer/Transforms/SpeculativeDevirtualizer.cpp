@@ -25,11 +25,14 @@
 #include "swift/SIL/SILModule.h"
 #include "swift/SIL/InstructionUtils.h"
 #include "swift/SILOptimizer/Analysis/ClassHierarchyAnalysis.h"
+#include "swift/SILOptimizer/Analysis/ColdBlockInfo.h"
+#include "swift/SILOptimizer/Analysis/DominanceAnalysis.h"
 #include "swift/SILOptimizer/Utils/Generics.h"
 #include "swift/SILOptimizer/PassManager/Passes.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "swift/SILOptimizer/Utils/Devirtualize.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
 #include "swift/SILOptimizer/Utils/SILInliner.h"
 #include "swift/AST/ASTContext.h"
 #include "llvm/ADT/MapVector.h"
@@ -304,11 +307,16 @@ static bool isDefaultCaseKnown(ClassHierarchyAnalysis *CHA,
 static bool tryToSpeculateTarget(FullApplySite AI,
                                  ClassHierarchyAnalysis *CHA) {
   ClassMethodInst *CMI = cast<ClassMethodInst>(AI.getCallee());
+  bool EmitRemarks = OptRemark::isEnabled(AI.getModule());
 
   // We cannot devirtualize in cases where dynamic calls are
   // semantically required.
-  if (CMI->isVolatile())
+  if (CMI->isVolatile()) {
+    if (EmitRemarks)
+      OptRemark::missed(DEBUG_TYPE, "DynamicDispatchRequired",
+                        AI.getInstruction()).emit();
     return false;
+  }
 
   // Strip any upcasts off of our 'self' value, potentially leaving us
   // with a value whose type is closer (in the class hierarchy) to the
@@ -319,8 +327,12 @@ static bool tryToSpeculateTarget(FullApplySite AI,
   // Bail if any generic types parameters of the class instance type are
   // unbound.
   // We cannot devirtualize unbound generic calls yet.
-  if (isNominalTypeWithUnboundGenericParameters(SubType, AI.getModule()))
+  if (isNominalTypeWithUnboundGenericParameters(SubType, AI.getModule())) {
+    if (EmitRemarks)
+      OptRemark::missed(DEBUG_TYPE, "UnboundGenericClass",
+                        AI.getInstruction()).emit();
     return false;
+  }
 
   auto &M = CMI->getModule();
   auto ClassType = SubType;
@@ -337,6 +349,10 @@ static bool tryToSpeculateTarget(FullApplySite AI,
     // try to devirtualize it completely.
     ClassHierarchyAnalysis::ClassList Subs;
     if (isDefaultCaseKnown(CHA, AI, CD, Subs)) {
+      if (EmitRemarks)
+        OptRemark::passed(DEBUG_TYPE, "Devirtualized", AI.getInstruction())
+          .arg("Class", CD->getName().str())
+          .emit();
       auto NewInstPair = tryDevirtualizeClassMethod(AI, SubTypeValue);
       if (NewInstPair.first)
         replaceDeadApply(AI, NewInstPair.first);
@@ -345,7 +361,13 @@ static bool tryToSpeculateTarget(FullApplySite AI,
 
     DEBUG(llvm::dbgs() << "Inserting monomorphic speculative call for class " <<
           CD->getName() << "\n");
-    return !!speculateMonomorphicTarget(AI, SubType, LastCCBI);
+    OptRemark Remark = OptRemark::passed(DEBUG_TYPE, "SpeculatedMonomorphic",
+                                         AI.getInstruction());
+    if (!speculateMonomorphicTarget(AI, SubType, LastCCBI))
+      return false;
+    if (EmitRemarks)
+      Remark.arg("Class", CD->getName().str()).emit();
+    return true;
   }
 
   // True if any instructions were changed or generated.
@@ -399,6 +421,21 @@ static bool tryToSpeculateTarget(FullApplySite AI,
   DEBUG(llvm::dbgs() << "Class " << CD->getName() << " is a superclass. "
         "Inserting polymorphic speculative call.\n");
 
+  // The remark is emitted after the transformation, when the number of
+  // handled subclasses is known.
+  OptRemark Remark = OptRemark::passed(DEBUG_TYPE, "SpeculatedPolymorphic",
+                                       AI.getInstruction());
+  auto emitRemark = [&](bool DefaultCaseDevirtualized) {
+    if (!EmitRemarks)
+      return;
+    Remark.arg("Class", CD->getName().str())
+          .arg("Subclasses", Subs.size())
+          .arg("NotHandledSubclasses", NotHandledSubsNum)
+          .arg("DefaultCaseDevirtualized",
+               DefaultCaseDevirtualized ? "true" : "false")
+          .emit();
+  };
+
   // Try to devirtualize the static class of instance
   // if it is possible.
   auto FirstAI = speculateMonomorphicTarget(AI, SubType, LastCCBI);
@@ -483,6 +520,8 @@ static bool tryToSpeculateTarget(FullApplySite AI,
     // needs to be handled here. Thus, an indirect call through
     // the class_method cannot be eliminated completely.
     //
+    if (Changed)
+      emitRemark(false);
     return Changed;
   }
 
@@ -498,12 +537,14 @@ static bool tryToSpeculateTarget(FullApplySite AI,
                                                 LastCCBI->getCastType());
     B.createBranch(LastCCBI->getLoc(), LastCCBI->getSuccessBB(), {CastedValue});
     LastCCBI->eraseFromParent();
+    emitRemark(true);
     return true;
   }
   auto NewInstPair = tryDevirtualizeClassMethod(AI, SubTypeValue);
   assert(NewInstPair.first && "Expected to be able to devirtualize apply!");
   replaceDeadApply(AI, NewInstPair.first);
 
+  emitRemark(true);
   return true;
 }
 
@@ -519,9 +560,20 @@ namespace {
 
       bool Changed = false;
 
+      // Speculation only pays off for calls which are actually executed, so
+      // skip the blocks that -profile-use data shows were never reached.
+      DominanceInfo *DT = nullptr;
+      if (getFunction()->getEntryCount())
+        DT = PM->getAnalysis<DominanceAnalysis>()->get(getFunction());
+
       // Collect virtual calls that may be specialized.
       SmallVector<FullApplySite, 16> ToSpecialize;
       for (auto &BB : *getFunction()) {
+        if (DT) {
+          auto Count = ColdBlockInfo::getProfileCount(&BB, DT);
+          if (Count && *Count == 0)
+            continue;
+        }
         for (auto II = BB.begin(), IE = BB.end(); II != IE; ++II) {
           FullApplySite AI = FullApplySite::isa(&*II);
           if (AI && isa<ClassMethodInst>(AI.getCallee()))
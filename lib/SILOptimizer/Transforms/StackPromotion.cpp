@@ -15,6 +15,7 @@
 #include "swift/SILOptimizer/PassManager/Transforms.h"
 #include "swift/SILOptimizer/Analysis/EscapeAnalysis.h"
 #include "swift/SILOptimizer/Analysis/DominanceAnalysis.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
 #include "swift/SIL/SILArgument.h"
 #include "swift/SIL/SILBuilder.h"
 #include "llvm/ADT/Statistic.h"
@@ -28,6 +29,9 @@ using namespace swift;
 /// *) alloc_ref instructions of native swift classes: if promoted, the [stack]
 ///    attribute is set in the alloc_ref and a dealloc_ref [stack] is inserted
 ///    at the end of the object's lifetime.
+///    This includes objects with tail-allocated elements, if the number of
+///    elements is a constant. IRGen computes the size of such objects from
+///    the element type and makes the final decision on stack allocation.
 /// *) Array buffers which are allocated by a call to swift_bufferAllocate: if
 ///    promoted the swift_bufferAllocate call is replaced by a call to
 ///    swift_bufferAllocateOnStack and a call to swift_bufferDeallocateFromStack
@@ -38,9 +42,8 @@ using namespace swift;
 ///    to swift_bufferAllocate in SIL are not constant because they depend on
 ///    the not-yet-evaluatable sizeof and alignof builtins. Therefore we need
 ///    LLVM's constant propagation prior to deciding on stack promotion.
-///    The solution to this problem is that we need native support for tail-
-///    allocated arrays in SIL so that we can do the array buffer allocations
-///    with alloc_ref instructions.
+///    It can be removed once the array buffers are allocated with alloc_ref
+///    instructions with tail-allocated elements.
 class StackPromoter {
 
   // Some analysis we need.
@@ -160,9 +163,14 @@ public:
 static bool isPromotableAllocInst(SILInstruction *I) {
   // Check for swift object allocation.
   if (auto *ARI = dyn_cast<AllocRefInst>(I)) {
-    if (!ARI->isObjC())
-      return true;
-    return false;
+    if (ARI->isObjC())
+      return false;
+    // IRGen can only allocate tail-allocated elements on the stack if their
+    // number is known.
+    if (ARI->hasTailAllocatedElements() &&
+        !isa<IntegerLiteralInst>(ARI->getTailAllocatedCount()))
+      return false;
+    return true;
   }
   // Check for array buffer allocation.
   auto *AI = dyn_cast<ApplyInst>(I);
@@ -198,9 +206,19 @@ StackPromoter::ChangeState StackPromoter::promote() {
 void StackPromoter::tryPromoteAlloc(SILInstruction *I) {
   SILInstruction *AllocInsertionPoint = nullptr;
   SILInstruction *DeallocInsertionPoint = nullptr;
-  if (!canPromoteAlloc(I, AllocInsertionPoint, DeallocInsertionPoint))
+  bool EmitRemarks = OptRemark::isEnabled(I->getModule());
+  if (!canPromoteAlloc(I, AllocInsertionPoint, DeallocInsertionPoint)) {
+    if (EmitRemarks) {
+      auto *Node = ConGraph->getNodeOrNull(I, EA);
+      StringRef Reason = (!Node || Node->escapes()) ? "Escapes"
+                                                    : "NoDeallocationPoint";
+      OptRemark::missed(DEBUG_TYPE, Reason, I).emit();
+    }
     return;
+  }
 
+  if (EmitRemarks)
+    OptRemark::passed(DEBUG_TYPE, "PromotedToStack", I).emit();
   DEBUG(llvm::dbgs() << "Promoted " << *I);
   DEBUG(llvm::dbgs() << "    in " << I->getFunction()->getName() << '\n');
   NumStackPromoted++;
@@ -389,11 +407,20 @@ bool StackPromoter::canPromoteAlloc(SILInstruction *AI,
           //
           // In this case we can move the alloc_ref before the alloc_stack
           // to fix the nesting.
-          if (!isa<AllocRefInst>(AI))
+          auto *ARI = dyn_cast<AllocRefInst>(AI);
+          if (!ARI)
             return false;
           auto *Alloc = dyn_cast<SILInstruction>(I.getOperand(0));
           if (!Alloc)
             return false;
+          // The number of tail-allocated elements must still be available
+          // at the new place of the alloc_ref.
+          if (ARI->hasTailAllocatedElements()) {
+            auto *Count =
+              cast<SILInstruction>(ARI->getTailAllocatedCount());
+            if (!DT->properlyDominates(Count, Alloc))
+              return false;
+          }
           // This should always be the case, but let's be on the safe side.
           if (!PDT->dominates(StartBlock, Alloc->getParent()))
             return false;
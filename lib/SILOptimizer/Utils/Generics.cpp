@@ -15,6 +15,7 @@
 #include "swift/Strings.h"
 #include "swift/SILOptimizer/Utils/Generics.h"
 #include "swift/SILOptimizer/Utils/GenericCloner.h"
+#include "swift/SILOptimizer/Utils/OptRemark.h"
 
 using namespace swift;
 
@@ -131,45 +132,85 @@ bool swift::isWhitelistedSpecialization(StringRef SpecName) {
   return false;
 }
 
+/// Returns true if the specialization of \p Orig for \p Subs can be exported
+/// by this module.
+///
+/// Only specializations of public functions, which clients can specialize in
+/// the same way, are exported, and only if all types they are specialized for
+/// are visible to clients. Specializations of functions imported from other
+/// modules are not exported, so that two modules never export the same
+/// symbol.
+///
+/// Specializations are only exported in whole-module builds. Otherwise each
+/// file of the module which needs a specialization emits it, and the public
+/// definitions would clash.
+static bool canExportSpecialization(SILFunction *Orig,
+                                    ArrayRef<Substitution> Subs) {
+  if (!Orig->getModule().isWholeModule())
+    return false;
+
+  if (Orig->isAvailableExternally() || !Orig->isFragile() ||
+      !hasPublicVisibility(Orig->getLinkage()))
+    return false;
+
+  for (auto &Sub : Subs) {
+    bool HasNonPublicType = Sub.getReplacement().findIf([](Type T) -> bool {
+      if (auto *D = T->getAnyNominal())
+        return D->getEffectiveAccess() != Accessibility::Public;
+      return false;
+    });
+    if (HasNonPublicType)
+      return false;
+  }
+  return true;
+}
+
 /// Cache a specialization.
-/// For now, it is performed only for specializations in the
-/// standard library. But in the future, one could think of
-/// maintaining a cache of optimized specializations.
 ///
-/// Mark specializations as public, so that they can be used
-/// by user applications. These specializations are supposed to be
-/// used only by -Onone compiled code. They should be never inlined.
-static bool cacheSpecialization(SILModule &M, SILFunction *F) {
+/// Whitelisted specializations in the standard library, and with
+/// -export-specializations the specializations of this module's public
+/// functions, are marked as public, so that they can be used by other
+/// modules. Specializations made public in the standard library are supposed
+/// to be used only by -Onone compiled code. They should be never inlined.
+///
+/// \p Orig is the generic function which was specialized for \p Subs,
+/// resulting in \p F.
+static bool cacheSpecialization(SILModule &M, SILFunction *Orig,
+                                ArrayRef<Substitution> Subs, SILFunction *F) {
   // Do not remove functions from the white-list. Keep them around.
   // Change their linkage to public, so that other applications can refer to it.
 
-  if (M.getOptions().Optimization >= SILOptions::SILOptMode::Optimize &&
-      F->getLinkage() != SILLinkage::Public &&
-      F->getModule().getSwiftModule()->getName().str() == STDLIB_NAME) {
-    if (F->getLinkage() != SILLinkage::Public &&
-        isWhitelistedSpecialization(F->getName())) {
+  if (M.getOptions().Optimization < SILOptions::SILOptMode::Optimize ||
+      F->getLinkage() == SILLinkage::Public)
+    return false;
 
-      DEBUG(
-        auto DemangledNameString =
-          swift::Demangle::demangleSymbolAsString(F->getName());
-        StringRef DemangledName = DemangledNameString;
-        llvm::dbgs() << "Keep specialization: " << DemangledName << " : "
-                     << F->getName() << "\n");
-      // Make it public, so that others can refer to it.
-      //
-      // NOTE: This function may refer to non-public symbols, which may lead to
-      // problems, if you ever try to inline this function. Therefore, these
-      // specializations should only be used to refer to them, but should never
-      // be inlined!  The general rule could be: Never inline specializations
-      // from stdlib!
-      //
-      // NOTE: Making these specializations public at this point breaks
-      // some optimizations. Therefore, just mark the function.
-      // DeadFunctionElimination pass will check if the function is marked
-      // and preserve it if required.
-      F->setKeepAsPublic(true);
-      return true;
-    }
+  bool IsStdlib =
+      F->getModule().getSwiftModule()->getName().str() == STDLIB_NAME;
+  if ((IsStdlib && isWhitelistedSpecialization(F->getName())) ||
+      (M.getOptions().ExportSpecializations &&
+       canExportSpecialization(Orig, Subs))) {
+
+    DEBUG(
+      auto DemangledNameString =
+        swift::Demangle::demangleSymbolAsString(F->getName());
+      StringRef DemangledName = DemangledNameString;
+      llvm::dbgs() << "Keep specialization: " << DemangledName << " : "
+                   << F->getName() << "\n");
+    // Make it public, so that others can refer to it.
+    //
+    // NOTE: This function may refer to non-public symbols, which may lead to
+    // problems, if you ever try to inline this function. Therefore, these
+    // specializations should only be used to refer to them, but should never
+    // be inlined!  The general rule could be: Never inline specializations
+    // from other modules!
+    //
+    // NOTE: Making these specializations public at this point breaks
+    // some optimizations. Therefore, just mark the function.
+    // DeadFunctionElimination pass will check if the function is marked
+    // and preserve it if required. The serializer lists marked functions in
+    // the module file, so that clients can find them.
+    F->setKeepAsPublic(true);
+    return true;
   }
   return false;
 }
@@ -177,26 +218,32 @@ static bool cacheSpecialization(SILModule &M, SILFunction *F) {
 /// Try to look up an existing specialization in the specialization cache.
 /// If it is found, it tries to link this specialization.
 ///
-/// For now, it performs a lookup only in the standard library.
-/// But in the future, one could think of maintaining a cache
-/// of optimized specializations.
+/// The cache consists of the whitelisted specializations of the standard
+/// library and of the specializations listed in the module files of imported
+/// modules which were compiled with -export-specializations.
 static SILFunction *lookupExistingSpecialization(SILModule &M,
-                                                 StringRef FunctionName) {
-  // Try to link existing specialization only in -Onone mode.
-  // All other compilation modes perform specialization themselves.
-  // TODO: Cache optimized specializations and perform lookup here?
+                                                 StringRef FunctionName,
+                                                 CanSILFunctionType FnTy) {
   // TODO: Only check that this function exists, but don't read
   // its body. It can save some compile-time.
   if (isWhitelistedSpecialization(FunctionName) &&
       M.linkFunction(FunctionName, SILOptions::LinkingMode::LinkNormal))
     return M.lookUpFunction(FunctionName);
 
+  // Exported specializations are not serialized themselves, so only create
+  // a declaration to refer to.
+  if (M.hasExportedSpecialization(FunctionName))
+    return M.getOrCreateFunction(RegularLocation::getAutoGeneratedLocation(),
+                                 FunctionName, SILLinkage::PublicExternal,
+                                 FnTy, IsBare, IsNotTransparent, IsNotFragile);
+
   return nullptr;
 }
 
 SILFunction *swift::getExistingSpecialization(SILModule &M,
-                                              StringRef FunctionName) {
-  auto *Specialization = lookupExistingSpecialization(M, FunctionName);
+                                              StringRef FunctionName,
+                                              CanSILFunctionType FnTy) {
+  auto *Specialization = lookupExistingSpecialization(M, FunctionName, FnTy);
   if (!Specialization)
     return nullptr;
   if (hasPublicVisibility(Specialization->getLinkage())) {
@@ -231,6 +278,16 @@ SILFunction *swift::getExistingSpecialization(SILModule &M,
   return Specialization;
 }
 
+/// Record that the generic callee \p F of \p Apply could not be specialized.
+static void emitMissedRemark(ApplySite Apply, SILFunction *F,
+                             StringRef Reason) {
+  if (!OptRemark::isEnabled(Apply.getModule()))
+    return;
+  OptRemark::missed(DEBUG_TYPE, Reason, Apply.getInstruction())
+    .arg("Callee", F->getName())
+    .emit();
+}
+
 ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
                                              SILFunction *&NewFunction,
                                              CloneCollector &Collector) {
@@ -244,6 +301,7 @@ ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
   if (!F->shouldOptimize()) {
     DEBUG(llvm::dbgs() << "    Cannot specialize function " << F->getName()
                        << " marked to be excluded from optimizations.\n");
+    emitMissedRemark(Apply, F, "NotOptimized");
     return ApplySite();
   }
 
@@ -265,10 +323,12 @@ ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
   // We do not support partial specialization.
   if (hasUnboundGenericTypes(InterfaceSubs)) {
     DEBUG(llvm::dbgs() << "    Cannot specialize with interface subs.\n");
+    emitMissedRemark(Apply, F, "PartialSpecialization");
     return ApplySite();
   }
   if (hasDynamicSelfTypes(InterfaceSubs)) {
     DEBUG(llvm::dbgs() << "    Cannot specialize with dynamic self.\n");
+    emitMissedRemark(Apply, F, "DynamicSelf");
     return ApplySite();
   }
 
@@ -303,6 +363,22 @@ ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
     if (M.getOptions().Optimization <= SILOptions::SILOptMode::None)
       return ApplySite();
 
+    // Prefer calling a specialization exported by another module over
+    // emitting a copy of it.
+    if (M.getOptions().ReuseSpecializations) {
+      auto FTy = F->getLoweredFunctionType()->substGenericArgs(
+          M, M.getSwiftModule(), Apply.getSubstitutions());
+      if (auto *ExistingF = getExistingSpecialization(M, ClonedName, FTy)) {
+        if (OptRemark::isEnabled(M))
+          OptRemark::passed(DEBUG_TYPE, "ReusedSpecialization",
+                            Apply.getInstruction())
+            .arg("Callee", F->getName())
+            .arg("Specialization", ClonedName)
+            .emit();
+        return replaceWithSpecializedFunction(Apply, ExistingF);
+      }
+    }
+
     DEBUG(
       if (M.getOptions().Optimization <= SILOptions::SILOptMode::Debug) {
         llvm::dbgs() << "Creating a specialization: " << ClonedName << "\n"; });
@@ -315,7 +391,12 @@ ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
     NewFunction = NewF;
 
     // Check if this specialization should be cached.
-    cacheSpecialization(M, NewF);
+    cacheSpecialization(M, F, Apply.getSubstitutions(), NewF);
   }
+  if (OptRemark::isEnabled(M))
+    OptRemark::passed(DEBUG_TYPE, "Specialized", Apply.getInstruction())
+      .arg("Callee", F->getName())
+      .arg("Specialization", ClonedName)
+      .emit();
   return replaceWithSpecializedFunction(Apply, NewF);
 }
@@ -0,0 +1,67 @@
+//===--- OptRemark.cpp - Remarks about SIL optimizations ------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/SILOptimizer/Utils/OptRemark.h"
+#include "swift/AST/ASTContext.h"
+#include "swift/Basic/SourceManager.h"
+#include "swift/SIL/SILFunction.h"
+
+using namespace swift;
+
+/// Prints \p Str as a single-quoted YAML scalar.
+static void printQuoted(llvm::raw_ostream &OS, StringRef Str) {
+  OS << '\'';
+  for (char C : Str) {
+    if (C == '\'')
+      OS << '\'';
+    OS << C;
+  }
+  OS << '\'';
+}
+
+void OptRemark::print(llvm::raw_ostream &OS) const {
+  OS << "--- !" << (K == Kind::Passed ? "Passed" : "Missed") << '\n';
+  OS << "Pass:            " << PassName << '\n';
+  OS << "Name:            " << Name << '\n';
+
+  SourceLoc SrcLoc = Loc.getSourceLoc();
+  if (SrcLoc.isValid()) {
+    SourceManager &SM = F->getModule().getASTContext().SourceMgr;
+    unsigned Line, Column;
+    std::tie(Line, Column) = SM.getLineAndColumn(SrcLoc);
+    OS << "DebugLoc:        { File: ";
+    printQuoted(OS, SM.getBufferIdentifierForLoc(SrcLoc));
+    OS << ", Line: " << Line << ", Column: " << Column << " }\n";
+  }
+
+  OS << "Function:        ";
+  printQuoted(OS, F->getName());
+  OS << '\n';
+
+  if (!Args.empty()) {
+    OS << "Args:\n";
+    for (const Argument &Arg : Args) {
+      OS << "  - " << Arg.Key << ": ";
+      if (Arg.IsString)
+        printQuoted(OS, Arg.Value);
+      else
+        OS << Arg.Value;
+      OS << '\n';
+    }
+  }
+  OS << "...\n";
+}
+
+void OptRemark::emit() const {
+  if (llvm::raw_ostream *OS = F->getModule().getOptRecordStream())
+    print(*OS);
+}
@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 #include "ConstraintSystem.h"
 #include "ConstraintGraph.h"
+#include "swift/Basic/Statistics.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SaveAndRestore.h"
@@ -418,6 +419,16 @@ ConstraintSystem::SolverState::~SolverState() {
   #define CS_STATISTIC(Name, Description) JOIN2(Overall,Name) += Name;
   #include "ConstraintSolverStats.def"
 
+  // LLVM statistics are compiled out of release builds, so report them to
+  // -stats-output-dir separately.
+  if (CompilerStatistics *stats = CS.getASTContext().Stats) {
+    stats->add("Sema.NumConstraintSystems", 1);
+    #define CS_STATISTIC(Name, Description) \
+      stats->add("Sema." #Name, Name); \
+      stats->max("Sema.Largest" #Name, Name);
+    #include "ConstraintSolverStats.def"
+  }
+
   // Update the "largest" statistics if this system is larger than the
   // previous one.  
   // FIXME: This is not at all thread-safe.
@@ -97,6 +97,51 @@ public:
   }
 };
 
+/// Used to deserialize entries in the on-disk function summary hash table.
+class SILDeserializer::FuncSummaryTableInfo {
+public:
+  using internal_key_type = StringRef;
+  using external_key_type = StringRef;
+  using data_type = SILFunctionSummary;
+  using hash_value_type = uint32_t;
+  using offset_type = unsigned;
+
+  internal_key_type GetInternalKey(external_key_type ID) { return ID; }
+
+  external_key_type GetExternalKey(internal_key_type ID) { return ID; }
+
+  hash_value_type ComputeHash(internal_key_type key) {
+    return llvm::HashString(key);
+  }
+
+  static bool EqualKey(internal_key_type lhs, internal_key_type rhs) {
+    return lhs == rhs;
+  }
+
+  static std::pair<unsigned, unsigned> ReadKeyDataLength(const uint8_t *&data) {
+    unsigned keyLength = endian::readNext<uint16_t, little, unaligned>(data);
+    unsigned dataLength = endian::readNext<uint16_t, little, unaligned>(data);
+    return { keyLength, dataLength };
+  }
+
+  static internal_key_type ReadKey(const uint8_t *data, unsigned length) {
+    return StringRef(reinterpret_cast<const char *>(data), length);
+  }
+
+  static data_type ReadData(internal_key_type key, const uint8_t *data,
+                            unsigned length) {
+    assert(length >= 2 && "Expect the global effects and flags.");
+    data_type result;
+    result.setGlobalEffects(*data++);
+    result.setFlags(*data++);
+    for (unsigned i = 2; i < length; ++i) {
+      uint8_t param = *data++;
+      result.addParameter(param & 0xf, param >> 4);
+    }
+    return result;
+  }
+};
+
 SILDeserializer::SILDeserializer(ModuleFile *MF, SILModule &M,
                                  SerializedSILLoader::Callback *callback)
     : MF(MF), SILMod(M), Callback(callback) {
@@ -112,10 +157,11 @@ SILDeserializer::SILDeserializer(ModuleFile *MF, SILModule &M,
 
   llvm::BitstreamCursor cursor = SILIndexCursor;
   // We expect SIL_FUNC_NAMES first, then SIL_VTABLE_NAMES, then
-  // SIL_GLOBALVAR_NAMES, and SIL_WITNESSTABLE_NAMES. But each one can be
-  // omitted if no entries exist in the module file.
+  // SIL_GLOBALVAR_NAMES, SIL_WITNESSTABLE_NAMES, SIL_FUNC_SUMMARIES, and
+  // SIL_SPECIALIZATION_NAMES. But each one can be omitted if no entries exist
+  // in the module file.
   unsigned kind = 0;
-  while (kind != sil_index_block::SIL_WITNESSTABLE_NAMES) {
+  for (;;) {
     auto next = cursor.advance();
     if (next.Kind == llvm::BitstreamEntry::EndBlock)
       return;
@@ -124,6 +170,24 @@ SILDeserializer::SILDeserializer(ModuleFile *MF, SILModule &M,
     StringRef blobData;
     unsigned prevKind = kind;
     kind = cursor.readRecord(next.ID, scratch, &blobData);
+
+    // The function summaries and the specialization names are not followed by
+    // an offsets record.
+    if (next.Kind == llvm::BitstreamEntry::Record &&
+        kind == sil_index_block::SIL_FUNC_SUMMARIES) {
+      uint32_t tableOffset;
+      sil_index_block::ListLayout::readRecord(scratch, tableOffset);
+      auto base = reinterpret_cast<const uint8_t *>(blobData.data());
+      FuncSummaryTable.reset(SerializedFuncSummaryTable::Create(
+          base + tableOffset, base + sizeof(uint32_t), base));
+      continue;
+    }
+    if (next.Kind == llvm::BitstreamEntry::Record &&
+        kind == sil_index_block::SIL_SPECIALIZATION_NAMES) {
+      SpecializationList = readFuncTable(scratch, blobData);
+      continue;
+    }
+
     assert((next.Kind == llvm::BitstreamEntry::Record &&
             kind > prevKind &&
             (kind == sil_index_block::SIL_FUNC_NAMES ||
@@ -764,6 +828,7 @@ bool SILDeserializer::readSILInstruction(SILFunction *Fn, SILBasicBlock *BB,
   ONEOPERAND_ONETYPE_INST(BridgeObjectToRef)
   ONEOPERAND_ONETYPE_INST(BridgeObjectToWord)
   ONEOPERAND_ONETYPE_INST(Upcast)
+  ONEOPERAND_ONETYPE_INST(RefTailAddr)
   ONEOPERAND_ONETYPE_INST(AddressToPointer)
   ONEOPERAND_ONETYPE_INST(PointerToAddress)
   ONEOPERAND_ONETYPE_INST(RefToRawPointer)
@@ -865,10 +930,22 @@ bool SILDeserializer::readSILInstruction(SILFunction *Fn, SILBasicBlock *BB,
            "Layout should be OneTypeValues.");
     assert(ListOfValues.size() >= 1 && "Not enough values");
     unsigned Value = ListOfValues[0];
-    ResultVal = Builder.createAllocRef(
-                  Loc,
-                  getSILType(MF->getType(TyID), (SILValueCategory)TyCategory),
-                  (bool)(Value & 1), (bool)((Value >> 1) & 1));
+    SILType ClassTy =
+      getSILType(MF->getType(TyID), (SILValueCategory)TyCategory);
+    if (ListOfValues.size() > 1) {
+      assert(ListOfValues.size() == 6 && "Wrong number of values");
+      SILType TailTy = getSILType(MF->getType(ListOfValues[1]),
+                                  (SILValueCategory)ListOfValues[2]);
+      SILValue Count = getLocalValue(ListOfValues[3],
+                                     getSILType(MF->getType(ListOfValues[4]),
+                                           (SILValueCategory)ListOfValues[5]));
+      ResultVal = Builder.createAllocRef(Loc, ClassTy, (bool)(Value & 1),
+                                         (bool)((Value >> 1) & 1),
+                                         TailTy, Count);
+    } else {
+      ResultVal = Builder.createAllocRef(Loc, ClassTy, (bool)(Value & 1),
+                                         (bool)((Value >> 1) & 1));
+    }
     break;
   }
   case ValueKind::AllocRefDynamicInst: {
@@ -2121,6 +2198,36 @@ SILDeserializer::lookupWitnessTable(SILWitnessTable *existingWt) {
   return Wt;
 }
 
+Optional<SILFunctionSummary>
+SILDeserializer::lookupFunctionSummary(StringRef Name) {
+  if (!FuncSummaryTable)
+    return None;
+  auto iter = FuncSummaryTable->find(Name);
+  if (iter == FuncSummaryTable->end())
+    return None;
+  return *iter;
+}
+
+bool SILDeserializer::hasSpecialization(StringRef Name) {
+  if (!SpecializationList)
+    return false;
+  return SpecializationList->find(Name) != SpecializationList->end();
+}
+
+void SILDeserializer::getAllFunctionSummaries() {
+  if (!FuncSummaryTable)
+    return;
+  for (auto Name : FuncSummaryTable->keys())
+    SILMod.setFunctionSummary(Name, *FuncSummaryTable->find(Name));
+}
+
+void SILDeserializer::getAllSpecializationNames() {
+  if (!SpecializationList)
+    return;
+  for (auto Name : SpecializationList->keys())
+    SILMod.addExportedSpecializationName(Name);
+}
+
 SILDeserializer::~SILDeserializer() {
   // Drop our references to anything we've deserialized.
   for (auto &fnEntry : Funcs) {
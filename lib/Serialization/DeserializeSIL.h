@@ -49,6 +49,15 @@ namespace swift {
     std::vector<ModuleFile::PartiallySerialized<SILWitnessTable *>>
     WitnessTables;
 
+    class FuncSummaryTableInfo;
+    using SerializedFuncSummaryTable =
+      llvm::OnDiskIterableChainedHashTable<FuncSummaryTableInfo>;
+
+    std::unique_ptr<SerializedFuncSummaryTable> FuncSummaryTable;
+
+    /// The names of the specializations exported by the module.
+    std::unique_ptr<SerializedFuncTable> SpecializationList;
+
     /// A declaration will only
     llvm::DenseMap<NormalProtocolConformance *, SILWitnessTable *>
     ConformanceToWitnessTableMap;
@@ -112,6 +121,8 @@ public:
     SILFunction *lookupSILFunction(StringRef Name);
     SILVTable *lookupVTable(Identifier Name);
     SILWitnessTable *lookupWitnessTable(SILWitnessTable *wt);
+    Optional<SILFunctionSummary> lookupFunctionSummary(StringRef Name);
+    bool hasSpecialization(StringRef Name);
 
     /// Invalidate all cached SILFunctions.
     void invalidateFunctionCache();
@@ -140,6 +151,14 @@ public:
     /// Deserialize all WitnessTables inside the module and add them to SILMod.
     void getAllWitnessTables();
 
+    /// Add the summaries of all functions of the module to SILMod, so that
+    /// they are serialized again if SILMod is.
+    void getAllFunctionSummaries();
+
+    /// Add the names of the specializations exported by the module to SILMod,
+    /// so that they are listed again if SILMod is serialized.
+    void getAllSpecializationNames();
+
     SILDeserializer(ModuleFile *MF, SILModule &M,
                     SerializedSILLoader::Callback *callback);
 
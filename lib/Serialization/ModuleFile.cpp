@@ -197,6 +197,9 @@ validateControlBlock(llvm::BitstreamCursor &cursor,
     case control_block::TARGET:
       result.targetTriple = blobData;
       break;
+    case control_block::INTERFACE_HASH:
+      result.interfaceHash = blobData;
+      break;
     default:
       // Unknown metadata record, possibly for use by a future version of the
       // module format.
@@ -779,6 +782,7 @@ ModuleFile::ModuleFile(
       }
       Name = info.name;
       TargetTriple = info.targetTriple;
+      InterfaceHash = info.interfaceHash;
 
       hasValidControlBlock = true;
       break;
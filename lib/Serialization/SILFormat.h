@@ -92,7 +92,9 @@ namespace sil_index_block {
     SIL_GLOBALVAR_NAMES,
     SIL_GLOBALVAR_OFFSETS,
     SIL_WITNESSTABLE_NAMES,
-    SIL_WITNESSTABLE_OFFSETS
+    SIL_WITNESSTABLE_OFFSETS,
+    SIL_FUNC_SUMMARIES,
+    SIL_SPECIALIZATION_NAMES
   };
 
   using ListLayout = BCGenericRecordLayout<
@@ -13,6 +13,7 @@
 #include "Serialization.h"
 #include "SILFormat.h"
 #include "swift/AST/AST.h"
+#include "swift/AST/ASTPrinter.h"
 #include "swift/AST/ASTWalker.h"
 #include "swift/AST/DiagnosticsCommon.h"
 #include "swift/AST/ForeignErrorConvention.h"
@@ -28,7 +29,9 @@
 #include "swift/Basic/Timer.h"
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/ClangImporter/ClangModule.h"
+#include "swift/SIL/SILModule.h"
 #include "swift/Serialization/SerializationOptions.h"
+#include "swift/Serialization/SerializedModuleLoader.h"
 
 #include "clang/Basic/Module.h"
 // FIXME: We're just using CompilerInstance::createOutputFile.
@@ -43,6 +46,7 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
@@ -423,6 +427,7 @@ void Serializer::writeBlockInfoBlock() {
   BLOCK_RECORD(control_block, METADATA);
   BLOCK_RECORD(control_block, MODULE_NAME);
   BLOCK_RECORD(control_block, TARGET);
+  BLOCK_RECORD(control_block, INTERFACE_HASH);
 
   BLOCK(OPTIONS_BLOCK);
   BLOCK_RECORD(options_block, SDK_PATH);
@@ -520,6 +525,8 @@ void Serializer::writeBlockInfoBlock() {
   BLOCK_RECORD(sil_index_block, SIL_GLOBALVAR_OFFSETS);
   BLOCK_RECORD(sil_index_block, SIL_WITNESSTABLE_NAMES);
   BLOCK_RECORD(sil_index_block, SIL_WITNESSTABLE_OFFSETS);
+  BLOCK_RECORD(sil_index_block, SIL_FUNC_SUMMARIES);
+  BLOCK_RECORD(sil_index_block, SIL_SPECIALIZATION_NAMES);
 
 #undef BLOCK
 #undef BLOCK_RECORD
@@ -547,7 +554,183 @@ void Serializer::writeDocBlockInfoBlock() {
 #undef BLOCK_RECORD
 }
 
-void Serializer::writeHeader(const SerializationOptions &options) {
+namespace {
+  /// An output stream which calculates the MD5 hash of the streamed data.
+  class MD5Stream : public raw_ostream {
+    uint64_t Pos = 0;
+    llvm::MD5 Hash;
+
+    void write_impl(const char *ptr, size_t size) override {
+      Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(ptr),
+                                    size));
+      Pos += size;
+    }
+
+    uint64_t current_pos() const override { return Pos; }
+
+  public:
+    /// Returns the hash of everything written so far, as hex digits.
+    std::string finalize() {
+      flush();
+      llvm::MD5::MD5Result result;
+      Hash.final(result);
+      SmallString<32> str;
+      llvm::MD5::stringifyResult(result, str);
+      return str.str();
+    }
+  };
+}
+
+/// Hashes the parts of the layout of \p D and its nested types that clients
+/// depend on but that are not printed as part of its interface: private
+/// stored properties, and (for classes) private members, which still take up
+/// vtable slots.
+static void hashLayout(const Decl *D, PrintOptions &options, raw_ostream &os) {
+  if (isa<ExtensionDecl>(D)) {
+    for (auto member : cast<ExtensionDecl>(D)->getMembers())
+      if (isa<NominalTypeDecl>(member))
+        hashLayout(member, options, os);
+    return;
+  }
+
+  auto nominal = dyn_cast<NominalTypeDecl>(D);
+  if (!nominal || !shouldPrint(nominal, options))
+    return;
+
+  os << nominal->getName() << " {\n";
+  for (auto member : nominal->getMembers()) {
+    if (isa<NominalTypeDecl>(member)) {
+      hashLayout(member, options, os);
+      continue;
+    }
+
+    auto value = dyn_cast<ValueDecl>(member);
+    if (!value || !value->hasInterfaceType() || shouldPrint(value, options))
+      continue;
+
+    auto var = dyn_cast<VarDecl>(value);
+    if (isa<ClassDecl>(nominal) ||
+        (var && var->hasStorage() && !var->isStatic())) {
+      os << Decl::getKindName(value->getKind()) << ' '
+         << value->getFullName() << " : "
+         << value->getInterfaceType()->getCanonicalType() << '\n';
+    }
+  }
+  os << "}\n";
+}
+
+/// Hashes the modules that \p M re-exports, since clients see their
+/// declarations as well.
+///
+/// The interface hashes of re-exported Swift modules are included, so that
+/// changes to them propagate to clients of \p M. Clang modules are only hashed
+/// by name; clients depend on their headers directly.
+///
+/// Returns false if a re-exported Swift module has no interface hash, in which
+/// case \p M can't have one either.
+static bool hashExportedModules(const Module *M, raw_ostream &os) {
+  SmallVector<Module::ImportedModule, 8> exported;
+  M->getImportedModules(exported, Module::ImportFilter::Public);
+  for (auto &import : exported) {
+    os << "@_exported import " << import.second->getName();
+    for (auto &element : import.first)
+      os << '.' << element.first;
+    os << '\n';
+
+    for (const FileUnit *file : import.second->getFiles()) {
+      auto serialized = dyn_cast<SerializedASTFile>(file);
+      if (!serialized)
+        continue;
+      StringRef hash = serialized->getInterfaceHash();
+      if (hash.empty())
+        return false;
+      os << hash << '\n';
+    }
+  }
+  return true;
+}
+
+/// Hashes the side-effect and escape summaries of the public functions of
+/// \p SILMod, which clients use to optimize calls to these functions.
+static void hashFunctionSummaries(const SILModule *SILMod, raw_ostream &os) {
+  auto &summaries = SILMod->getFunctionSummaries();
+  std::vector<StringRef> names;
+  for (auto &entry : summaries)
+    names.push_back(entry.getKey());
+  std::sort(names.begin(), names.end());
+
+  for (StringRef name : names) {
+    const SILFunctionSummary &summary = summaries.find(name)->second;
+    os << "summary " << name << ' ' << summary.getGlobalEffects() << ' '
+       << summary.getFlags();
+    for (unsigned i = 0, e = summary.getNumParameters(); i != e; ++i) {
+      os << ' ' << summary.getParameterEffects(i) << ':'
+         << summary.getNoEscapeDepth(i);
+    }
+    os << '\n';
+  }
+}
+
+/// Computes a hash of everything in \p M that clients compiled against the
+/// module can depend on: the printed interface of its public (or, for
+/// testable modules, internal) declarations, the layout of its types, the
+/// modules it re-exports, the SIL of the functions that are serialized for
+/// inlining, the summaries of its public functions, and the specializations it
+/// exports.
+///
+/// Changes to private declarations and to the bodies of other functions do
+/// not change the hash, unless they change a function summary.
+///
+/// Returns an empty string if no hash can be computed.
+static std::string computeInterfaceHash(const Module *M,
+                                        const SILModule *SILMod,
+                                        bool serializeAllSIL) {
+  PrintOptions options = M->isTestingEnabled()
+                           ? PrintOptions::printTestableInterface()
+                           : PrintOptions::printInterface();
+  options.VarInitializers = false;
+  options.PrintDocumentationComments = false;
+  options.PrintRegularClangComments = false;
+  options.SkipEmptyExtensionDecls = true;
+
+  MD5Stream hashStream;
+  StreamPrinter printer(hashStream);
+
+  SmallVector<Decl *, 32> topLevelDecls;
+  M->getTopLevelDecls(topLevelDecls);
+  for (auto D : topLevelDecls) {
+    // Exported imports are handled below.
+    if (isa<ImportDecl>(D))
+      continue;
+    if (D->print(printer, options))
+      hashStream << '\n';
+    hashLayout(D, options, hashStream);
+  }
+
+  if (!hashExportedModules(M, hashStream))
+    return std::string();
+
+  if (SILMod) {
+    for (const SILFunction &F : *SILMod) {
+      if (F.isExternalDeclaration())
+        continue;
+      if (!F.isFragile() && !serializeAllSIL)
+        continue;
+      F.print(hashStream);
+    }
+    hashFunctionSummaries(SILMod, hashStream);
+
+    // Clients link against the exported specializations instead of creating
+    // their own.
+    for (StringRef name : SILMod->getExportedSpecializationNames())
+      hashStream << "specialization " << name << '\n';
+  }
+
+  return hashStream.finalize();
+}
+
+void Serializer::writeHeader(const SerializationOptions &options,
+                             StringRef interfaceHash) {
   {
     BCBlockRAII restoreBlock(Out, CONTROL_BLOCK_ID, 3);
     control_block::ModuleNameLayout ModuleName(Out);
@@ -568,6 +751,11 @@ void Serializer::writeHeader(const SerializationOptions &options) {
 
     Target.emit(ScratchRecord, M->getASTContext().LangOpts.Target.str());
 
+    if (!interfaceHash.empty()) {
+      control_block::InterfaceHashLayout InterfaceHash(Out);
+      InterfaceHash.emit(ScratchRecord, interfaceHash);
+    }
+
     {
       llvm::BCBlockRAII restoreBlock(Out, OPTIONS_BLOCK_ID, 3);
 
@@ -3873,9 +4061,17 @@ void Serializer::writeToStream(raw_ostream &os, ModuleOrSourceFile DC,
   // FIXME: This is only really needed for debugging. We don't actually use it.
   S.writeBlockInfoBlock();
 
+  // Partial modules and SIB files are never imported by other modules' jobs,
+  // so don't bother computing their interface hash.
+  std::string interfaceHash;
+  if (!S.SF && !options.IsSIB) {
+    SharedTimer timer("Computing interface hash");
+    interfaceHash = computeInterfaceHash(S.M, SILMod, options.SerializeAllSIL);
+  }
+
   {
     BCBlockRAII moduleBlock(S.Out, MODULE_BLOCK_ID, 2);
-    S.writeHeader(options);
+    S.writeHeader(options, interfaceHash);
     S.writeInputBlock(options);
     S.writeSIL(SILMod, options.SerializeAllSIL);
     S.writeAST(DC);
@@ -226,7 +226,11 @@ private:
 
   /// Writes the Swift module file header and name, plus metadata determining
   /// if the module can be loaded.
-  void writeHeader(const SerializationOptions &options = {});
+  ///
+  /// \param interfaceHash If not empty, a hash of the module's interface for
+  /// use by build systems. \see validateSerializedAST
+  void writeHeader(const SerializationOptions &options = {},
+                   StringRef interfaceHash = {});
 
   /// Writes the Swift doc module file header and name.
   void writeDocHeader();
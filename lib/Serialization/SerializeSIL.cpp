@@ -106,6 +106,49 @@ namespace {
     }
   };
 
+  /// Used to serialize the on-disk function summary hash table.
+  class FuncSummaryTableInfo {
+  public:
+    using key_type = StringRef;
+    using key_type_ref = key_type;
+    using data_type = const SILFunctionSummary *;
+    using data_type_ref = data_type;
+    using hash_value_type = uint32_t;
+    using offset_type = unsigned;
+
+    hash_value_type ComputeHash(key_type_ref key) {
+      assert(!key.empty());
+      return llvm::HashString(key);
+    }
+
+    std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                    key_type_ref key,
+                                                    data_type_ref data) {
+      uint32_t keyLength = key.size();
+      // The global effects and flags, followed by one byte per parameter.
+      uint32_t dataLength = 2 + data->getNumParameters();
+      endian::Writer<little> writer(out);
+      writer.write<uint16_t>(keyLength);
+      writer.write<uint16_t>(dataLength);
+      return { keyLength, dataLength };
+    }
+
+    void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+      out << key;
+    }
+
+    void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                  unsigned len) {
+      endian::Writer<little> writer(out);
+      writer.write<uint8_t>(data->getGlobalEffects());
+      writer.write<uint8_t>(data->getFlags());
+      for (unsigned i = 0, e = data->getNumParameters(); i != e; ++i) {
+        writer.write<uint8_t>(data->getParameterEffects(i) |
+                              (data->getNoEscapeDepth(i) << 4));
+      }
+    }
+  };
+
   class SILSerializer {
     Serializer &S;
     ASTContext &Ctx;
@@ -149,6 +192,10 @@ namespace {
     std::vector<BitOffset> WitnessTableOffset;
     DeclID WitnessTableID = 1;
 
+    /// The names of the specializations exported by the module. The data is
+    /// unused.
+    Table SpecializationList;
+
     /// Give each SILBasicBlock a unique ID.
     llvm::DenseMap<const SILBasicBlock*, unsigned> BasicBlockMap;
 
@@ -181,7 +228,7 @@ namespace {
     void writeSILWitnessTable(const SILWitnessTable &wt);
 
     void writeSILBlock(const SILModule *SILMod);
-    void writeIndexTables();
+    void writeIndexTables(const SILModule *SILMod);
 
     void writeConversionLikeInstruction(const SILInstruction *I);
     void writeOneTypeLayout(ValueKind valueKind, SILType type);
@@ -546,14 +593,24 @@ void SILSerializer::writeSILInstruction(const SILInstruction &SI) {
   case ValueKind::AllocRefInst: {
     const AllocRefInst *ARI = cast<AllocRefInst>(&SI);
     unsigned abbrCode = SILAbbrCodes[SILOneTypeValuesLayout::Code];
-    ValueID Args[1] = { (unsigned)ARI->isObjC() |
-                          ((unsigned)ARI->canAllocOnStack() << 1) };
+    SmallVector<ValueID, 6> Args;
+    Args.push_back((unsigned)ARI->isObjC() |
+                   ((unsigned)ARI->canAllocOnStack() << 1));
+    if (ARI->hasTailAllocatedElements()) {
+      SILType TailTy = ARI->getTailAllocatedType();
+      SILValue Count = ARI->getTailAllocatedCount();
+      Args.push_back(S.addTypeRef(TailTy.getSwiftRValueType()));
+      Args.push_back((unsigned)TailTy.getCategory());
+      Args.push_back(addValueRef(Count));
+      Args.push_back(S.addTypeRef(Count->getType().getSwiftRValueType()));
+      Args.push_back((unsigned)Count->getType().getCategory());
+    }
     SILOneTypeValuesLayout::emitRecord(Out, ScratchRecord, abbrCode,
                                        (unsigned)SI.getKind(),
                                        S.addTypeRef(
                                          ARI->getType().getSwiftRValueType()),
                                        (unsigned)ARI->getType().getCategory(),
-                                       llvm::makeArrayRef(Args));
+                                       Args);
     break;
   }
   case ValueKind::AllocRefDynamicInst: {
@@ -1053,7 +1110,8 @@ void SILSerializer::writeSILInstruction(const SILInstruction &SI) {
   case ValueKind::PointerToThinFunctionInst:
   case ValueKind::ObjCMetatypeToObjectInst:
   case ValueKind::ObjCExistentialMetatypeToObjectInst:
-  case ValueKind::ProjectBlockStorageInst: {
+  case ValueKind::ProjectBlockStorageInst:
+  case ValueKind::RefTailAddrInst: {
     writeConversionLikeInstruction(&SI);
     break;
   }
@@ -1456,8 +1514,10 @@ static void writeIndexTable(const sil_index_block::ListLayout &List,
   assert((kind == sil_index_block::SIL_FUNC_NAMES ||
           kind == sil_index_block::SIL_VTABLE_NAMES ||
           kind == sil_index_block::SIL_GLOBALVAR_NAMES ||
-          kind == sil_index_block::SIL_WITNESSTABLE_NAMES) &&
-         "SIL function table, global, vtable and witness table are supported");
+          kind == sil_index_block::SIL_WITNESSTABLE_NAMES ||
+          kind == sil_index_block::SIL_SPECIALIZATION_NAMES) &&
+         "SIL function table, global, vtable, witness table and "
+         "specialization table are supported");
   llvm::SmallString<4096> hashTableBlob;
   uint32_t tableOffset;
   {
@@ -1474,7 +1534,34 @@ static void writeIndexTable(const sil_index_block::ListLayout &List,
   List.emit(scratch, kind, tableOffset, hashTableBlob);
 }
 
-void SILSerializer::writeIndexTables() {
+/// Write the summaries of the functions of \p SILMod, which are keyed by
+/// function name and can be looked up without deserializing the functions.
+static void writeFunctionSummaryTable(const sil_index_block::ListLayout &List,
+                                      const SILModule *SILMod) {
+  auto &Summaries = SILMod->getFunctionSummaries();
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::OnDiskChainedHashTableGenerator<FuncSummaryTableInfo> generator;
+    // Insert the entries in a deterministic order.
+    std::vector<StringRef> Names;
+    for (auto &Entry : Summaries)
+      Names.push_back(Entry.getKey());
+    std::sort(Names.begin(), Names.end());
+    for (StringRef Name : Names)
+      generator.insert(Name, &Summaries.find(Name)->second);
+
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    // Make sure that no bucket is at offset 0.
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream);
+  }
+  SmallVector<uint64_t, 8> scratch;
+  List.emit(scratch, sil_index_block::SIL_FUNC_SUMMARIES, tableOffset,
+            hashTableBlob);
+}
+
+void SILSerializer::writeIndexTables(const SILModule *SILMod) {
   BCBlockRAII restoreBlock(Out, SIL_INDEX_BLOCK_ID, 4);
 
   sil_index_block::ListLayout List(Out);
@@ -1501,6 +1588,13 @@ void SILSerializer::writeIndexTables() {
     Offset.emit(ScratchRecord, sil_index_block::SIL_WITNESSTABLE_OFFSETS,
                 WitnessTableOffset);
   }
+
+  if (!SILMod->getFunctionSummaries().empty())
+    writeFunctionSummaryTable(List, SILMod);
+
+  if (!SpecializationList.empty())
+    writeIndexTable(List, sil_index_block::SIL_SPECIALIZATION_NAMES,
+                    SpecializationList);
 }
 
 void SILSerializer::writeSILGlobalVar(const SILGlobalVariable &g) {
@@ -1680,6 +1774,10 @@ void SILSerializer::writeSILBlock(const SILModule *SILMod) {
       writeSILWitnessTable(wt);
   }
 
+  // Specializations which were kept public can be called by clients.
+  for (StringRef Name : SILMod->getExportedSpecializationNames())
+    SpecializationList[Ctx.getIdentifier(Name)] = 0;
+
   // Go through all the SILFunctions in SILMod and write out any
   // mandatory function bodies.
   for (const SILFunction &F : *SILMod) {
@@ -1700,7 +1798,7 @@ void SILSerializer::writeSILBlock(const SILModule *SILMod) {
 
 void SILSerializer::writeSILModule(const SILModule *SILMod) {
   writeSILBlock(SILMod);
-  writeIndexTables();
+  writeIndexTables(SILMod);
 }
 
 void Serializer::writeSIL(const SILModule *SILMod, bool serializeAllSIL) {
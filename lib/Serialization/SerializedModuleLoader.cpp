@@ -512,6 +512,10 @@ StringRef SerializedASTFile::getFilename() const {
   return File.getModuleFilename();
 }
 
+StringRef SerializedASTFile::getInterfaceHash() const {
+  return File.getInterfaceHash();
+}
+
 const clang::Module *SerializedASTFile::getUnderlyingClangModule() {
   if (auto *ShadowedModule = File.getShadowedModule())
     return ShadowedModule->findUnderlyingClangModule();
@@ -106,6 +106,21 @@ SILWitnessTable *SerializedSILLoader::lookupWitnessTable(SILWitnessTable *WT) {
   return nullptr;
 }
 
+Optional<SILFunctionSummary>
+SerializedSILLoader::lookupFunctionSummary(StringRef Name) {
+  for (auto &Des : LoadedSILSections)
+    if (auto Summary = Des->lookupFunctionSummary(Name))
+      return Summary;
+  return None;
+}
+
+bool SerializedSILLoader::hasSpecialization(StringRef Name) {
+  for (auto &Des : LoadedSILSections)
+    if (Des->hasSpecialization(Name))
+      return true;
+  return false;
+}
+
 void SerializedSILLoader::invalidateCaches() {
   for (auto &Des : LoadedSILSections)
     Des->invalidateFunctionCache();
@@ -124,6 +139,8 @@ void SerializedSILLoader::getAllForModule(Identifier Mod,
     if (Des->getModuleIdentifier() == Mod) {
       Des->getAll(PrimaryFile ?
                   Des->getFile() != PrimaryFile : false);
+      Des->getAllFunctionSummaries();
+      Des->getAllSpecializationNames();
     }
   }
 }
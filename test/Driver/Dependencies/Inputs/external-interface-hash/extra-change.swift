@@ -0,0 +1,3 @@
+public func extra(scale: Int) -> Int {
+  return scale
+}
@@ -0,0 +1,3 @@
+public func extra() -> Int {
+  return 0
+}
@@ -0,0 +1,20 @@
+@_exported import Extra
+
+public struct Point {
+  public var x: Int
+  public var y: Int
+  private var z: Int = 0
+
+  public init(x: Int, y: Int) {
+    self.x = x
+    self.y = y
+  }
+}
+
+public func distance(p: Point) -> Int {
+  return p.x + p.y
+}
+
+private func helper() -> Int {
+  return 0
+}
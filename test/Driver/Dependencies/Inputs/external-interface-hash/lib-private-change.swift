@@ -0,0 +1,19 @@
+public struct Point {
+  public var x: Int
+  public var y: Int
+
+  public init(x: Int, y: Int) {
+    self.x = x
+    self.y = y
+  }
+}
+
+public func distance(p: Point) -> Int {
+  return helper() + p.x * p.x + p.y * p.y
+}
+
+private func helper() -> Int {
+  return 1
+}
+
+private func anotherHelper() {}
@@ -0,0 +1,6 @@
+public var counter = 0
+
+public func bump(x: Int) -> Int {
+  counter += 1
+  return x + 1
+}
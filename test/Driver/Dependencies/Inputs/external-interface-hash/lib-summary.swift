@@ -0,0 +1,5 @@
+public var counter = 0
+
+public func bump(x: Int) -> Int {
+  return x + 1
+}
@@ -0,0 +1,17 @@
+public struct Point {
+  public var x: Int
+  public var y: Int
+
+  public init(x: Int, y: Int) {
+    self.x = x
+    self.y = y
+  }
+}
+
+public func distance(p: Point) -> Int {
+  return p.x + p.y
+}
+
+private func helper() -> Int {
+  return 0
+}
@@ -0,0 +1,3 @@
+# Dependencies after compilation:
+depends-top-level: [a]
+depends-external: ["./Lib.swiftmodule"]
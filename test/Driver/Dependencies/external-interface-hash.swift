@@ -0,0 +1,75 @@
+/// other ==> main
+/// "./Lib.swiftmodule" ==> main
+
+// RUN: rm -rf %t && cp -r %S/Inputs/external-interface-hash/ %t
+// RUN: %target-swift-frontend -emit-module -o %t/Lib.swiftmodule -module-name Lib %t/lib.swift
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-FIRST %s
+
+// CHECK-FIRST-NOT: warning
+// CHECK-FIRST: Handled main.swift
+// CHECK-FIRST: Handled other.swift
+
+// The second build records the interface hash of the module.
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SECOND %s
+// RUN: FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-SECOND-NOT: Handled
+// CHECK-RECORD: external_interface_hashes:
+// CHECK-RECORD-NEXT: "./Lib.swiftmodule": "{{[0-9a-f]+}}"
+
+// Changing private declarations and function bodies doesn't change the
+// interface, so nothing needs to be rebuilt.
+// RUN: %target-swift-frontend -emit-module -o %t/Lib.swiftmodule -module-name Lib %t/lib-private-change.swift
+// RUN: touch -t 300004010005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v -driver-show-incremental 2>&1 | FileCheck -check-prefix=CHECK-PRIVATE %s
+
+// CHECK-PRIVATE: Interface of "Lib.swiftmodule" is unchanged
+// CHECK-PRIVATE-NOT: Handled
+
+// Adding a stored property changes the layout of a public type, even though
+// the property is private.
+// RUN: %target-swift-frontend -emit-module -o %t/Lib.swiftmodule -module-name Lib %t/lib-layout-change.swift
+// RUN: touch -t 300004010005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-LAYOUT %s
+
+// CHECK-LAYOUT-NOT: Handled other.swift
+// CHECK-LAYOUT: Handled main.swift
+// CHECK-LAYOUT-NOT: Handled other.swift
+
+// Re-exporting a module changes the interface.
+// RUN: %target-swift-frontend -emit-module -o %t/Extra.swiftmodule -module-name Extra %t/extra.swift
+// RUN: %target-swift-frontend -emit-module -o %t/Lib.swiftmodule -module-name Lib -I %t %t/lib-exported-change.swift
+// RUN: touch -t 300004010005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-EXPORTED %s
+
+// CHECK-EXPORTED-NOT: Handled other.swift
+// CHECK-EXPORTED: Handled main.swift
+// CHECK-EXPORTED-NOT: Handled other.swift
+
+// So does changing the interface of the re-exported module, even though the
+// source of the module itself is the same.
+// RUN: %target-swift-frontend -emit-module -o %t/Extra.swiftmodule -module-name Extra %t/extra-change.swift
+// RUN: %target-swift-frontend -emit-module -o %t/Lib.swiftmodule -module-name Lib -I %t %t/lib-exported-change.swift
+// RUN: touch -t 300004020005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-EXPORTED-CHANGE %s
+
+// CHECK-EXPORTED-CHANGE-NOT: Handled other.swift
+// CHECK-EXPORTED-CHANGE: Handled main.swift
+// CHECK-EXPORTED-CHANGE-NOT: Handled other.swift
+
+// Optimized clients depend on the side effects of public functions, even if
+// their bodies are not serialized.
+// RUN: %target-swift-frontend -O -emit-module -o %t/Lib.swiftmodule -module-name Lib %t/lib-summary.swift
+// RUN: touch -t 300004030005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SUMMARY-FIRST %s
+// CHECK-SUMMARY-FIRST: Handled main.swift
+
+// RUN: %target-swift-frontend -O -emit-module -o %t/Lib.swiftmodule -module-name Lib %t/lib-summary-change.swift
+// RUN: touch -t 300004040005 %t/Lib.swiftmodule
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./other.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SUMMARY %s
+
+// CHECK-SUMMARY-NOT: Handled other.swift
+// CHECK-SUMMARY: Handled main.swift
+// CHECK-SUMMARY-NOT: Handled other.swift
@@ -0,0 +1,35 @@
+// RUN: rm -rf %t && mkdir -p %t/cache
+// RUN: cp %S/Inputs/main.swift %S/Inputs/lib.swift %t
+
+// RUN: %target-swiftc_driver -driver-print-jobs -compilation-cache-path %t/cache -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=JOBS %s
+// JOBS: -primary-file {{.*}}/main.swift {{.*}} -emit-dependencies-path {{.*}}.d
+// JOBS: -primary-file {{.*}}/lib.swift {{.*}} -emit-dependencies-path {{.*}}.d
+
+// RUN: cd %t && %target-swiftc_driver -compilation-cache-path %t/cache -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=COLD %s
+// COLD: Compilation cache: 0 hits, 2 misses, 0 evicted
+
+// RUN: ls %t | FileCheck -check-prefix=NO-DEPENDENCIES %s
+// NO-DEPENDENCIES-NOT: .d
+
+// RUN: rm %t/main.o %t/lib.o
+// RUN: cd %t && %target-swiftc_driver -compilation-cache-path %t/cache -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=WARM %s
+// RUN: ls %t/main.o %t/lib.o
+// WARM: Compilation cache: 2 hits, 0 misses, 0 evicted
+
+// Outputs are restored wherever the current build wants them.
+// RUN: mkdir %t/elsewhere
+// RUN: cd %t/elsewhere && %target-swiftc_driver -compilation-cache-path %t/cache -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=WARM %s
+// RUN: ls %t/elsewhere/main.o %t/elsewhere/lib.o
+
+// Every job reads every file in the module, so changing one file invalidates
+// all entries.
+// RUN: echo "func otherLibraryFunction() {}" >> %t/lib.swift
+// RUN: cd %t && %target-swiftc_driver -compilation-cache-path %t/cache -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=COLD %s
+
+// RUN: cd %t && %target-swiftc_driver -compilation-cache-path %t/cache -compilation-cache-size-limit 1 -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=EVICT %s
+// EVICT: Compilation cache: 2 hits, 0 misses, 2 evicted
+
+// RUN: cd %t && %target-swiftc_driver -compilation-cache-path %t/cache -driver-print-cache-stats -module-name ThisModule -c %t/main.swift %t/lib.swift | FileCheck -check-prefix=COLD %s
+
+// RUN: not %target-swiftc_driver -compilation-cache-path %t/cache -compilation-cache-size-limit lots -c %t/main.swift 2>&1 | FileCheck -check-prefix=BAD-LIMIT %s
+// BAD-LIMIT: error: invalid value 'lots' in '-compilation-cache-size-limit lots'
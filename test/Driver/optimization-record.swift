@@ -0,0 +1,14 @@
+// RUN: %swiftc_driver -driver-print-jobs -module-name ThisModule -c -O %S/Inputs/lib.swift %s -save-optimization-record 2>&1 | FileCheck -check-prefix=PER-FILE %s
+// RUN: %swiftc_driver -driver-print-jobs -module-name ThisModule -c -O %S/Inputs/lib.swift %s -save-optimization-record-path %t.yaml 2>&1 | FileCheck -check-prefix=PER-FILE %s
+
+// PER-FILE: -primary-file {{.*}}/Inputs/lib.swift {{.*}} -save-optimization-record-path {{[^ ]*}}lib.opt.yaml
+// PER-FILE: -primary-file {{.*}}/optimization-record.swift {{.*}} -save-optimization-record-path {{[^ ]*}}optimization-record.opt.yaml
+
+// RUN: %swiftc_driver -driver-print-jobs -module-name ThisModule -c -O -whole-module-optimization %S/Inputs/lib.swift %s -save-optimization-record-path %t.yaml 2>&1 | FileCheck -check-prefix=WMO %s
+
+// WMO: -save-optimization-record-path {{[^ ]*}}.yaml
+// WMO-NOT: -save-optimization-record-path
+
+// RUN: %swiftc_driver -driver-print-jobs -module-name ThisModule -c -O %S/Inputs/lib.swift %s 2>&1 | FileCheck -check-prefix=NONE %s
+
+// NONE-NOT: -save-optimization-record-path
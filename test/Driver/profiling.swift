@@ -46,3 +46,13 @@
 // LINUX: clang++{{"? }}
 // LINUX: lib/swift/clang/lib/linux/libclang_rt.profile-x86_64.a
 
+
+// RUN: touch %t.profdata
+// RUN: %swiftc_driver -driver-print-jobs -profile-use=%t.profdata -target x86_64-unknown-linux-gnu %s | FileCheck -check-prefix=USE %s
+// RUN: not %swiftc_driver -driver-print-jobs -profile-use=%t.missing.profdata %s 2>&1 | FileCheck -check-prefix=USE_MISSING %s
+
+// USE: swift
+// USE: -profile-use={{.*}}.profdata
+// USE-NOT: libclang_rt.profile
+
+// USE_MISSING: error: no profdata file exists at '{{.*}}.missing.profdata'
@@ -0,0 +1,44 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swiftc_driver -driver-print-jobs -stats-output-dir %t/stats -module-name ThisModule -c %S/Inputs/lib.swift %s | FileCheck -check-prefix=JOBS %s
+
+// JOBS: -primary-file {{.*}}/Inputs/lib.swift {{.*}} -stats-output-dir {{.*}}/stats
+// JOBS: -primary-file {{.*}}/stats-output-dir.swift {{.*}} -stats-output-dir {{.*}}/stats
+
+// RUN: cd %t && %target-swiftc_driver -stats-output-dir %t/stats -module-name ThisModule -c %S/Inputs/lib.swift %s
+// RUN: ls %t/stats | FileCheck -check-prefix=FILES %s
+// RUN: cat %t/stats/stats-driver-*.json | FileCheck -check-prefix=DRIVER %s
+
+// FILES-DAG: stats-driver-{{[0-9]+}}-ThisModule.json
+// FILES-DAG: stats-frontend-{{[0-9]+}}-lib.swift.json
+// FILES-DAG: stats-frontend-{{[0-9]+}}-stats-output-dir.swift.json
+
+// The driver's file includes the sum of the frontend jobs' statistics.
+// DRIVER: {
+// DRIVER-DAG: "AST.NumDecls": {{[1-9][0-9]*}},
+// DRIVER-DAG: "AST.NumSourceFiles": 2,
+// DRIVER-DAG: "Driver.NumFrontendStatsFiles": 2,
+// DRIVER-DAG: "Driver.NumJobs": 2,
+// DRIVER-DAG: "Driver.NumJobsRun": 2,
+// DRIVER-DAG: "IR.NumInstructions": {{[1-9][0-9]*}},
+// DRIVER-DAG: "Memory.PeakResidentBytes": {{[1-9][0-9]*}},
+// DRIVER-DAG: "SIL.NumFunctions": {{[1-9][0-9]*}},
+// DRIVER-DAG: "time.Parsing.us": {{[0-9]+}},
+// DRIVER-DAG: "time.Type checking / Semantic analysis.us": {{[0-9]+}},
+// DRIVER: }
+
+// RUN: %target-swift-frontend -c -primary-file %s -o %t/frontend.o -stats-output-dir %t/frontend-stats
+// RUN: cat %t/frontend-stats/stats-frontend-*-stats-output-dir.swift.json | FileCheck -check-prefix=FRONTEND %s
+
+// FRONTEND: {
+// FRONTEND-DAG: "AST.NumSourceFiles": 1,
+// FRONTEND-DAG: "AST.NumTypes": {{[1-9][0-9]*}},
+// FRONTEND-DAG: "Sema.NumConstraintSystems": {{[1-9][0-9]*}},
+// FRONTEND-DAG: "Sema.NumStatesExplored": {{[0-9]+}},
+// FRONTEND-DAG: "SIL.NumInstructions": {{[1-9][0-9]*}},
+// FRONTEND: }
+
+// RUN: touch %t/not-a-directory
+// RUN: not %target-swift-frontend -c -primary-file %s -o %t/frontend.o -stats-output-dir %t/not-a-directory 2>&1 | FileCheck -check-prefix=BAD-DIR %s
+// BAD-DIR: error: error opening '{{.*}}/not-a-directory/stats-frontend-{{.*}}.json' for output
+
+func foo() -> Int { return 42 + 1 }
@@ -0,0 +1,36 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swiftc_driver -driver-print-jobs -driver-time-trace %t/trace.json -module-name ThisModule -c %S/Inputs/lib.swift %s | FileCheck -check-prefix=JOBS %s
+
+// JOBS: -primary-file {{.*}}/Inputs/lib.swift {{.*}} -trace-events-output-path {{.*}}.trace
+// JOBS: -primary-file {{.*}}/time-trace.swift {{.*}} -trace-events-output-path {{.*}}.trace
+
+// RUN: cd %t && %target-swiftc_driver -driver-time-trace %t/trace.json -module-name ThisModule -c %S/Inputs/lib.swift %s
+// RUN: FileCheck %s < %t/trace.json
+// RUN: ls %t | FileCheck -check-prefix=NO-FRAGMENTS %s
+
+// CHECK: [
+// CHECK-NEXT: {"name":"swift","cat":"driver","ph":"X",
+// CHECK-DAG: {"name":"compile","cat":"job","ph":"X",{{.*}}"args":{"file":"{{.*}}/Inputs/lib.swift"}}
+// CHECK-DAG: {"name":"compile","cat":"job","ph":"X",{{.*}}"args":{"file":"{{.*}}/time-trace.swift"}}
+// CHECK-DAG: {"name":"Parsing","cat":"frontend","ph":"X",{{.*}}"args":{"file":"{{.*}}/time-trace.swift"}}
+// CHECK-DAG: {"name":"Type checking / Semantic analysis","cat":"frontend",
+// CHECK-DAG: {"name":"SILGen","cat":"frontend",
+// CHECK-DAG: {"name":"SIL optimization","cat":"frontend",
+// CHECK-DAG: {"name":"IRGen","cat":"frontend",
+// CHECK-DAG: {"name":"LLVM output","cat":"frontend",
+// CHECK: ]
+
+// NO-FRAGMENTS-NOT: .trace
+
+// RUN: %target-swift-frontend -c -primary-file %s -o %t/frontend.o -trace-events-output-path %t/frontend.json
+// RUN: FileCheck -check-prefix=FRONTEND %s < %t/frontend.json
+
+// FRONTEND: [
+// FRONTEND-NEXT: {"name":"Parsing","cat":"frontend","ph":"X","ts":{{[0-9]+}},"dur":{{[0-9]+}},"pid":{{[0-9]+}},"tid":{{[0-9]+}},"args":{"file":"{{.*}}/time-trace.swift"}},
+// FRONTEND: {"name":"IRGen","cat":"frontend",
+// FRONTEND: ]
+
+// RUN: not %target-swift-frontend -c -primary-file %s -o %t/frontend.o -trace-events-output-path %t/missing/frontend.json 2>&1 | FileCheck -check-prefix=BAD-PATH %s
+// BAD-PATH: error: error opening '{{.*}}/missing/frontend.json' for output
+
+func foo() -> Int { return 42 }
@@ -0,0 +1,180 @@
+; RUN: %swift-llvm-opt -swift-merge-functions -swift-merge-functions-min-size=1 %s | FileCheck %s
+
+target datalayout = "e-p:64:64:64-S128-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f16:16:16-f32:32:32-f64:64:64-f128:128:128-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-macosx10.9"
+
+%swift.type = type { i64 }
+
+@int_metadata = external global %swift.type
+@uint_metadata = external global %swift.type
+
+declare void @use_metadata(i64, %swift.type*)
+declare void @other_use(i64, %swift.type*)
+
+; Functions which only differ in the metadata they use become thunks of a
+; merged function, which takes the metadata as parameter.
+
+; CHECK-LABEL: define void @specialized_for_int(i64 %x)
+; CHECK-NEXT: tail call void @specialized_for_intTm(i64 %x, %swift.type* @int_metadata)
+; CHECK-NEXT: ret void
+define void @specialized_for_int(i64 %x) {
+entry:
+  %y = add i64 %x, 1
+  call void @use_metadata(i64 %y, %swift.type* @int_metadata)
+  ret void
+}
+
+; CHECK-LABEL: define void @specialized_for_uint(i64 %x)
+; CHECK-NEXT: tail call void @specialized_for_intTm(i64 %x, %swift.type* @uint_metadata)
+; CHECK-NEXT: ret void
+define void @specialized_for_uint(i64 %x) {
+entry:
+  %y = add i64 %x, 1
+  call void @use_metadata(i64 %y, %swift.type* @uint_metadata)
+  ret void
+}
+
+; Different callees are not merged.
+
+; CHECK-LABEL: define void @different_callee(i64 %x)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: add i64 %x, 1
+; CHECK-NEXT: call void @other_use
+define void @different_callee(i64 %x) {
+entry:
+  %y = add i64 %x, 1
+  call void @other_use(i64 %y, %swift.type* @int_metadata)
+  ret void
+}
+
+
+; Constants passed to intrinsics are not parameterized.
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
+
+; CHECK-LABEL: define void @copy_int(i8* %d)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @llvm.memcpy
+define void @copy_int(i8* %d) {
+entry:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* bitcast (%swift.type* @int_metadata to i8*), i64 8, i32 8, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: define void @copy_uint(i8* %d)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @llvm.memcpy
+define void @copy_uint(i8* %d) {
+entry:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* bitcast (%swift.type* @uint_metadata to i8*), i64 8, i32 8, i1 false)
+  ret void
+}
+
+; Neither are the clauses of landing pads.
+
+@int_typeinfo = external global i8
+@uint_typeinfo = external global i8
+
+declare i32 @__gxx_personality_v0(...)
+declare void @may_throw()
+
+; CHECK-LABEL: define void @catch_int()
+; CHECK-NEXT: entry:
+; CHECK-NEXT: invoke void @may_throw()
+define void @catch_int() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @may_throw() to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 } catch i8* @int_typeinfo
+  ret void
+}
+
+; CHECK-LABEL: define void @catch_uint()
+; CHECK-NEXT: entry:
+; CHECK-NEXT: invoke void @may_throw()
+define void @catch_uint() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @may_throw() to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 } catch i8* @uint_typeinfo
+  ret void
+}
+
+; Neither are the operands of inline assembly.
+
+; CHECK-LABEL: define void @asm_int()
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void asm
+define void @asm_int() {
+entry:
+  call void asm sideeffect "", "r"(%swift.type* @int_metadata)
+  ret void
+}
+
+; CHECK-LABEL: define void @asm_uint()
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void asm
+define void @asm_uint() {
+entry:
+  call void asm sideeffect "", "r"(%swift.type* @uint_metadata)
+  ret void
+}
+
+; Functions with different instruction metadata are not merged.
+
+; CHECK-LABEL: define i64 @load_small(i64* %p)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: load i64, i64* %p, !range
+define i64 @load_small(i64* %p) {
+entry:
+  %v = load i64, i64* %p, !range !0
+  ret i64 %v
+}
+
+; CHECK-LABEL: define i64 @load_large(i64* %p)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: load i64, i64* %p, !range
+define i64 @load_large(i64* %p) {
+entry:
+  %v = load i64, i64* %p, !range !1
+  ret i64 %v
+}
+
+; Thunks which forward byval arguments are not tail calls.
+
+%pair = type { i64, i64 }
+
+declare void @use_pair(%pair*, %swift.type*)
+
+; CHECK-LABEL: define void @byval_int(%pair* byval %p)
+; CHECK-NEXT: {{^  call}} void @byval_intTm(%pair* {{.*}}%p, %swift.type* @int_metadata)
+; CHECK-NEXT: ret void
+define void @byval_int(%pair* byval %p) {
+entry:
+  call void @use_pair(%pair* %p, %swift.type* @int_metadata)
+  ret void
+}
+
+; CHECK-LABEL: define void @byval_uint(%pair* byval %p)
+; CHECK-NEXT: {{^  call}} void @byval_intTm(%pair* {{.*}}%p, %swift.type* @uint_metadata)
+; CHECK-NEXT: ret void
+define void @byval_uint(%pair* byval %p) {
+entry:
+  call void @use_pair(%pair* %p, %swift.type* @uint_metadata)
+  ret void
+}
+
+; CHECK-LABEL: define internal void @specialized_for_intTm(i64 %x, %swift.type*)
+; CHECK: %y = add i64 %x, 1
+; CHECK-NEXT: call void @use_metadata(i64 %y, %swift.type* %0)
+; CHECK-NEXT: ret void
+
+; CHECK-LABEL: define internal void @byval_intTm(%pair* byval %p, %swift.type*)
+; CHECK: call void @use_pair(%pair* %p, %swift.type* %0)
+
+!0 = !{i64 0, i64 16}
+!1 = !{i64 0, i64 256}
@@ -0,0 +1,40 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %llvm-profdata merge %S/Inputs/pgo_use.proftext -o %t/pgo_use.profdata
+// RUN: %target-swift-frontend -parse-as-library -emit-silgen -module-name pgo -profile-use=%t/pgo_use.profdata %s | FileCheck %s
+// RUN: %target-swift-frontend -parse-as-library -emit-ir -module-name pgo -profile-use=%t/pgo_use.profdata %s | FileCheck -check-prefix=IR %s
+
+var flag = true
+
+// CHECK: // Entry count: 10
+// CHECK-NEXT: sil hidden @_TF3pgo7branchyFT_Si
+// CHECK: cond_br {{%.*}}, [[THEN:bb[0-9]+]], [[ELSE:bb[0-9]+]]
+// CHECK: [[THEN]]: {{.*}}// Count: 3
+// IR-LABEL: define {{.*}} @_TF3pgo7branchyFT_Si() {{.*}}!prof [[ENTRY_10:![0-9]+]]
+// IR: br i1 {{%.*}}, label {{%.*}}, label {{%.*}}, !prof [[WEIGHTS:![0-9]+]]
+func branchy() -> Int {
+  if flag {
+    return 1
+  }
+  return 0
+}
+
+// CHECK: // Entry count: 0
+// CHECK-NEXT: sil hidden @_TF3pgo5neverFT_T_
+// IR-LABEL: define {{.*}} @_TF3pgo5neverFT_T_() [[COLD:#[0-9]+]] {{.*}}!prof [[ENTRY_0:![0-9]+]]
+func never() {}
+
+// Functions without profile data are left alone.
+// CHECK-NOT: // Entry count:
+// CHECK: sil hidden @_TF3pgo10unprofiledFT_T_
+// CHECK-NOT: // Count:
+// IR-LABEL: define {{.*}} @_TF3pgo10unprofiledFT_T_() {{#[0-9]+}} {
+func unprofiled() {
+  if flag {
+    never()
+  }
+}
+
+// IR: attributes [[COLD]] = {{.*}}cold
+// IR-DAG: [[ENTRY_10]] = !{!"function_entry_count", i64 10}
+// IR-DAG: [[ENTRY_0]] = !{!"function_entry_count", i64 0}
+// IR-DAG: [[WEIGHTS]] = !{!"branch_weights", i32 3, i32 7}
@@ -0,0 +1,8 @@
+@inline(never)
+public func genericSum<T : IntegerArithmeticType>(a: T, _ b: T) -> T {
+  return a + b
+}
+
+public func incrementInt(x: Int) -> Int {
+  return genericSum(x, 1)
+}
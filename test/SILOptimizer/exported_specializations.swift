@@ -0,0 +1,32 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -O -sil-serialize-all -export-specializations -parse-as-library -module-name SpecLib %S/Inputs/exported_specializations_lib.swift -emit-module -o %t
+// RUN: %target-swift-frontend -O -sil-serialize-all -export-specializations -parse-as-library -module-name SpecLib %S/Inputs/exported_specializations_lib.swift -emit-sil | FileCheck -check-prefix=LIB %s
+// RUN: %target-swift-frontend -O -reuse-specializations -I %t %s -emit-sil | FileCheck -check-prefix=REUSE %s
+// RUN: %target-swift-frontend -O -reuse-specializations -I %t %s -emit-sil | FileCheck -check-prefix=REUSE-NODEF %s
+// RUN: %target-swift-frontend -Onone -I %t %s -emit-sil | FileCheck -check-prefix=REUSE %s
+// RUN: %target-swift-frontend -O -I %t %s -emit-sil | FileCheck -check-prefix=COPY %s
+// RUN: %target-swift-frontend -O -sil-serialize-all -export-specializations -parse-as-library -module-name SpecLib -primary-file %S/Inputs/exported_specializations_lib.swift -emit-sil | FileCheck -check-prefix=LIB-PRIMARY %s
+
+// Check that a module compiled with -export-specializations keeps the
+// specializations of its public generic functions public, and that clients
+// call them instead of specializing again with -reuse-specializations or at
+// -Onone.
+
+import SpecLib
+
+// LIB: sil [noinline] @_TTSg5Si{{.*}}7SpecLib10genericSum{{.*}} {
+
+// Specializations are not exported from single-file jobs, which would each
+// define them.
+// LIB-PRIMARY: sil shared {{.*}}[noinline] @_TTSg5Si{{.*}}7SpecLib10genericSum{{.*}} {
+
+// REUSE-NODEF-NOT: sil shared {{.*}}@_TTSg5Si{{.*}}7SpecLib10genericSum
+
+// REUSE-LABEL: sil @_TF24exported_specializations6clientFSiSi
+// REUSE: function_ref @_TTSg5Si{{.*}}7SpecLib10genericSum
+// REUSE: return
+
+// COPY: sil shared {{.*}}[noinline] @_TTSg5Si{{.*}}7SpecLib10genericSum{{.*}} {
+public func client(x: Int) -> Int {
+  return genericSum(x, 2)
+}
@@ -18,6 +18,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Subsystems.h"
+#include "swift/AST/ASTWalker.h"
 #include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/AST/DiagnosticsSema.h"
 #include "swift/AST/IRGenOptions.h"
@@ -28,7 +29,9 @@
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/FileSystem.h"
 #include "swift/Basic/SourceManager.h"
+#include "swift/Basic/Statistics.h"
 #include "swift/Basic/Timer.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Frontend/DiagnosticVerifier.h"
 #include "swift/Frontend/Frontend.h"
 #include "swift/Frontend/PrintingDiagnosticConsumer.h"
@@ -37,12 +40,14 @@
 #include "swift/Option/Options.h"
 #include "swift/PrintAsObjC/PrintAsObjC.h"
 #include "swift/Serialization/SerializationOptions.h"
+#include "swift/SIL/SILModule.h"
 #include "swift/SILOptimizer/PassManager/Passes.h"
 
 // FIXME: We're just using CompilerInstance::createOutputFile.
 // This API should be sunk down to LLVM.
 #include "clang/Frontend/CompilerInstance.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -605,6 +610,141 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
+/// Returns the name of the file this frontend invocation is compiling, or the
+/// name of the module if there is no primary file.
+static StringRef getInvocationLabel(const FrontendOptions &opts) {
+  if (opts.PrimaryInput.hasValue() && opts.PrimaryInput->isFilename())
+    return opts.InputFilenames[opts.PrimaryInput->Index];
+  return opts.ModuleName;
+}
+
+namespace {
+  /// Counts the nodes of an AST and the distinct types they refer to.
+  class StatisticsWalker : public ASTWalker {
+    CompilerStatistics &Stats;
+    llvm::SmallPtrSet<TypeBase *, 64> Types;
+
+    void addType(Type type) {
+      if (type)
+        Types.insert(type->getCanonicalType().getPointer());
+    }
+
+  public:
+    explicit StatisticsWalker(CompilerStatistics &stats) : Stats(stats) {}
+
+    /// Adds the number of distinct types seen by the walker so far.
+    void addTypeCount() {
+      Stats.add("AST.NumTypes", Types.size());
+    }
+
+    bool walkToDeclPre(Decl *D) override {
+      Stats.add("AST.NumDecls", 1);
+      if (auto *VD = dyn_cast<ValueDecl>(D))
+        if (VD->hasType())
+          addType(VD->getType());
+      return true;
+    }
+
+    std::pair<bool, Expr *> walkToExprPre(Expr *E) override {
+      Stats.add("AST.NumExprs", 1);
+      addType(E->getType());
+      return { true, E };
+    }
+
+    std::pair<bool, Stmt *> walkToStmtPre(Stmt *S) override {
+      Stats.add("AST.NumStmts", 1);
+      return { true, S };
+    }
+  };
+}
+
+/// Adds the size of the ASTs this frontend invocation worked on to \p stats.
+static void countASTStatistics(CompilerInstance &Instance,
+                               CompilerStatistics &stats) {
+  ASTContext &Context = Instance.getASTContext();
+  stats.add("AST.NumLoadedModules", Context.LoadedModules.size());
+  stats.add("AST.ContextMemoryBytes", Context.getTotalMemory());
+
+  StatisticsWalker walker(stats);
+  auto countFile = [&](SourceFile &SF) {
+    stats.add("AST.NumSourceFiles", 1);
+    stats.add("AST.NumTopLevelDecls", SF.Decls.size());
+    for (Decl *D : SF.Decls)
+      D->walk(walker);
+  };
+
+  if (SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile()) {
+    countFile(*PrimarySourceFile);
+  } else {
+    for (FileUnit *File : Instance.getMainModule()->getFiles())
+      if (auto *SF = dyn_cast<SourceFile>(File))
+        countFile(*SF);
+  }
+  walker.addTypeCount();
+}
+
+/// Adds the size of \p SM, after optimization, to \p stats.
+static void countSILStatistics(const SILModule &SM,
+                               CompilerStatistics &stats) {
+  for (const SILFunction &F : SM) {
+    if (F.isExternalDeclaration())
+      continue;
+    stats.add("SIL.NumFunctions", 1);
+    for (const SILBasicBlock &BB : F) {
+      stats.add("SIL.NumBasicBlocks", 1);
+      stats.add("SIL.NumInstructions", std::distance(BB.begin(), BB.end()));
+    }
+  }
+  stats.add("SIL.NumGlobals",
+            std::distance(SM.getSILGlobals().begin(),
+                          SM.getSILGlobals().end()));
+  stats.add("SIL.NumVTables",
+            std::distance(SM.getVTables().begin(), SM.getVTables().end()));
+  stats.add("SIL.NumWitnessTables",
+            std::distance(SM.getWitnessTables().begin(),
+                          SM.getWitnessTables().end()));
+}
+
+/// Adds the size of \p Module, after optimization, to \p stats.
+static void countLLVMStatistics(const llvm::Module &Module,
+                                CompilerStatistics &stats) {
+  for (const llvm::Function &F : Module) {
+    if (F.isDeclaration())
+      continue;
+    stats.add("IR.NumFunctions", 1);
+    for (const llvm::BasicBlock &BB : F) {
+      stats.add("IR.NumBasicBlocks", 1);
+      stats.add("IR.NumInstructions", BB.size());
+    }
+  }
+  stats.add("IR.NumGlobals", Module.getGlobalList().size());
+}
+
+/// Writes the statistics collected by this frontend invocation to a new file
+/// in the directory given by -stats-output-dir.
+///
+/// Returns true if an error occurred.
+static bool emitStatistics(CompilerInstance &Instance,
+                           const FrontendOptions &opts,
+                           CompilerStatistics &stats) {
+  countASTStatistics(Instance, stats);
+  stats.addPhaseTimes();
+  stats.addLLVMStatistics();
+  stats.addPeakMemoryUsage();
+
+  std::string path =
+      CompilerStatistics::getOutputPath(opts.StatsOutputDir, "frontend",
+                                        TraceEvents::getCurrentProcessID(),
+                                        getInvocationLabel(opts));
+  std::error_code EC = stats.write(path);
+  if (EC) {
+    Instance.getDiags().diagnose(SourceLoc(), diag::error_opening_output,
+                                 path, EC.message());
+    return true;
+  }
+  return false;
+}
+
 /// Performs the compile requested by the user.
 /// \returns true on error
 static bool performCompile(CompilerInstance &Instance,
@@ -823,6 +963,9 @@ static bool performCompile(CompilerInstance &Instance,
     performSILInstCount(&*SM);
   }
 
+  if (CompilerStatistics *Stats = Instance.getASTContext().Stats)
+    countSILStatistics(*SM, *Stats);
+
   // Get the main source file's private discriminator and attach it to
   // the compile unit's flags.
   if (PrimarySourceFile) {
@@ -917,14 +1060,37 @@ static bool performCompile(CompilerInstance &Instance,
   // FIXME: We shouldn't need to use the global context here, but
   // something is persisting across calls to performIRGeneration.
   auto &LLVMContext = llvm::getGlobalContext();
+  std::unique_ptr<llvm::Module> IRModule;
   if (PrimarySourceFile) {
-    performIRGeneration(IRGenOpts, *PrimarySourceFile, SM.get(),
-                        opts.getSingleOutputFilename(), LLVMContext);
+    IRModule = performIRGeneration(IRGenOpts, *PrimarySourceFile, SM.get(),
+                                   opts.getSingleOutputFilename(), LLVMContext);
   } else {
-    performIRGeneration(IRGenOpts, Instance.getMainModule(), SM.get(),
-                        opts.getSingleOutputFilename(), LLVMContext);
+    IRModule = performIRGeneration(IRGenOpts, Instance.getMainModule(),
+                                   SM.get(), opts.getSingleOutputFilename(),
+                                   LLVMContext);
   }
 
+  if (CompilerStatistics *Stats = Instance.getASTContext().Stats)
+    if (IRModule)
+      countLLVMStatistics(*IRModule, *Stats);
+
+  return false;
+}
+
+/// Writes the trace events recorded by this frontend invocation, labelled by
+/// the file it was compiling.
+///
+/// Returns true if an error occurred.
+static bool emitTraceEvents(DiagnosticEngine &diags,
+                            const FrontendOptions &opts) {
+  std::error_code EC =
+      TraceEvents::writeRecordedEvents(opts.TraceEventsOutputPath,
+                                       getInvocationLabel(opts));
+  if (EC) {
+    diags.diagnose(SourceLoc(), diag::error_opening_output,
+                   opts.TraceEventsOutputPath, EC.message());
+    return true;
+  }
   return false;
 }
 
@@ -1095,6 +1261,14 @@ int frontend_main(ArrayRef<const char *>Args,
   if (Invocation.getFrontendOptions().DebugTimeCompilation)
     SharedTimer::enableCompilationTimers();
 
+  // Phase timings for -stats-output-dir are taken from the trace events.
+  bool CollectStats = !Invocation.getFrontendOptions().StatsOutputDir.empty();
+  if (!Invocation.getFrontendOptions().TraceEventsOutputPath.empty() ||
+      CollectStats)
+    TraceEvents::enable();
+
+  // LLVM statistics are only included in the -stats-output-dir files if they
+  // are enabled here, since enabling them also prints them on exit.
   if (Invocation.getFrontendOptions().PrintStats) {
     llvm::EnableStatistics();
   }
@@ -1107,16 +1281,31 @@ int frontend_main(ArrayRef<const char *>Args,
   if (!Invocation.getFrontendOptions().DependenciesFilePath.empty() ||
       !Invocation.getFrontendOptions().ReferenceDependenciesFilePath.empty()) {
     Instance.setDependencyTracker(&depTracker);
+    // The profile is an input of the compilation just like imported modules.
+    if (!Invocation.getSILOptions().UseProfile.empty())
+      depTracker.addDependency(Invocation.getSILOptions().UseProfile);
   }
 
   if (Instance.setup(Invocation)) {
     return 1;
   }
 
+  CompilerStatistics Stats;
+  if (CollectStats)
+    Instance.getASTContext().Stats = &Stats;
+
   int ReturnValue = 0;
   bool HadError = performCompile(Instance, Invocation, Args, ReturnValue) ||
                   Instance.getASTContext().hadError();
 
+  if (!Invocation.getFrontendOptions().TraceEventsOutputPath.empty())
+    HadError |= emitTraceEvents(Instance.getDiags(),
+                                Invocation.getFrontendOptions());
+
+  if (CollectStats)
+    HadError |= emitStatistics(Instance, Invocation.getFrontendOptions(),
+                               Stats);
+
   if (!HadError && !Invocation.getFrontendOptions().DumpAPIPath.empty()) {
     HadError = dumpAPI(Instance.getMainModule(),
                        Invocation.getFrontendOptions().DumpAPIPath);
@@ -159,6 +159,10 @@ ASTVerifierProcessId("ast-verifier-process-id", llvm::cl::Hidden,
 static llvm::cl::opt<bool>
 PerformWMO("wmo", llvm::cl::desc("Enable whole-module optimizations"));
 
+static llvm::cl::opt<std::string>
+OptRecordFile("save-optimization-record-path",
+              llvm::cl::desc("Write optimization remarks as YAML to a file"));
+
 static void runCommandLineSelectedPasses(SILModule *Module) {
   SILPassManager PM(Module);
 
@@ -223,6 +227,7 @@ int main(int argc, char **argv) {
   SILOpts.VerifyAll = EnableSILVerifyAll;
   SILOpts.RemoveRuntimeAsserts = RemoveRuntimeAsserts;
   SILOpts.AssertConfig = AssertConfId;
+  SILOpts.OptRecordFile = OptRecordFile;
   if (OptimizationGroup != OptGroup::Diagnostics)
     SILOpts.Optimization = SILOptions::SILOptMode::Optimize;
 
@@ -234,6 +234,7 @@ int main(int argc, char **argv) {
   initializeSwiftARCOptPass(Registry);
   initializeSwiftARCContractPass(Registry);
   initializeSwiftStackPromotionPass(Registry);
+  initializeSwiftMergeFunctionsPass(Registry);
 
   llvm::cl::ParseCommandLineOptions(argc, argv, "Swift LLVM optimizer\n");
 